@@ -6,6 +6,14 @@ static agc_mutex_t *APIS_MUTEX = NULL;
 
 static agc_status_t parse_and_exec(char *xcmd);
 
+#define EVENT_STATS_SUBSCRIBERS 64
+
+static const char *EVENT_PRIORITY_NAMES[EVENT_PRIORITY_CLASSES] = { "high", "normal", "low" };
+
+AGC_STANDARD_API(event_stats_api);
+
+AGC_STANDARD_API(event_dispatchers_api);
+
 AGC_DECLARE(agc_status_t) agc_api_init(agc_memory_pool_t *pool)
 {
 	assert(pool);
@@ -13,6 +21,9 @@ AGC_DECLARE(agc_status_t) agc_api_init(agc_memory_pool_t *pool)
 
 	agc_mutex_init(&APIS_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
 
+	agc_api_register("event_stats", "event delivery latency", "event_stats [<event name>]", event_stats_api);
+	agc_api_register("event_dispatchers", "show or resize the event dispatchers", "event_dispatchers [<count>]", event_dispatchers_api);
+
 	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Api init success.\n");
 	return AGC_STATUS_SUCCESS;
 }
@@ -259,4 +270,122 @@ AGC_DECLARE(agc_status_t) agc_api_stream_raw_write(agc_stream_handle_t *handle,
 	*(uint8_t *) handle->end = '\0';
 
 	return AGC_STATUS_SUCCESS;
-}
\ No newline at end of file
+}
+
+static void event_stats_lane(agc_stream_handle_t *stream, agc_event_subscriber_stats_t *sub)
+{
+	if (!sub->async) {
+		return;
+	}
+
+	stream->write_function(stream, "    lane depth %u high %u queued %llu dropped %llu blocked %llu %lluus delay p99 %llu max %llu\n",
+						sub->lane_depth, sub->lane_high_water,
+						(unsigned long long) sub->lane_queued,
+						(unsigned long long) sub->lane_dropped,
+						(unsigned long long) sub->lane_blocked,
+						(unsigned long long) sub->lane_blocked_us,
+						(unsigned long long) agc_event_latency_percentile(&sub->lane_delay, 99),
+						(unsigned long long) sub->lane_delay.max_us);
+}
+
+/*
+ * event_stats [<event name>]
+ * queue delay and handle time per event id, callback time per subscriber, in microseconds.
+ * async subscribers also show their lane, delay is fire to callback.
+ * Without an event name the dispatchers' priority classes follow.
+ */
+AGC_STANDARD_API(event_stats_api)
+{
+	agc_event_latency_t queue_delay;
+	agc_event_latency_t handle;
+	agc_event_subscriber_stats_t *subs;
+	agc_event_priority_stats_t priority;
+	int event_id = -1;
+	int i, j, count;
+
+	if (cmd && *cmd && agc_event_get_id(cmd, &event_id) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "unknown event %s.\n", cmd);
+		return AGC_STATUS_FALSE;
+	}
+
+	if (!(subs = malloc(EVENT_STATS_SUBSCRIBERS * sizeof(agc_event_subscriber_stats_t)))) {
+		return AGC_STATUS_MEMERR;
+	}
+
+	for (i = 0; i < EVENT_ID_LIMIT; i++) {
+		if ((event_id >= 0 && i != event_id) || agc_event_get_latency(i, &queue_delay, &handle) != AGC_STATUS_SUCCESS) {
+			continue;
+		}
+
+		stream->write_function(stream, "event %s(%d) delivered %llu expired %llu\n", agc_event_get_name(i), i,
+							(unsigned long long) handle.count, (unsigned long long) agc_event_get_expired(i));
+		stream->write_function(stream, "  queue  p50 %llu p99 %llu p999 %llu max %llu\n",
+							(unsigned long long) agc_event_latency_percentile(&queue_delay, 50),
+							(unsigned long long) agc_event_latency_percentile(&queue_delay, 99),
+							(unsigned long long) agc_event_latency_percentile(&queue_delay, 99.9),
+							(unsigned long long) queue_delay.max_us);
+		stream->write_function(stream, "  handle p50 %llu p99 %llu p999 %llu max %llu\n",
+							(unsigned long long) agc_event_latency_percentile(&handle, 50),
+							(unsigned long long) agc_event_latency_percentile(&handle, 99),
+							(unsigned long long) agc_event_latency_percentile(&handle, 99.9),
+							(unsigned long long) handle.max_us);
+
+		count = i == EVENT_ID_ALL ? 0 : agc_event_get_subscriber_stats(i, subs, EVENT_STATS_SUBSCRIBERS);
+		for (j = 0; j < count; j++) {
+			stream->write_function(stream, "  subscriber %s calls %llu p50 %llu p99 %llu p999 %llu max %llu\n", subs[j].id,
+							(unsigned long long) subs[j].callback.count,
+							(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 50),
+							(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 99),
+							(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 99.9),
+							(unsigned long long) subs[j].callback.max_us);
+			event_stats_lane(stream, &subs[j]);
+		}
+	}
+
+	// EVENT_ID_ALL subscribers see every event, they are listed once
+	count = agc_event_get_subscriber_stats(EVENT_ID_ALL, subs, EVENT_STATS_SUBSCRIBERS);
+	for (j = 0; j < count && event_id < 0; j++) {
+		stream->write_function(stream, "subscriber %s(all) calls %llu p50 %llu p99 %llu p999 %llu max %llu\n", subs[j].id,
+						(unsigned long long) subs[j].callback.count,
+						(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 50),
+						(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 99),
+						(unsigned long long) agc_event_latency_percentile(&subs[j].callback, 99.9),
+						(unsigned long long) subs[j].callback.max_us);
+		event_stats_lane(stream, &subs[j]);
+	}
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES && event_id < 0; i++) {
+		if (agc_event_get_priority_stats((agc_event_priority_t) i, &priority) != AGC_STATUS_SUCCESS) {
+			continue;
+		}
+
+		stream->write_function(stream, "priority %s depth %u high %u starved %llu queue p50 %llu p99 %llu max %llu\n",
+						EVENT_PRIORITY_NAMES[i], priority.depth, priority.high_water,
+						(unsigned long long) priority.starved,
+						(unsigned long long) agc_event_latency_percentile(&priority.queue_delay, 50),
+						(unsigned long long) agc_event_latency_percentile(&priority.queue_delay, 99),
+						(unsigned long long) priority.queue_delay.max_us);
+	}
+
+	free(subs);
+	return AGC_STATUS_SUCCESS;
+}
+
+/*
+ * event_dispatchers [<count>]
+ */
+AGC_STANDARD_API(event_dispatchers_api)
+{
+	int count;
+
+	if (cmd && *cmd) {
+		count = atoi(cmd);
+		if (agc_event_resize_dispatchers(count) != AGC_STATUS_SUCCESS) {
+			stream->write_function(stream, "resize to %s failed, 1 to %d dispatchers.\n", cmd, agc_event_dispatcher_capacity());
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	stream->write_function(stream, "%d dispatchers, up to %d.\n", agc_event_dispatcher_count(), agc_event_dispatcher_capacity());
+	return AGC_STATUS_SUCCESS;
+}
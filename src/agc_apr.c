@@ -1034,27 +1034,127 @@ AGC_DECLARE(agc_status_t) agc_md5_string(char digest_str[AGC_MD5_DIGEST_STRING_S
 	return status;
 }
 
-/* FIFO queues (apr-util) */
+/* FIFO queues (apr-util or lock-free ring) */
+
+typedef struct {
+	/*! position the cell is ready for, see push/pop */
+	volatile uint32_t sequence;
+	void *data;
+} agc_ring_cell_t;
+
+struct agc_queue {
+	agc_queue_type_t type;
+	apr_queue_t *apr_queue;
+
+	/* AGC_QUEUE_RING */
+	agc_ring_cell_t *cells;
+	uint32_t mask;
+	volatile int terminated;
+	/*! slow path, only used when a caller has to block */
+	apr_thread_mutex_t *mutex;
+	apr_thread_cond_t *not_empty;
+	apr_thread_cond_t *not_full;
+	volatile uint32_t empty_waiters;
+	volatile uint32_t full_waiters;
+
+	/* producers and consumers touch different cache lines */
+	char pad0[AGC_CACHELINE_SIZE];
+	volatile uint32_t enqueue_pos;
+	char pad1[AGC_CACHELINE_SIZE - sizeof(uint32_t)];
+	volatile uint32_t dequeue_pos;
+	char pad2[AGC_CACHELINE_SIZE - sizeof(uint32_t)];
+};
+
+static apr_status_t agc_ring_enqueue(agc_queue_t *queue, void *data);
+
+static unsigned int agc_ring_enqueue_bulk(agc_queue_t *queue, void **data, unsigned int count);
+static apr_status_t agc_ring_dequeue(agc_queue_t *queue, void **data);
+static apr_status_t agc_ring_trypush(agc_queue_t *queue, void *data);
+static apr_status_t agc_ring_trypop(agc_queue_t *queue, void **data);
+static apr_status_t agc_ring_push(agc_queue_t *queue, void *data, agc_interval_time_t timeout);
+static apr_status_t agc_ring_pop(agc_queue_t *queue, void **data, agc_interval_time_t timeout);
+static apr_status_t agc_ring_interrupt_all(agc_queue_t *queue);
 
 AGC_DECLARE(agc_status_t) agc_queue_create(agc_queue_t ** queue, unsigned int queue_capacity, agc_memory_pool_t *pool)
 {
-	return apr_queue_create(queue, queue_capacity, pool);
+	return agc_queue_create_ex(queue, queue_capacity, AGC_QUEUE_APR, pool);
+}
+
+AGC_DECLARE(agc_status_t) agc_queue_create_ex(agc_queue_t ** queue, unsigned int queue_capacity, agc_queue_type_t type, agc_memory_pool_t *pool)
+{
+	agc_queue_t *new_queue = NULL;
+	uint32_t capacity = 2;
+	uint32_t i;
+	apr_status_t status;
+
+	*queue = NULL;
+
+	new_queue = apr_pcalloc(pool, sizeof(agc_queue_t));
+	new_queue->type = type;
+
+	if (type == AGC_QUEUE_APR) {
+		if ((status = apr_queue_create(&new_queue->apr_queue, queue_capacity, pool)) != APR_SUCCESS) {
+			return status;
+		}
+		*queue = new_queue;
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (queue_capacity > 0x40000000) {
+		return AGC_STATUS_GENERR;
+	}
+
+	while (capacity < queue_capacity) {
+		capacity <<= 1;
+	}
+
+	new_queue->cells = apr_palloc(pool, capacity * sizeof(agc_ring_cell_t));
+	for (i = 0; i < capacity; i++) {
+		new_queue->cells[i].sequence = i;
+		new_queue->cells[i].data = NULL;
+	}
+	new_queue->mask = capacity - 1;
+
+	if ((status = apr_thread_mutex_create(&new_queue->mutex, APR_THREAD_MUTEX_DEFAULT, pool)) != APR_SUCCESS ||
+		(status = apr_thread_cond_create(&new_queue->not_empty, pool)) != APR_SUCCESS ||
+		(status = apr_thread_cond_create(&new_queue->not_full, pool)) != APR_SUCCESS) {
+		return status;
+	}
+
+	*queue = new_queue;
+	return AGC_STATUS_SUCCESS;
 }
 
 AGC_DECLARE(unsigned int) agc_queue_size(agc_queue_t *queue)
 {
-	return apr_queue_size(queue);
+	if (queue->type == AGC_QUEUE_RING) {
+		uint32_t tail = agc_load_acquire(&queue->dequeue_pos);
+		uint32_t head = agc_load_acquire(&queue->enqueue_pos);
+		int32_t size = (int32_t)(head - tail);
+
+		return size > 0 ? (unsigned int) size : 0;
+	}
+
+	return apr_queue_size(queue->apr_queue);
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_pop(agc_queue_t *queue, void **data)
 {
-	return apr_queue_pop(queue, data);
+	if (queue->type == AGC_QUEUE_RING) {
+		return agc_ring_pop(queue, data, -1);
+	}
+
+	return apr_queue_pop(queue->apr_queue, data);
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_pop_timeout(agc_queue_t *queue, void **data, agc_interval_time_t timeout)
 {
+	if (queue->type == AGC_QUEUE_RING) {
+		return agc_ring_pop(queue, data, timeout);
+	}
+
     // TODO apr_queue_timedpop(queue, data, timeout);
-	return apr_queue_pop(queue, data);
+	return apr_queue_pop(queue->apr_queue, data);
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_push(agc_queue_t *queue, void *data)
@@ -1062,25 +1162,85 @@ AGC_DECLARE(agc_status_t) agc_queue_push(agc_queue_t *queue, void *data)
 	apr_status_t s;
 
 	do {
-		s = apr_queue_push(queue, data);
+		if (queue->type == AGC_QUEUE_RING) {
+			s = agc_ring_push(queue, data, -1);
+		} else {
+			s = apr_queue_push(queue->apr_queue, data);
+		}
 	} while (s == APR_EINTR);
 
 	return s;
 }
 
+AGC_DECLARE(agc_status_t) agc_queue_push_timeout(agc_queue_t *queue, void *data, agc_interval_time_t timeout)
+{
+	if (queue->type == AGC_QUEUE_RING) {
+		return agc_ring_push(queue, data, timeout);
+	}
+
+	// apr_queue has no timed push, it waits until there is room or agc_queue_interrupt_all
+	return apr_queue_push(queue->apr_queue, data);
+}
+
 AGC_DECLARE(agc_status_t) agc_queue_trypop(agc_queue_t *queue, void **data)
 {
-	return apr_queue_trypop(queue, data);
+	if (queue->type == AGC_QUEUE_RING) {
+		return agc_ring_trypop(queue, data);
+	}
+
+	return apr_queue_trypop(queue->apr_queue, data);
+}
+
+AGC_DECLARE(unsigned int) agc_queue_trypop_bulk(agc_queue_t *queue, void **data, unsigned int max)
+{
+	unsigned int count = 0;
+
+	if (queue->type != AGC_QUEUE_RING) {
+		while (count < max && apr_queue_trypop(queue->apr_queue, &data[count]) == APR_SUCCESS) {
+			count++;
+		}
+
+		return count;
+	}
+
+	if (queue->terminated) {
+		return 0;
+	}
+
+	while (count < max && agc_ring_dequeue(queue, &data[count]) == APR_SUCCESS) {
+		count++;
+	}
+
+	// one wakeup for the whole batch
+	if (count) {
+		agc_memory_barrier();
+		if (queue->full_waiters) {
+			apr_thread_mutex_lock(queue->mutex);
+			apr_thread_cond_broadcast(queue->not_full);
+			apr_thread_mutex_unlock(queue->mutex);
+		}
+	}
+
+	return count;
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_interrupt_all(agc_queue_t *queue)
 {
-	return apr_queue_interrupt_all(queue);
+	if (queue->type == AGC_QUEUE_RING) {
+		return agc_ring_interrupt_all(queue);
+	}
+
+	return apr_queue_interrupt_all(queue->apr_queue);
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_term(agc_queue_t *queue)
 {
-	return apr_queue_term(queue);
+	if (queue->type == AGC_QUEUE_RING) {
+		queue->terminated = 1;
+		return agc_ring_interrupt_all(queue);
+	}
+
+	return apr_queue_term(queue->apr_queue);
 }
 
 AGC_DECLARE(agc_status_t) agc_queue_trypush(agc_queue_t *queue, void *data)
@@ -1088,12 +1248,289 @@ AGC_DECLARE(agc_status_t) agc_queue_trypush(agc_queue_t *queue, void *data)
 	apr_status_t s;
 
 	do {
-		s = apr_queue_trypush(queue, data);
+		if (queue->type == AGC_QUEUE_RING) {
+			s = agc_ring_trypush(queue, data);
+		} else {
+			s = apr_queue_trypush(queue->apr_queue, data);
+		}
 	} while (s == APR_EINTR);
 
 	return s;
 }
 
+AGC_DECLARE(unsigned int) agc_queue_trypush_bulk(agc_queue_t *queue, void **data, unsigned int count)
+{
+	unsigned int pushed = 0;
+
+	if (queue->type != AGC_QUEUE_RING) {
+		while (pushed < count && apr_queue_trypush(queue->apr_queue, data[pushed]) == APR_SUCCESS) {
+			pushed++;
+		}
+
+		return pushed;
+	}
+
+	pushed = agc_ring_enqueue_bulk(queue, data, count);
+
+	// one wakeup for the whole batch
+	if (pushed) {
+		agc_memory_barrier();
+		if (queue->empty_waiters) {
+			apr_thread_mutex_lock(queue->mutex);
+			apr_thread_cond_broadcast(queue->not_empty);
+			apr_thread_mutex_unlock(queue->mutex);
+		}
+	}
+
+	return pushed;
+}
+
+/*
+ * Bounded ring of Dmitry Vyukov. 
+ * Every cell carries a sequence, a producer owns cell pos when sequence == pos,
+ * a consumer owns it when sequence == pos + 1. The positions are claimed with cas, 
+ * so any number of threads can push and pop without a lock.
+ * The mutex and conditions are only used by the blocking calls.
+ */
+static apr_status_t agc_ring_enqueue(agc_queue_t *queue, void *data)
+{
+	agc_ring_cell_t *cell;
+	uint32_t pos;
+	uint32_t seq;
+	int32_t diff;
+
+	if (queue->terminated) {
+		return APR_EOF;
+	}
+
+	pos = agc_load_acquire(&queue->enqueue_pos);
+	for (;;) {
+		cell = &queue->cells[pos & queue->mask];
+		seq = agc_load_acquire(&cell->sequence);
+		diff = (int32_t)(seq - pos);
+
+		if (diff == 0) {
+			if (agc_cas(&queue->enqueue_pos, &pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return APR_EAGAIN;
+		} else {
+			pos = agc_load_acquire(&queue->enqueue_pos);
+		}
+	}
+
+	cell->data = data;
+	agc_store_release(&cell->sequence, pos + 1);
+
+	return APR_SUCCESS;
+}
+
+/*
+ * Claim the run of free cells at the enqueue position, up to count, with one cas, then fill them in order.
+ * A cell is free once its consumer released it, like in agc_ring_enqueue, so a consumer
+ * preempted between taking a cell and releasing it ends the run instead of being waited for.
+ */
+static unsigned int agc_ring_enqueue_bulk(agc_queue_t *queue, void **data, unsigned int count)
+{
+	agc_ring_cell_t *cell;
+	uint32_t pos, i, room, seq = 0;
+
+	if (queue->terminated || !count) {
+		return 0;
+	}
+
+	if (count > queue->mask + 1) {
+		count = queue->mask + 1;
+	}
+
+	pos = agc_load_acquire(&queue->enqueue_pos);
+	for (;;) {
+		for (room = 0; room < count; room++) {
+			cell = &queue->cells[(pos + room) & queue->mask];
+			if ((seq = agc_load_acquire(&cell->sequence)) != pos + room) {
+				break;
+			}
+		}
+
+		if (!room) {
+			// full, or another producer claimed the cell and the run starts further on
+			if ((int32_t)(seq - pos) < 0) {
+				return 0;
+			}
+			pos = agc_load_acquire(&queue->enqueue_pos);
+			continue;
+		}
+
+		// the cells stay free until the enqueue position passes them
+		if (agc_cas(&queue->enqueue_pos, &pos, pos + room)) {
+			break;
+		}
+	}
+
+	for (i = 0; i < room; i++) {
+		cell = &queue->cells[(pos + i) & queue->mask];
+		cell->data = data[i];
+		agc_store_release(&cell->sequence, pos + i + 1);
+	}
+
+	return room;
+}
+
+static apr_status_t agc_ring_dequeue(agc_queue_t *queue, void **data)
+{
+	agc_ring_cell_t *cell;
+	uint32_t pos;
+	uint32_t seq;
+	int32_t diff;
+
+	if (queue->terminated) {
+		return APR_EOF;
+	}
+
+	pos = agc_load_acquire(&queue->dequeue_pos);
+	for (;;) {
+		cell = &queue->cells[pos & queue->mask];
+		seq = agc_load_acquire(&cell->sequence);
+		diff = (int32_t)(seq - (pos + 1));
+
+		if (diff == 0) {
+			if (agc_cas(&queue->dequeue_pos, &pos, pos + 1)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return APR_EAGAIN;
+		} else {
+			pos = agc_load_acquire(&queue->dequeue_pos);
+		}
+	}
+
+	*data = cell->data;
+	agc_store_release(&cell->sequence, pos + queue->mask + 1);
+
+	return APR_SUCCESS;
+}
+
+static apr_status_t agc_ring_trypush(agc_queue_t *queue, void *data)
+{
+	apr_status_t status;
+
+	if ((status = agc_ring_enqueue(queue, data)) != APR_SUCCESS) {
+		return status;
+	}
+
+	agc_memory_barrier();
+	if (queue->empty_waiters) {
+		apr_thread_mutex_lock(queue->mutex);
+		apr_thread_cond_signal(queue->not_empty);
+		apr_thread_mutex_unlock(queue->mutex);
+	}
+
+	return APR_SUCCESS;
+}
+
+static apr_status_t agc_ring_trypop(agc_queue_t *queue, void **data)
+{
+	apr_status_t status;
+
+	if ((status = agc_ring_dequeue(queue, data)) != APR_SUCCESS) {
+		return status;
+	}
+
+	agc_memory_barrier();
+	if (queue->full_waiters) {
+		apr_thread_mutex_lock(queue->mutex);
+		apr_thread_cond_signal(queue->not_full);
+		apr_thread_mutex_unlock(queue->mutex);
+	}
+
+	return APR_SUCCESS;
+}
+
+static apr_status_t agc_ring_push(agc_queue_t *queue, void *data, agc_interval_time_t timeout)
+{
+	apr_status_t status;
+
+	if ((status = agc_ring_trypush(queue, data)) != APR_EAGAIN) {
+		return status;
+	}
+
+	apr_thread_mutex_lock(queue->mutex);
+	agc_fetch_add(&queue->full_waiters, 1);
+
+	// a pop may have happened before we were counted
+	if ((status = agc_ring_enqueue(queue, data)) == APR_EAGAIN) {
+		if (timeout < 0) {
+			apr_thread_cond_wait(queue->not_full, queue->mutex);
+			status = APR_EINTR;
+		} else {
+			status = apr_thread_cond_timedwait(queue->not_full, queue->mutex, timeout);
+			status = APR_STATUS_IS_TIMEUP(status) ? APR_TIMEUP : APR_EINTR;
+		}
+
+		if (agc_ring_enqueue(queue, data) == APR_SUCCESS) {
+			status = APR_SUCCESS;
+		} else if (queue->terminated) {
+			status = APR_EOF;
+		}
+	}
+
+	agc_fetch_add(&queue->full_waiters, -1);
+	if (status == APR_SUCCESS && queue->empty_waiters) {
+		apr_thread_cond_signal(queue->not_empty);
+	}
+	apr_thread_mutex_unlock(queue->mutex);
+
+	return status;
+}
+
+static apr_status_t agc_ring_pop(agc_queue_t *queue, void **data, agc_interval_time_t timeout)
+{
+	apr_status_t status;
+
+	if ((status = agc_ring_trypop(queue, data)) != APR_EAGAIN) {
+		return status;
+	}
+
+	apr_thread_mutex_lock(queue->mutex);
+	agc_fetch_add(&queue->empty_waiters, 1);
+
+	// a push may have happened before we were counted
+	if ((status = agc_ring_dequeue(queue, data)) == APR_EAGAIN) {
+		if (timeout < 0) {
+			apr_thread_cond_wait(queue->not_empty, queue->mutex);
+			status = APR_EINTR;
+		} else {
+			status = apr_thread_cond_timedwait(queue->not_empty, queue->mutex, timeout);
+			status = APR_STATUS_IS_TIMEUP(status) ? APR_TIMEUP : APR_EINTR;
+		}
+
+		if (agc_ring_dequeue(queue, data) == APR_SUCCESS) {
+			status = APR_SUCCESS;
+		} else if (queue->terminated) {
+			status = APR_EOF;
+		}
+	}
+
+	agc_fetch_add(&queue->empty_waiters, -1);
+	if (status == APR_SUCCESS && queue->full_waiters) {
+		apr_thread_cond_signal(queue->not_full);
+	}
+	apr_thread_mutex_unlock(queue->mutex);
+
+	return status;
+}
+
+static apr_status_t agc_ring_interrupt_all(agc_queue_t *queue)
+{
+	apr_thread_mutex_lock(queue->mutex);
+	apr_thread_cond_broadcast(queue->not_empty);
+	apr_thread_cond_broadcast(queue->not_full);
+	apr_thread_mutex_unlock(queue->mutex);
+
+	return APR_SUCCESS;
+}
+
 AGC_DECLARE(int) agc_vasprintf(char **ret, const char *fmt, va_list ap)
 {
 #ifdef HAVE_VASPRINTF
@@ -1,18 +1,19 @@
 #include <agc.h>
 
-#define LIMIT_CONNECTIONS 1000000
+/* ids are reserved CONNECTION_ID_BATCH at a time per thread, the 64 bit space does not wrap */
+#define CONNECTION_ID_BATCH 64
 
-static int genid = 0;
-static agc_mutex_t *GENID_MUTEX = NULL;
+static volatile uint64_t genid = 0;
+static __thread uint64_t genid_next = 0;
+static __thread uint64_t genid_end = 0;
 static agc_memory_pool_t *RUNTIME_POOL = NULL;
 
-static int next_id();
+static uint64_t next_id();
 
 AGC_DECLARE(agc_status_t) agc_conn_init(agc_memory_pool_t *pool)
 {
 	assert(pool);
 	RUNTIME_POOL = pool;
-	agc_mutex_init(&GENID_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
 
 	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Connection init success.\n");
 
@@ -146,15 +147,12 @@ AGC_DECLARE(void) agc_free_connection(agc_connection_t *c)
 	agc_memory_destroy_pool(&c->pool);
 }
 
-static int next_id()
+static uint64_t next_id()
 {
-	int nextid = 0;
+	if (genid_next == genid_end) {
+		genid_next = agc_fetch_add(&genid, CONNECTION_ID_BATCH);
+		genid_end = genid_next + CONNECTION_ID_BATCH;
+	}
 
-	agc_mutex_lock(GENID_MUTEX);
-	if (genid > LIMIT_CONNECTIONS)
-		genid = 0;
-	nextid = genid++;
-	agc_mutex_unlock(GENID_MUTEX);
-
-	return nextid;
+	return genid_next++;
 }
\ No newline at end of file
@@ -11,6 +11,16 @@ struct agc_runtime runtime = { 0 };
 
 static void agc_load_config();
 
+static char **agc_core_thread_key(const char *key);
+
+static int agc_core_parse_cpus(const char *list, cpu_set_t *set);
+
+static int agc_core_node_cpus(const char *nodes, cpu_set_t *set);
+
+/* config keys are <role>_cpus and <role>_nodes, threads are named <name>-<index> */
+static const char *THREAD_ROLES[AGC_THREAD_ROLE_MAX] = { "dispatcher", "epoll", "timer", "log", "pool" };
+static const char *THREAD_NAMES[AGC_THREAD_ROLE_MAX] = { "agc-disp", "agc-epoll", "agc-timer", "agc-log", "agc-pool" };
+
 AGC_DECLARE(agc_status_t) agc_core_init(agc_bool_t console, const char **err)
 {
 	agc_uuid_t uuid;
@@ -21,6 +31,7 @@ AGC_DECLARE(agc_status_t) agc_core_init(agc_bool_t console, const char **err)
 	runtime.hard_log_level = AGC_LOG_CRIT;
 	runtime.max_db_handles = 50;
 	runtime.db_handle_timeout = 5000000;
+	runtime.event_spin_count = -1;
     
 	//initial random
 	srand(time(NULL));
@@ -53,6 +64,9 @@ AGC_DECLARE(agc_status_t) agc_core_init(agc_bool_t console, const char **err)
 
 	//load config file
 	agc_load_config();
+
+	// the pool thread started before the config was read
+	agc_core_memory_place();
     
 	//init log 
 	if (agc_log_init(runtime.memory_pool, AGC_FALSE) != AGC_STATUS_SUCCESS) {
@@ -314,6 +328,169 @@ AGC_DECLARE(agc_thread_t *) agc_core_launch_thread(agc_thread_start_t func, void
 	return thread;
 }
 
+AGC_DECLARE(agc_status_t) agc_core_thread_place(agc_thread_role_t role, int index)
+{
+	return agc_core_thread_place_id(pthread_self(), role, index);
+}
+
+agc_status_t agc_core_thread_place_id(pthread_t tid, agc_thread_role_t role, int index)
+{
+	char name[16];
+	cpu_set_t set, nodes;
+	int count, cpu, nth;
+
+	if (role < 0 || role >= AGC_THREAD_ROLE_MAX) {
+		return AGC_STATUS_GENERR;
+	}
+
+	// names are cut to 15 characters by the kernel
+	if (index >= 0) {
+		snprintf(name, sizeof(name), "%s-%d", THREAD_NAMES[role], index);
+	} else {
+		snprintf(name, sizeof(name), "%s", THREAD_NAMES[role]);
+	}
+	pthread_setname_np(tid, name);
+
+	CPU_ZERO(&set);
+	agc_core_parse_cpus(runtime.thread_cpus[role], &set);
+
+	if (agc_core_node_cpus(runtime.thread_nodes[role], &nodes)) {
+		if (CPU_COUNT(&set)) {
+			CPU_AND(&set, &set, &nodes);
+			if (!CPU_COUNT(&set)) {
+				agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "No cpu of %s_cpus is on %s_nodes, thread %s is not bound.\n", 
+							   THREAD_ROLES[role], THREAD_ROLES[role], name);
+			}
+		} else {
+			memcpy(&set, &nodes, sizeof(set));
+		}
+	}
+
+	if (!(count = CPU_COUNT(&set))) {
+		// nothing configured, the scheduler places it
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (index >= 0) {
+		nth = index % count;
+		for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (CPU_ISSET(cpu, &set) && nth-- == 0) {
+				break;
+			}
+		}
+		CPU_ZERO(&set);
+		CPU_SET(cpu, &set);
+	}
+
+	if (pthread_setaffinity_np(tid, sizeof(set), &set) != 0) {
+		agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Bind thread %s to cpus failed.\n", name);
+		return AGC_STATUS_GENERR;
+	}
+
+	return AGC_STATUS_SUCCESS;
+}
+
+static char **agc_core_thread_key(const char *key)
+{
+	size_t len;
+	int role;
+
+	for (role = 0; role < AGC_THREAD_ROLE_MAX; role++) {
+		len = strlen(THREAD_ROLES[role]);
+		if (strncmp(key, THREAD_ROLES[role], len) || key[len] != '_') {
+			continue;
+		}
+
+		if (!strcmp(key + len + 1, "cpus")) {
+			return &runtime.thread_cpus[role];
+		} else if (!strcmp(key + len + 1, "nodes")) {
+			return &runtime.thread_nodes[role];
+		}
+	}
+
+	return NULL;
+}
+
+/* add a list like 0-3,8 to set, return the number of cpus added */
+static int agc_core_parse_cpus(const char *list, cpu_set_t *set)
+{
+	const char *ptr = list;
+	char *end;
+	long first, last;
+	int count = 0;
+
+	while (ptr && *ptr) {
+		if (*ptr == ',' || *ptr == ' ' || *ptr == '\n') {
+			ptr++;
+			continue;
+		}
+
+		first = strtol(ptr, &end, 10);
+		if (end == ptr) {
+			break;
+		}
+
+		last = first;
+		if (*end == '-') {
+			ptr = end + 1;
+			last = strtol(ptr, &end, 10);
+			if (end == ptr) {
+				break;
+			}
+		}
+		ptr = end;
+
+		for (; first <= last && first < CPU_SETSIZE; first++) {
+			if (first >= 0) {
+				CPU_SET(first, set);
+				count++;
+			}
+		}
+	}
+
+	return count;
+}
+
+/* the cpus of a list of numa nodes, as the kernel lists them */
+static int agc_core_node_cpus(const char *nodes, cpu_set_t *set)
+{
+	cpu_set_t node_set;
+	char path[128];
+	char cpulist[4096];
+	int count = 0;
+	long node;
+	FILE *file;
+
+	CPU_ZERO(set);
+	if (!nodes || !*nodes) {
+		return 0;
+	}
+
+	CPU_ZERO(&node_set);
+	if (!agc_core_parse_cpus(nodes, &node_set)) {
+		return 0;
+	}
+
+	for (node = 0; node < CPU_SETSIZE; node++) {
+		if (!CPU_ISSET(node, &node_set)) {
+			continue;
+		}
+
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%ld/cpulist", node);
+		if (!(file = fopen(path, "r"))) {
+			agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Numa node %ld not found.\n", node);
+			continue;
+		}
+
+		if (fgets(cpulist, sizeof(cpulist), file)) {
+			count += agc_core_parse_cpus(cpulist, set);
+		}
+		fclose(file);
+	}
+
+	return count;
+}
+
 AGC_DECLARE(void) agc_cond_next(void)
 {
 	apr_sleep(1000);
@@ -391,7 +568,9 @@ static void agc_load_config()
 	int iskey = 0;
 	char *filepath = NULL;
 	char **datap = NULL;
+	int *intp = NULL;
 	const char *err;
+	const char *scalar;
 
 	runtime.core_config_file = agc_core_sprintf(runtime.memory_pool, "%s%s%s", AGC_GLOBAL_dirs.conf_dir, AGC_PATH_SEPARATOR, CORE_CONFIG_FILE);
 	if (!runtime.core_config_file)
@@ -418,17 +597,49 @@ static void agc_load_config()
 				break;
 			case YAML_SCALAR_TOKEN:
 				{
+					scalar = (const char *) token.data.scalar.value;
 					if (iskey)
 					{
-						if (strcmp(token.data.scalar.value, "odbc_dsn") == 0)
+						datap = NULL;
+						intp = NULL;
+
+						if (strcmp(scalar, "odbc_dsn") == 0)
 						{
 							datap = &runtime.odbc_dsn;
-						}  else {
-							datap = NULL;
+						} else if (strcmp(scalar, "event_wait_mode") == 0) {
+							datap = &runtime.event_wait_mode;
+						} else if (strcmp(scalar, "event_queue_type") == 0) {
+							datap = &runtime.event_queue_type;
+						} else if (strcmp(scalar, "event_overflow_policy") == 0) {
+							datap = &runtime.event_overflow_policy;
+						} else if (strcmp(scalar, "event_priority_weights") == 0) {
+							datap = &runtime.event_priority_weights;
+						} else if (strcmp(scalar, "event_spin_count") == 0) {
+							intp = &runtime.event_spin_count;
+						} else if (strcmp(scalar, "event_batch_size") == 0) {
+							intp = &runtime.event_batch_size;
+						} else if (strcmp(scalar, "event_fast_cache_size") == 0) {
+							intp = &runtime.event_fast_cache_size;
+						} else if (strcmp(scalar, "event_fast_low_water") == 0) {
+							intp = &runtime.event_fast_low_water;
+						} else if (strcmp(scalar, "event_fast_high_water") == 0) {
+							intp = &runtime.event_fast_high_water;
+						} else if (strcmp(scalar, "event_json_max_size") == 0) {
+							intp = &runtime.event_json_max_size;
+						} else if (strcmp(scalar, "event_spill_limit") == 0) {
+							intp = &runtime.event_spill_limit;
+						} else if (strcmp(scalar, "event_dispatchers") == 0) {
+							intp = &runtime.event_dispatchers;
+						} else if (strcmp(scalar, "event_dispatchers_max") == 0) {
+							intp = &runtime.event_dispatchers_max;
+						} else {
+							datap = agc_core_thread_key(scalar);
 						}
 					} else {
 						if (datap) {
-							*datap = agc_core_strdup(runtime.memory_pool, token.data.scalar.value);
+							*datap = agc_core_strdup(runtime.memory_pool, scalar);
+						} else if (intp) {
+							*intp = atoi(scalar);
 						}
 					}
 				}
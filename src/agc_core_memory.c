@@ -6,12 +6,14 @@ static struct {
 	agc_queue_t *pool_recycle_queue;
 	agc_memory_pool_t *memory_pool;
 	int pool_thread_running;
+	pthread_t pool_tid;
 } memory_manager;
 
 static agc_thread_t *pool_thread_p = NULL;
 
 static void *pool_thread(agc_thread_t *thread, void *obj)
 {
+	memory_manager.pool_tid = pthread_self();
 	memory_manager.pool_thread_running = 1;
 	while (memory_manager.pool_thread_running == 1) {
 		int len = agc_queue_size(memory_manager.pool_queue);
@@ -180,3 +182,9 @@ AGC_DECLARE(void *) agc_memory_permanent_alloc(agc_size_t memsize)
     return ptr;   
 }
 
+void agc_core_memory_place(void)
+{
+	if (memory_manager.pool_thread_running) {
+		agc_core_thread_place_id(memory_manager.pool_tid, AGC_THREAD_POOL, -1);
+	}
+}
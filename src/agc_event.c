@@ -1,4 +1,5 @@
 #include <agc.h>
+#include "private/agc_core_pvt.h"
 
 struct agc_event_node {
 	/*! the id of the node */
@@ -9,43 +10,510 @@ struct agc_event_node {
 	agc_event_callback_func callback;
 	/*! private data */
 	void *user_data;
+	/*! callback time, one histogram per dispatcher */
+	agc_event_latency_t *latency;
+	/*! only the events matching it are delivered, NULL for all */
+	agc_event_filter_t *filter;
+	/*! the queue and workers of an async subscriber, NULL to be called by the dispatchers */
+	struct event_lane *lane;
 	struct agc_event_node *next;
 };
 
+#define EVENT_LANE_QUEUE_DEFAULT 4096
+#define EVENT_LANE_WORKERS_LIMIT 16
+/*! microseconds a dispatcher waits for room in a full lane before it looks at the stop again */
+#define EVENT_LANE_BLOCK_WAIT 10000
+
+struct event_lane {
+	agc_memory_pool_t *pool;
+	agc_queue_t *queue;
+	agc_event_overflow_t overflow;
+	agc_event_node_t *node;
+	int workers;
+	agc_thread_t *threads[EVENT_LANE_WORKERS_LIMIT];
+	volatile int started;
+	/*! set on unbind, the dispatchers drop instead of waiting */
+	volatile int stopping;
+	/*! the workers are joined, the lane is freed with its node */
+	volatile int stopped;
+	/*! fire to callback and callback time, one histogram per worker */
+	agc_event_latency_t *delay;
+	agc_event_latency_t *latency;
+	volatile uint64_t queued;
+	volatile uint64_t dropped;
+	volatile uint64_t blocked;
+	volatile uint64_t blocked_us;
+	uint32_t high_water;
+};
+
+typedef struct event_lane event_lane_t;
+
+/*! the lane a worker thread serves */
+static __thread event_lane_t *EVENT_LANE_SELF = NULL;
+
+/* pending requests, sharded by correlation id, each shard a chained hash */
+#define EVENT_REQUEST_SHARDS 64
+#define EVENT_REQUEST_BUCKETS 256
+
+typedef struct event_request event_request_t;
+
+struct event_request {
+	uint64_t id;
+	/*! the requester's source, its dispatcher runs the callback */
+	uint64_t source;
+	agc_event_reply_func callback;
+	void *data;
+	/*! one for the table and one for the timeout event, the last release frees it */
+	volatile uint32_t refs;
+	event_request_t *next;
+};
+
+typedef struct event_request_shard {
+	agc_mutex_t *mutex;
+	event_request_t *buckets[EVENT_REQUEST_BUCKETS];
+} event_request_shard_t;
+
+struct event_filter_term {
+	uint32_t atom;
+	agc_event_filter_op_t op;
+	/*! one value, EVENT_FILTER_IN keeps them sorted and unique */
+	int count;
+	char **values;
+	size_t *lens;
+};
+
+typedef struct event_filter_term event_filter_term_t;
+
+struct agc_event_filter {
+	int count;
+	event_filter_term_t *terms;
+	/*! the equals or in term the subscriber is indexed by, -1 if there is none */
+	int key;
+	/*! set once a node owns it, the dispatchers read it without lock from then on */
+	volatile int bound;
+};
+
+/* an indexed subscriber, one entry per value of its key term */
+struct event_filter_entry {
+	uint32_t atom;
+	uint32_t hash;
+	const char *value;
+	agc_event_node_t *node;
+};
+
+typedef struct event_filter_entry event_filter_entry_t;
+
 struct fast_event_node {
 	agc_event_header_t **headers;
+	/*! size of the name buffer of each slot */
+	int *name_sizes;
 	int type;
 	int header_numbers;
 };
 
 typedef struct fast_event_node fast_event_node_t;
 
+/*
+ * Fast events of a type are kept in a shared ring, each thread keeps a small cache of them
+ * in front of it. When the ring is empty new events are created from the template,
+ * when it is full (above the high water mark) released events are freed.
+ */
+#define FAST_EVENT_CACHE_DEFAULT 32
+#define FAST_EVENT_CACHE_LIMIT 128
+#define FAST_EVENT_LOW_WATER_DEFAULT 25
+#define FAST_EVENT_HIGH_WATER_DEFAULT 400
+
+struct fast_event_pool {
+	int type;
+	agc_queue_t *queue;
+	/*! template of new events */
+	int event_id;
+	char **headers;
+	int *valuelengths;
+	int header_numbers;
+	int bodylength;
+	/*! grow to low_water when the ring runs dry, never keep more than high_water */
+	uint32_t low_water;
+	uint32_t high_water;
+	/*! the ring is sized once, for the first high water mark */
+	uint32_t queue_size;
+	volatile uint32_t total;
+	agc_event_fast_stats_t stats;
+};
+
+typedef struct fast_event_pool fast_event_pool_t;
+
+struct fast_event_cache {
+	int count[EVENT_FAST_TYPE_Invalid];
+	/*! allocs and releases not yet added to the pool stats */
+	uint32_t allocs[EVENT_FAST_TYPE_Invalid];
+	uint32_t releases[EVENT_FAST_TYPE_Invalid];
+	agc_event_t **events[EVENT_FAST_TYPE_Invalid];
+};
+
+typedef struct fast_event_cache fast_event_cache_t;
+
+struct event_writer {
+	char *buf;
+	agc_size_t size;
+	/*! the length written so far, keeps counting past the end of a small buffer */
+	agc_size_t len;
+};
+
+typedef struct event_writer event_writer_t;
+
+/* immutable snapshot of the subscribers of one event id, replaced as a whole on bind/unbind */
+struct event_subscribers {
+	/*! the indexed subscribers sorted by atom and value hash, and the distinct atoms */
+	int entry_count;
+	event_filter_entry_t *entries;
+	int atom_count;
+	uint32_t *atoms;
+	/*! subscribers with a lane, they are queued to after the others were called */
+	int lanes;
+	/*! subscribers without a filter or with one that can not be indexed */
+	int count;
+	agc_event_node_t *nodes[];
+};
+
+typedef struct event_subscribers event_subscribers_t;
+
+/* snapshot or node waiting for every dispatcher to pass a quiescent state */
+struct event_retired {
+	uint64_t epoch;
+	event_subscribers_t *subs;
+	agc_event_node_t *node;
+	struct event_retired *next;
+};
+
+typedef struct event_retired event_retired_t;
+
+/* header name interning, slots are never removed so readers go without lock */
+#define EVENT_ATOM_LIMIT 4096
+#define EVENT_ATOM_SLOTS (EVENT_ATOM_LIMIT * 2)
+#define EVENT_INDEX_THRESHOLD 8
+
+struct event_atom_slot {
+	volatile uint32_t atom;
+	uint32_t hash;
+	char *name;
+};
+
+typedef struct event_atom_slot event_atom_slot_t;
+
+/*
+ * A normal event is one malloc block: the agc_event_t, this arena, then the headers,
+ * names, values and body. When the block is full a chunk twice as big is chained,
+ * replaced values and deleted headers stay in the arena until the event is destroyed.
+ */
+/* only the holders of an event retain it, a sole holder can drop it without an atomic */
+#define EVENT_SHARED(e) (agc_load_acquire(&(e)->refs) > 1)
+
+#define EVENT_ARENA_SIZE 1024
+#define EVENT_ARENA_ALIGN(size) (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+struct event_arena_chunk {
+	struct event_arena_chunk *next;
+};
+
+struct event_arena {
+	char *pos;
+	char *end;
+	/*! size of the last block, the next chunk is at least twice as big */
+	size_t size;
+	/*! chained chunks, freed with the event */
+	struct event_arena_chunk *chunks;
+};
+
+typedef struct event_arena event_arena_t;
+
+typedef enum {
+	EVENT_WAIT_POLL,
+	EVENT_WAIT_BLOCK
+} event_wait_mode_t;
+
+typedef struct event_latency_stats {
+	agc_event_latency_t queue_delay;
+	agc_event_latency_t handle;
+	/*! dropped for their deadline */
+	uint64_t expired;
+} event_latency_stats_t;
+
+typedef struct event_priority_class {
+	/*! the queue of the class, EVENT_PRIORITY_NORMAL uses queue and unordered instead */
+	agc_queue_t *queue;
+	/*! fire to delivery, written by the dispatcher */
+	agc_event_latency_t delay;
+	uint32_t high_water;
+	/*! batches in a row the class had events and got none */
+	uint32_t waiting;
+	uint64_t starved;
+	/*! events of the sources moving in with a resize, put aside by the dispatcher until it ends */
+	agc_event_t *held_head;
+	agc_event_t *held_tail;
+	volatile uint32_t held_count;
+} event_priority_class_t;
+
+/* EVENT_OVERFLOW_DROP_OLDEST: count queued events of a source and id older than before are dropped */
+typedef struct event_evict {
+	int event_id;
+	uint64_t source_id;
+	agc_time_t before;
+	uint32_t count;
+} event_evict_t;
+
+#define EVENT_EVICT_SLOTS 16
+
+/* events which did not fit in a queue, linked by next and moved back as it drains */
+typedef struct event_spill_list {
+	/*! the queue they go back to */
+	agc_queue_t *queue;
+	agc_event_t *head;
+	agc_event_t *tail;
+	volatile uint32_t count;
+	/*! the events of the queue to drop for the ones spilled with EVENT_OVERFLOW_DROP_OLDEST, evicting slots used */
+	event_evict_t evict[EVENT_EVICT_SLOTS];
+	volatile uint32_t evicting;
+} event_spill_list_t;
+
+/*! a spill list per class queue, and one for the unordered queue */
+#define EVENT_SPILL_UNORDERED EVENT_PRIORITY_CLASSES
+#define EVENT_SPILL_LISTS (EVENT_PRIORITY_CLASSES + 1)
+
+struct event_dispatcher {
+	/*! the index of the dispatcher */
+	int index;
+	/*! the queue of events to deliver, events of a source keep their order in it */
+	agc_queue_t *queue;
+	/*! events without a source id, idle dispatchers steal from it */
+	agc_queue_t *unordered;
+	agc_thread_t *thread;
+	agc_thread_id_t tid;
+	uint8_t running;
+	/*! last epoch observed outside delivery, 0 while parked */
+	volatile uint64_t rcu_epoch;
+	/*! set while the dispatcher is parked on cond */
+	volatile int sleeping;
+	agc_mutex_t *mutex;
+	agc_thread_cond_t *cond;
+	/*! current adaptive spin budget before parking */
+	int spin;
+	/*! events drained in one wakeup */
+	void **batch;
+	agc_event_dispatch_stats_t stats;
+	/*! spilled events by the queue they belong to, spill_count of them in all */
+	agc_mutex_t *spill_mutex;
+	event_spill_list_t spills[EVENT_SPILL_LISTS];
+	volatile uint32_t spill_count;
+	/*! queue delay and handle time per event id, allocated by the dispatcher on first delivery */
+	event_latency_stats_t *latency[EVENT_ID_LIMIT];
+	/*! overflow counters, written by the producers */
+	volatile uint64_t dropped;
+	volatile uint64_t spilled;
+	volatile uint64_t blocked;
+	volatile uint64_t blocked_us;
+	/*! producers pushing with the current dispatcher count, a resize waits for them */
+	volatile uint32_t inflight;
+	/*! set while the sources moving in are drained by their old dispatcher, their events wait */
+	volatile int hold;
+	/*! removed by a resize, the thread ends once its queues are empty */
+	volatile int retiring;
+	event_priority_class_t classes[EVENT_PRIORITY_CLASSES];
+	/*! the starved class the next pop takes first, -1 for none */
+	int boost;
+};
+
+typedef struct event_dispatcher event_dispatcher_t;
+
 static volatile int SYSTEM_RUNNING = 0;
 static int DISPATCH_THREAD_COUNT = 0;
 static agc_memory_pool_t *RUNTIME_POOL = NULL;
-static unsigned int MAX_DISPATCHER = 64;
+/*! dispatchers in use, sources are mapped over them */
+static volatile unsigned int MAX_DISPATCHER = 64;
+/*! slots of EVENT_DISPATCHERS, the pool grows up to it at runtime */
+static unsigned int DISPATCH_CAPACITY = 0;
+/*! slots set up so far, they are set up in order and never torn down */
+static volatile unsigned int DISPATCH_SLOTS = 0;
+static agc_mutex_t *DISPATCH_RESIZE_MUTEX = NULL;
+/*! fences queued by a resize and not delivered yet */
+static volatile uint32_t DISPATCH_FENCES = 0;
+/*! dispatcher counts of the running resize, a source is moving when it maps differently */
+static volatile unsigned int DISPATCH_RESIZE_FROM = 0;
+static volatile unsigned int DISPATCH_RESIZE_TO = 0;
+#define DISPATCH_LIMIT 256
 #define DISPATCH_QUEUE_LIMIT 10000
-static uint32_t EVENT_SOURCE_ID = 0;
-static agc_mutex_t *SOURCEID_MUTEX = NULL;
+#define DISPATCH_SPIN_DEFAULT 200
+#define DISPATCH_SPIN_LIMIT 10000
+#define DISPATCH_BATCH_DEFAULT 64
+#define DISPATCH_BATCH_LIMIT 1024
+static event_wait_mode_t DISPATCH_WAIT_MODE = EVENT_WAIT_BLOCK;
+static agc_queue_type_t DISPATCH_QUEUE_TYPE = AGC_QUEUE_RING;
+static int DISPATCH_SPIN_MAX = DISPATCH_SPIN_DEFAULT;
+static int DISPATCH_BATCH_SIZE = DISPATCH_BATCH_DEFAULT;
+/*! parked dispatchers, producers of unordered events wake one of them to steal */
+static volatile uint32_t DISPATCH_SLEEPERS = 0;
+/*! agc_event_fire_batch groups this many events at a time */
+#define DISPATCH_FIRE_BATCH 256
+#define DISPATCH_SPILL_DEFAULT 100000
+static uint32_t DISPATCH_SPILL_LIMIT = DISPATCH_SPILL_DEFAULT;
+static uint8_t EVENT_OVERFLOW_POLICY[EVENT_ID_LIMIT];
+static uint8_t EVENT_PRIORITY[EVENT_ID_LIMIT];
+/*! batch shares of the priority classes */
+static volatile int DISPATCH_WEIGHTS[EVENT_PRIORITY_CLASSES] = { 8, 4, 1 };
+#define DISPATCH_WEIGHT_LIMIT 1000
+/*! batches a class with events may go without a slot, then the next pop takes it first */
+#define DISPATCH_STARVE_ROUNDS 4
+#define EVENT_JSON_MAX_DEFAULT (1024 * 1024)
+#define EVENT_BINARY_TEXT_SIZE 24
+static agc_size_t EVENT_JSON_MAX = EVENT_JSON_MAX_DEFAULT;
+/* threads reserve source ids EVENT_SOURCE_BATCH at a time and hand them out without atomics */
+#define EVENT_SOURCE_BATCH 64
+static volatile uint64_t EVENT_SOURCE_ID = 0;
+static __thread uint64_t EVENT_SOURCE_NEXT = 0;
+static __thread uint64_t EVENT_SOURCE_END = 0;
 static agc_mutex_t *EVENTSTATE_MUTEX = NULL;
 
 static agc_thread_rwlock_t *EVENT_TEMPLATES_RWLOCK = NULL;
 static char *event_templates[EVENT_ID_LIMIT] = { NULL };
+/*
+ * Case insensitive name index, open addressed, a slot holds the event id + 1.
+ * Names are never unregistered, so readers go without the lock: a writer
+ * publishes the name before the slot that points to it.
+ */
+#define EVENT_NAME_SLOTS (EVENT_ID_LIMIT * 2)
+static volatile uint16_t EVENT_NAME_INDEX[EVENT_NAME_SLOTS];
+
+static event_dispatcher_t *EVENT_DISPATCHERS = NULL;
+
+static fast_event_pool_t **FAST_EVENT_POOLS = NULL;
+static int FAST_EVENT_CACHE_SIZE = FAST_EVENT_CACHE_DEFAULT;
+static int FAST_EVENT_LOW_WATER = FAST_EVENT_LOW_WATER_DEFAULT;
+static int FAST_EVENT_HIGH_WATER = FAST_EVENT_HIGH_WATER_DEFAULT;
+static pthread_key_t FAST_EVENT_CACHE_KEY;
+static __thread fast_event_cache_t *FAST_EVENT_CACHE = NULL;
+
+/* EVENT_NODES is the writers' list, dispatchers only read EVENT_SUBSCRIBERS */
+static agc_mutex_t *EVENT_NODES_MUTEX = NULL;
+static agc_event_node_t *EVENT_NODES[EVENT_ID_LIMIT] = { NULL };
+static event_subscribers_t *EVENT_SUBSCRIBERS[EVENT_ID_LIMIT] = { NULL };
+static volatile uint64_t RCU_EPOCH = 1;
+static event_retired_t *RCU_RETIRED = NULL;
+static volatile uint32_t RCU_RETIRED_COUNT = 0;
+
+static event_atom_slot_t EVENT_ATOMS[EVENT_ATOM_SLOTS];
+/*! the name of each atom, for the headers added before their name was interned */
+static const char *EVENT_ATOM_NAMES[EVENT_ATOM_LIMIT + 1];
+static uint32_t EVENT_ATOM_COUNT = 0;
+static volatile int EVENT_ATOM_FULL = 0;
+static agc_mutex_t *EVENT_ATOM_MUTEX = NULL;
+
+static agc_event_callback_func EVENT_EXPIRY_CALLBACK[EVENT_ID_LIMIT] = { NULL };
+
+static event_request_shard_t EVENT_REQUESTS[EVENT_REQUEST_SHARDS];
+static volatile uint64_t EVENT_REQUEST_ID = 0;
+/*! the dispatchers look for replies only while a request is pending */
+static volatile uint32_t EVENT_REQUESTS_PENDING = 0;
+static volatile uint64_t EVENT_REQUESTS_TIMEOUT = 0;
 
-static agc_queue_t **EVENT_DISPATCH_QUEUES = NULL;
-static agc_thread_t **EVENT_DISPATCH_THREADS = NULL;
-static uint8_t *EVENT_DISPATCH_QUEUE_RUNNING = NULL;
+static void *agc_event_dispatch_thread(agc_thread_t *thread, void *obj);
 
-static agc_queue_t **FAST_EVENT_QUEUES = NULL;
+static void agc_event_deliver(event_dispatcher_t *dispatcher, agc_event_t **event);
 
-static agc_thread_rwlock_t *EVENT_NODES_RWLOCK = NULL;
-static agc_event_node_t *EVENT_NODES[EVENT_ID_LIMIT] = { NULL };
+static inline void event_latency_add(agc_event_latency_t *latency, agc_time_t elapsed);
 
-static void agc_event_launch_dispatch_threads();
+static void event_latency_merge(agc_event_latency_t *to, const agc_event_latency_t *from);
 
-static void *agc_event_dispatch_thread(agc_thread_t *thread, void *obj);
+static void agc_event_dispatch_batch(event_dispatcher_t *dispatcher, unsigned int count);
+
+static agc_status_t agc_event_fire_ex(agc_event_t **event, int priority, agc_bool_t wait);
+
+static agc_status_t agc_event_enqueue(event_dispatcher_t *dispatcher, agc_queue_t *queue, agc_event_t **event, agc_bool_t wait);
+
+static agc_status_t agc_event_fire_group(int target, unsigned int count, agc_event_t **group, int n);
+
+static inline agc_status_t agc_event_dispatch_pop(event_dispatcher_t *dispatcher, void **pop);
+
+static agc_status_t agc_event_steal(event_dispatcher_t *dispatcher, void **pop);
+
+static void agc_event_wakeup_idle(void);
+
+static inline unsigned int agc_event_dispatch_index(uint64_t source_id, unsigned int buckets);
+
+static void agc_event_dispatcher_setup(event_dispatcher_t *dispatcher, int index);
+
+static void agc_event_launch_dispatch_thread(event_dispatcher_t *dispatcher);
 
-static void agc_event_deliver(agc_event_t **event);
+static inline agc_bool_t agc_event_dispatch_idle(event_dispatcher_t *dispatcher);
+
+static void agc_event_fence_push(event_dispatcher_t *dispatcher);
+
+static void agc_event_fence_pass(void *data);
+
+static agc_status_t agc_event_spill(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t **event);
+
+static event_spill_list_t *agc_event_spill_list(event_dispatcher_t *dispatcher, agc_queue_t *queue);
+
+static void agc_event_spill_append(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t *event);
+
+static void agc_event_unspill(event_dispatcher_t *dispatcher);
+
+static agc_status_t agc_event_spill_evict(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t **event);
+
+static agc_bool_t agc_event_evicted(event_dispatcher_t *dispatcher, agc_event_t *event);
+
+static agc_status_t agc_event_dispatch_wait(event_dispatcher_t *dispatcher, void **pop);
+
+static unsigned int agc_event_dispatch_fill(event_dispatcher_t *dispatcher, unsigned int count);
+
+static unsigned int agc_event_class_pop_bulk(event_dispatcher_t *dispatcher, int priority, void **events, unsigned int max);
+
+static unsigned int agc_event_class_depth(event_dispatcher_t *dispatcher, int priority);
+
+static inline void agc_event_dispatch_wakeup(event_dispatcher_t *dispatcher);
+
+static void agc_event_publish_subscribers(int event_id);
+
+static void event_name_index(int event_id);
+
+static void agc_event_deliver_subscribers(event_dispatcher_t *dispatcher, event_subscribers_t *subs, agc_event_t *event, agc_time_t *now, agc_bool_t lanes);
+
+static event_lane_t *agc_event_lane_create(agc_event_node_t *node, const agc_event_lane_options_t *options);
+
+static void agc_event_lane_push(event_lane_t *lane, agc_event_t *event);
+
+static void *agc_event_lane_thread(agc_thread_t *thread, void *obj);
+
+static void agc_event_lane_stop(event_lane_t *lane);
+
+static void agc_event_lane_drain(event_lane_t *lane);
+
+static void agc_event_lane_destroy(event_lane_t *lane);
+
+static event_request_t *agc_event_request_remove(uint64_t id, agc_event_t *reply);
+
+static void agc_event_request_release(event_request_t *request);
+
+static void agc_event_request_expire(void *data);
+
+static agc_bool_t agc_event_request_reply(agc_event_t **event);
+
+static void agc_event_request_sweep(void);
+
+static void agc_event_strip_ingress(agc_event_t *event);
+
+static inline uint32_t event_filter_hash(const char *value);
+
+static int event_filter_entry_cmp(const void *a, const void *b);
+
+static void agc_event_retire(event_subscribers_t *subs, agc_event_node_t *node, uint64_t epoch);
+
+static void agc_event_reclaim(agc_bool_t wait);
+
+static agc_bool_t agc_event_on_dispatcher(void);
+
+static inline void agc_event_rcu_online(event_dispatcher_t *dispatcher);
+
+static inline void agc_event_rcu_offline(event_dispatcher_t *dispatcher);
 
 static agc_status_t agc_event_base_add_header(agc_event_t *event, const char *header_name, char *data);
 
@@ -53,7 +521,63 @@ static agc_status_t agc_event_base_add_header_nocheck(agc_event_t *event, const
 
 static agc_event_header_t *agc_event_get_header_ptr(agc_event_t *event, const char *header_name);
 
-static agc_event_header_t *new_header(const char *header_name);
+static agc_event_header_t *new_header(agc_event_t *event, const char *header_name);
+
+static agc_event_header_t *new_header_inplace(agc_event_t *event, char *header_name);
+
+static agc_status_t event_create_sized(agc_event_t **event, int event_id, uint64_t source_id, size_t size);
+
+static void *event_arena_alloc(agc_event_t *event, size_t size);
+
+static void event_arena_unalloc(agc_event_t *event, void *ptr, size_t size);
+
+static char *event_arena_strdup(agc_event_t *event, const char *str);
+
+static char *event_arena_vprintf(agc_event_t *event, const char *fmt, va_list ap);
+
+static const char *event_header_text(agc_event_header_t *header);
+
+static agc_event_header_t *fast_set_header(agc_event_t *event, int index, const char *name, agc_event_header_type_t type);
+
+static agc_status_t fast_get_native(agc_event_t *event, int index, int64_t *value);
+
+static void event_json_write(event_writer_t *writer, agc_event_t *event);
+
+static void event_binary_write(event_writer_t *writer, agc_event_t *event);
+
+static inline uint32_t event_get_u32(const unsigned char *ptr);
+
+static inline char *event_json_skip(char *str);
+
+static char *event_json_string(char *str, char **out);
+
+static char *event_json_skip_value(char *str);
+
+static agc_status_t event_json_field(agc_event_t *event, char *name, char *value);
+
+static fast_event_cache_t *fast_cache_get(void);
+
+static void fast_cache_destroy(void *data);
+
+static void fast_cache_flush(fast_event_cache_t *cache, fast_event_pool_t *pool, int keep);
+
+static agc_event_t *fast_pool_grow(fast_event_pool_t *pool, agc_event_t **events, int count);
+
+static void fast_event_free(agc_event_t *event);
+
+static inline uint32_t event_atom_hash(const char *header_name);
+
+static uint32_t event_atom_lookup(const char *header_name, uint32_t hash);
+
+static agc_event_header_t *event_find_header(agc_event_t *event, uint32_t atom);
+
+static agc_event_header_t *event_find_loose_header(agc_event_t *event, const char *header_name);
+
+static void event_index_add(agc_event_t *event, agc_event_header_t *header);
+
+static void event_index_rebuild(agc_event_t *event);
+
+static void event_link_header(agc_event_t *event, agc_event_header_t *header);
 
 static void init_ids();
 
@@ -71,42 +595,151 @@ AGC_DECLARE(agc_status_t) agc_event_init(agc_memory_pool_t *pool)
 	assert(pool != NULL);
     
 	MAX_DISPATCHER = (2 * agc_core_cpu_count())  + 1;
+	if (runtime.event_dispatchers > 0) {
+		MAX_DISPATCHER = runtime.event_dispatchers > DISPATCH_LIMIT ? DISPATCH_LIMIT : runtime.event_dispatchers;
+	}
+
 	if (MAX_DISPATCHER < 2) {
 		MAX_DISPATCHER = 2;
 	}
+
+	// room to grow online, twice the initial count unless configured
+	DISPATCH_CAPACITY = runtime.event_dispatchers_max > 0 ? runtime.event_dispatchers_max : 2 * MAX_DISPATCHER;
+	if (DISPATCH_CAPACITY < MAX_DISPATCHER) {
+		DISPATCH_CAPACITY = MAX_DISPATCHER;
+	}
+
+	if (DISPATCH_CAPACITY > DISPATCH_LIMIT) {
+		DISPATCH_CAPACITY = DISPATCH_LIMIT;
+	}
     
 	RUNTIME_POOL = pool;
+
+	if (runtime.event_wait_mode && !strcasecmp(runtime.event_wait_mode, "poll")) {
+		DISPATCH_WAIT_MODE = EVENT_WAIT_POLL;
+	} else {
+		DISPATCH_WAIT_MODE = EVENT_WAIT_BLOCK;
+	}
+
+	if (runtime.event_queue_type && !strcasecmp(runtime.event_queue_type, "apr")) {
+		DISPATCH_QUEUE_TYPE = AGC_QUEUE_APR;
+	} else {
+		DISPATCH_QUEUE_TYPE = AGC_QUEUE_RING;
+	}
+
+	if (runtime.event_spin_count >= 0) {
+		DISPATCH_SPIN_MAX = runtime.event_spin_count > DISPATCH_SPIN_LIMIT ? DISPATCH_SPIN_LIMIT : runtime.event_spin_count;
+	} else if (agc_core_cpu_count() <= 1) {
+		// nobody can push while we spin on a single cpu
+		DISPATCH_SPIN_MAX = 0;
+	}
+
+	if (runtime.event_batch_size > 0) {
+		DISPATCH_BATCH_SIZE = runtime.event_batch_size > DISPATCH_BATCH_LIMIT ? DISPATCH_BATCH_LIMIT : runtime.event_batch_size;
+	}
+
+	if (runtime.event_spill_limit > 0) {
+		DISPATCH_SPILL_LIMIT = runtime.event_spill_limit;
+	}
+
+	if (runtime.event_overflow_policy) {
+		agc_event_overflow_t policy = EVENT_OVERFLOW_BLOCK;
+
+		if (!strcasecmp(runtime.event_overflow_policy, "drop_newest")) {
+			policy = EVENT_OVERFLOW_DROP_NEWEST;
+		} else if (!strcasecmp(runtime.event_overflow_policy, "drop_oldest")) {
+			policy = EVENT_OVERFLOW_DROP_OLDEST;
+		} else if (!strcasecmp(runtime.event_overflow_policy, "spill")) {
+			policy = EVENT_OVERFLOW_SPILL;
+		}
+
+		memset(EVENT_OVERFLOW_POLICY, policy, sizeof(EVENT_OVERFLOW_POLICY));
+	}
+
+	// signaling goes ahead of the bulk traffic
+	memset(EVENT_PRIORITY, EVENT_PRIORITY_NORMAL, sizeof(EVENT_PRIORITY));
+	EVENT_PRIORITY[EVENT_ID_SIG2MEDIA] = EVENT_PRIORITY_HIGH;
+	EVENT_PRIORITY[EVENT_ID_MEDIA2SIG] = EVENT_PRIORITY_HIGH;
+
+	if (runtime.event_priority_weights) {
+		int weights[EVENT_PRIORITY_CLASSES];
+
+		if (sscanf(runtime.event_priority_weights, "%d,%d,%d", &weights[0], &weights[1], &weights[2]) == EVENT_PRIORITY_CLASSES) {
+			for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+				agc_event_set_priority_weight((agc_event_priority_t) i, weights[i]);
+			}
+		} else {
+			agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid event_priority_weights %s.\n", runtime.event_priority_weights);
+		}
+	}
+
+	if (runtime.event_json_max_size > 0) {
+		EVENT_JSON_MAX = runtime.event_json_max_size;
+	}
     
-	agc_mutex_init(&SOURCEID_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
 	agc_mutex_init(&EVENTSTATE_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
+	agc_mutex_init(&DISPATCH_RESIZE_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
 	agc_thread_rwlock_create(&EVENT_TEMPLATES_RWLOCK, RUNTIME_POOL);
-	agc_thread_rwlock_create(&EVENT_NODES_RWLOCK, RUNTIME_POOL);
+	agc_mutex_init(&EVENT_NODES_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
+
+	for (i = 0; i < EVENT_REQUEST_SHARDS; i++) {
+		agc_mutex_init(&EVENT_REQUESTS[i].mutex, AGC_MUTEX_NESTED, RUNTIME_POOL);
+	}
+
+
+	FAST_EVENT_POOLS = agc_memory_alloc(RUNTIME_POOL, EVENT_FAST_TYPE_Invalid * sizeof(fast_event_pool_t *));
+	memset(FAST_EVENT_POOLS, 0, EVENT_FAST_TYPE_Invalid * sizeof(fast_event_pool_t *));
+	pthread_key_create(&FAST_EVENT_CACHE_KEY, fast_cache_destroy);
+
+	if (runtime.event_fast_cache_size > 0) {
+		FAST_EVENT_CACHE_SIZE = runtime.event_fast_cache_size > FAST_EVENT_CACHE_LIMIT ? FAST_EVENT_CACHE_LIMIT : runtime.event_fast_cache_size;
+	}
 
+	if (runtime.event_fast_low_water > 0) {
+		FAST_EVENT_LOW_WATER = runtime.event_fast_low_water;
+	}
 
-	FAST_EVENT_QUEUES = agc_memory_alloc(RUNTIME_POOL, EVENT_FAST_TYPE_Invalid * sizeof(agc_queue_t *));
+	if (runtime.event_fast_high_water > 0) {
+		FAST_EVENT_HIGH_WATER = runtime.event_fast_high_water;
+	}
     
-	EVENT_DISPATCH_QUEUES = agc_memory_alloc(RUNTIME_POOL, MAX_DISPATCHER * sizeof(agc_queue_t *));
-	EVENT_DISPATCH_QUEUE_RUNNING = agc_memory_alloc(RUNTIME_POOL, MAX_DISPATCHER * sizeof(uint8_t));
+	EVENT_DISPATCHERS = agc_memory_alloc(RUNTIME_POOL, DISPATCH_CAPACITY * sizeof(event_dispatcher_t));
+	memset(EVENT_DISPATCHERS, 0, DISPATCH_CAPACITY * sizeof(event_dispatcher_t));
 
 	init_ids();
+
+	agc_mutex_init(&EVENT_ATOM_MUTEX, AGC_MUTEX_NESTED, RUNTIME_POOL);
+	agc_event_atom(EVENT_HEADER_ROUTING);
+	agc_event_atom(EVENT_HEADER_UUID);
+	agc_event_atom(EVENT_HEADER_CODE);
+	agc_event_atom(EVENT_HEADER_DESC);
+	agc_event_atom(EVENT_HEADER_SUBNAME);
+	agc_event_atom(EVENT_HEADER_TYPE);
+	agc_event_atom(EVENT_HEADER_CORRELATION);
+	agc_event_atom(EVENT_HEADER_REPLY);
+	assert(agc_event_atom_find(EVENT_HEADER_REPLY) == EVENT_ATOM_REPLY);
     
 	// create dispatch queues
 	for (i = 0; i < MAX_DISPATCHER; i++)
 	{
-		EVENT_DISPATCH_QUEUE_RUNNING[i] = 0;
-		agc_queue_create(&EVENT_DISPATCH_QUEUES[i], DISPATCH_QUEUE_LIMIT, RUNTIME_POOL);
+		agc_event_dispatcher_setup(&EVENT_DISPATCHERS[i], i);
 	}
     
 	SYSTEM_RUNNING = 1;
     
-	agc_event_launch_dispatch_threads();
+	for (i = 0; i < MAX_DISPATCHER; i++)
+	{
+		agc_event_launch_dispatch_thread(&EVENT_DISPATCHERS[i]);
+	}
 
 	if (agc_event_fast_initial(EVENT_FAST_TYPE_CallBack, 0, 1000, NULL, NULL, 0, 0) != AGC_STATUS_SUCCESS) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Event init failed.\n");
 		return AGC_STATUS_FALSE;
 	}
     
-	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Event init success.\n");
+	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Event init success, %d dispatchers (up to %d) wait mode %s queue type %s.\n", 
+					MAX_DISPATCHER, DISPATCH_CAPACITY, DISPATCH_WAIT_MODE == EVENT_WAIT_POLL ? "poll" : "block",
+					DISPATCH_QUEUE_TYPE == AGC_QUEUE_APR ? "apr" : "ring");
     
 	return AGC_STATUS_SUCCESS;
 }
@@ -115,8 +748,18 @@ AGC_DECLARE(agc_status_t) agc_event_shutdown(void)
 {
     int x = 0;
     int last = 0;
+    int i = 0;
+	event_lane_t **lanes = NULL;
+	int lane_count = 0;
     
 	SYSTEM_RUNNING = 0;
+
+	// wake up parked dispatchers
+	for (i = 0; i < DISPATCH_SLOTS; i++) {
+		agc_mutex_lock(EVENT_DISPATCHERS[i].mutex);
+		agc_thread_cond_signal(EVENT_DISPATCHERS[i].cond);
+		agc_mutex_unlock(EVENT_DISPATCHERS[i].mutex);
+	}
     
     // wait all thread stop
 	while (x < 100 && DISPATCH_THREAD_COUNT) {
@@ -126,6 +769,66 @@ AGC_DECLARE(agc_status_t) agc_event_shutdown(void)
 		}
 		last = DISPATCH_THREAD_COUNT;
 	}
+
+	// the lane workers finish what was queued, SYSTEM_RUNNING keeps them from calling back,
+	// they are joined outside of the lock a callback may take
+	agc_mutex_lock(EVENT_NODES_MUTEX);
+	for (i = 0; i < EVENT_ID_LIMIT; i++) {
+		agc_event_node_t *np;
+
+		for (np = EVENT_NODES[i]; np; np = np->next) {
+			if (np->lane) {
+				lanes = (event_lane_t **) realloc(lanes, (lane_count + 1) * sizeof(event_lane_t *));
+				assert(lanes);
+				lanes[lane_count++] = np->lane;
+			}
+		}
+	}
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+
+	for (i = 0; i < lane_count; i++) {
+		agc_event_lane_stop(lanes[i]);
+	}
+	agc_safe_free(lanes);
+
+	// nobody moves the spilled events back any more
+	for (i = 0; i < DISPATCH_SLOTS; i++) {
+		agc_event_t *eventp;
+		int event_id, priority;
+
+		for (event_id = 0; event_id < EVENT_SPILL_LISTS; event_id++) {
+			event_spill_list_t *list = &EVENT_DISPATCHERS[i].spills[event_id];
+
+			while ((eventp = list->head)) {
+				list->head = eventp->next;
+				eventp->next = NULL;
+				agc_event_destroy(&eventp);
+			}
+			list->tail = NULL;
+			list->count = 0;
+		}
+		EVENT_DISPATCHERS[i].spill_count = 0;
+
+		// nor the ones put aside by an unfinished resize
+		for (priority = 0; priority < EVENT_PRIORITY_CLASSES; priority++) {
+			event_priority_class_t *pclass = &EVENT_DISPATCHERS[i].classes[priority];
+
+			while ((eventp = pclass->held_head)) {
+				pclass->held_head = eventp->next;
+				eventp->next = NULL;
+				agc_event_destroy(&eventp);
+			}
+			pclass->held_tail = NULL;
+			pclass->held_count = 0;
+		}
+
+		for (event_id = 0; event_id < EVENT_ID_LIMIT; event_id++) {
+			agc_safe_free(EVENT_DISPATCHERS[i].latency[event_id]);
+		}
+		agc_safe_free(EVENT_DISPATCHERS[i].batch);
+	}
+
+	agc_event_request_sweep();
     
     agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Event shutdown success.\n");
     
@@ -141,25 +844,52 @@ static void init_ids()
 	event_templates[EVENT_ID_SIG2MEDIA] = EVENT_NAME_SIG2MEDIA;
 	event_templates[EVENT_ID_MEDIA2SIG] = EVENT_NAME_MEDIA2SIG;
 	event_templates[EVENT_ID_JSONCMD] = EVENT_NAME_JSONCMD;
+
+	memset((void *) EVENT_NAME_INDEX, 0, sizeof(EVENT_NAME_INDEX));
+	event_name_index(EVENT_ID_ALL);
+	event_name_index(EVENT_ID_EVENTSOCKET);
+	event_name_index(EVENT_ID_CMDRESULT);
+	event_name_index(EVENT_ID_SIG2MEDIA);
+	event_name_index(EVENT_ID_MEDIA2SIG);
+	event_name_index(EVENT_ID_JSONCMD);
 }
 
-AGC_DECLARE(uint32_t) agc_event_alloc_source(const char *source_name)
+/* add a registered name to the index, the first id registered under a name keeps it */
+static void event_name_index(int event_id)
 {
-	uint32_t source_id;
-	agc_mutex_lock(EVENTSTATE_MUTEX);
-	source_id = ++EVENT_SOURCE_ID;
-	if (EVENT_SOURCE_ID == UINT32_MAX)
-		EVENT_SOURCE_ID = 0;
-	
-	agc_mutex_unlock(EVENTSTATE_MUTEX);
+	uint32_t slot = event_atom_hash(event_templates[event_id]) & (EVENT_NAME_SLOTS - 1);
+	uint16_t entry;
+
+	while ((entry = EVENT_NAME_INDEX[slot])) {
+		if (strcasecmp(event_templates[entry - 1], event_templates[event_id]) == 0) {
+			return;
+		}
+		slot = (slot + 1) & (EVENT_NAME_SLOTS - 1);
+	}
+
+	agc_store_release(&EVENT_NAME_INDEX[slot], (uint16_t) (event_id + 1));
+}
+
+AGC_DECLARE(uint64_t) agc_event_alloc_source(const char *source_name)
+{
+	if (EVENT_SOURCE_NEXT == EVENT_SOURCE_END) {
+		// ids start at 1, 0 is EVENT_NULL_SOURCEID
+		EVENT_SOURCE_NEXT = agc_fetch_add(&EVENT_SOURCE_ID, EVENT_SOURCE_BATCH) + 1;
+		EVENT_SOURCE_END = EVENT_SOURCE_NEXT + EVENT_SOURCE_BATCH;
+	}
     
-	return source_id;
+	return EVENT_SOURCE_NEXT++;
 }
 
 AGC_DECLARE(agc_status_t) agc_event_register(int event_id, const char *event_name)
 {
 	if (EVENT_ID_IS_INVALID(event_id))
 		return AGC_STATUS_GENERR;
+
+	if (!event_name || !*event_name) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Event id %d needs a name.\n", event_id);
+		return AGC_STATUS_GENERR;
+	}
     
 	agc_thread_rwlock_wrlock(EVENT_TEMPLATES_RWLOCK);
 	if (event_templates[event_id] != NULL) {
@@ -168,7 +898,8 @@ AGC_DECLARE(agc_status_t) agc_event_register(int event_id, const char *event_nam
 		return AGC_STATUS_GENERR;
 	}
     
-	event_templates[event_id] = agc_core_strdup(RUNTIME_POOL, event_name);
+	agc_store_release(&event_templates[event_id], agc_core_strdup(RUNTIME_POOL, event_name));
+	event_name_index(event_id);
     
 	agc_thread_rwlock_unlock(EVENT_TEMPLATES_RWLOCK);
 	return AGC_STATUS_SUCCESS;
@@ -176,32 +907,22 @@ AGC_DECLARE(agc_status_t) agc_event_register(int event_id, const char *event_nam
 
 AGC_DECLARE(agc_status_t) agc_event_get_id(const char *event_name, int *event_id)
 {
-	int i = 0;
-	int found = 0;
+	uint32_t slot;
+	uint16_t entry;
     
 	if (!event_name || !event_id)
 		return AGC_STATUS_GENERR;
     
-	agc_thread_rwlock_rdlock(EVENT_TEMPLATES_RWLOCK);
-	
-	for (i = 0; i < EVENT_ID_LIMIT; i++) {
-		if (!event_templates[i])
-			continue;
-		
-		if (strcasecmp(event_name, event_templates[i]) == 0) {
-			*event_id = i;
-			found = 1;
-			break;
+	slot = event_atom_hash(event_name) & (EVENT_NAME_SLOTS - 1);
+	while ((entry = agc_load_acquire(&EVENT_NAME_INDEX[slot]))) {
+		if (strcasecmp(event_name, agc_load_acquire(&event_templates[entry - 1])) == 0) {
+			*event_id = entry - 1;
+			return AGC_STATUS_SUCCESS;
 		}
+		slot = (slot + 1) & (EVENT_NAME_SLOTS - 1);
 	}
         
-	agc_thread_rwlock_unlock(EVENT_TEMPLATES_RWLOCK);
-    
-	if (!found) {
-		return AGC_STATUS_GENERR;
-	}
-        
-	return AGC_STATUS_SUCCESS;
+	return AGC_STATUS_GENERR;
 }
 
 AGC_DECLARE(const char *) agc_event_get_name(int event_id)
@@ -212,20 +933,44 @@ AGC_DECLARE(const char *) agc_event_get_name(int event_id)
 		return NULL;
 	}
 
-	agc_thread_rwlock_rdlock(EVENT_TEMPLATES_RWLOCK);
-	event_name = event_templates[event_id];
-	agc_thread_rwlock_unlock(EVENT_TEMPLATES_RWLOCK);
+	// names are write once, the pointer is published with release
+	event_name = agc_load_acquire(&event_templates[event_id]);
 	return event_name;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_create(agc_event_t **event, int event_id, uint32_t source_id)
+AGC_DECLARE(agc_status_t) agc_event_create(agc_event_t **event, int event_id, uint64_t source_id)
 {
-	agc_event_t * new_event;
-	new_event= malloc(sizeof(agc_event_t));
+	return event_create_sized(event, event_id, source_id, EVENT_ARENA_SIZE);
+}
+
+static agc_status_t event_create_sized(agc_event_t **event, int event_id, uint64_t source_id, size_t size)
+{
+	agc_event_t *new_event;
+	event_arena_t *arena;
+	size_t head = EVENT_ARENA_ALIGN(sizeof(agc_event_t)) + EVENT_ARENA_ALIGN(sizeof(event_arena_t));
+
+	if (size < EVENT_ARENA_SIZE) {
+		size = EVENT_ARENA_SIZE;
+	}
+
+	size = EVENT_ARENA_ALIGN(size);
+	new_event = malloc(size);
+	if (!new_event) {
+		*event = NULL;
+		return AGC_STATUS_MEMERR;
+	}
 
 	memset(new_event, 0, sizeof(agc_event_t));
 	new_event->event_id = event_id;
 	new_event->source_id = source_id;
+	new_event->refs = 1;
+
+	arena = (event_arena_t *)((char *) new_event + EVENT_ARENA_ALIGN(sizeof(agc_event_t)));
+	arena->pos = (char *) new_event + head;
+	arena->end = (char *) new_event + size;
+	arena->size = size;
+	arena->chunks = NULL;
+	new_event->arena = arena;
 
 	*event = new_event;
 	return AGC_STATUS_SUCCESS;
@@ -239,8 +984,23 @@ AGC_DECLARE(agc_status_t) agc_event_set_id(agc_event_t *event, int event_id)
 	return AGC_STATUS_SUCCESS;
 }
 
+AGC_DECLARE(agc_status_t) agc_event_set_deadline(agc_event_t *event, agc_time_t deadline)
+{
+	if (!event) {
+		return AGC_STATUS_GENERR;
+	}
+
+	event->deadline = deadline;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_set_ttl(agc_event_t *event, uint32_t ttl_ms)
+{
+	return agc_event_set_deadline(event, agc_time_now() + (agc_time_t) ttl_ms * 1000);
+}
+
 AGC_DECLARE(agc_status_t) agc_event_create_callback(agc_event_t **event,  
-                                                    uint32_t source_id, 
+                                                    uint64_t source_id, 
                                                     void *data, 
                                                     agc_event_callback_func callback)
 {
@@ -259,34 +1019,61 @@ AGC_DECLARE(agc_status_t) agc_event_create_callback(agc_event_t **event,
 AGC_DECLARE(void) agc_event_destroy(agc_event_t **event)
 {
 	agc_event_t *ep = *event;
-	agc_event_header_t *hp, *this;
+	struct event_arena_chunk *chunk, *next;
     
-	if (ep) {
-		for (hp = ep->headers; hp;) {
-			this = hp;
-			hp = hp->next;
-			agc_safe_free(this->name);
-			agc_safe_free(this->value);
-			agc_safe_free(this);
-        	}
-        
-		agc_safe_free(ep->body);
+	if (!ep) {
+		return;
+	}
+
+	if (ep->fast) {
+		agc_event_fast_release(event);
+		return;
+	}
+
+	if (EVENT_SHARED(ep) && agc_fetch_add(&ep->refs, -1) > 1) {
+		*event = NULL;
+		return;
+	}
+
+	if (ep->arena) {
+		for (chunk = ((event_arena_t *) ep->arena)->chunks; chunk; chunk = next) {
+			next = chunk->next;
+			free(chunk);
+		}
 	}
+
+	free(ep);
     
 	*event = NULL;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_add_header(agc_event_t *event, const char *header_name, const char *fmt, ...)
+AGC_DECLARE(agc_event_t *) agc_event_retain(agc_event_t *event)
+{
+	assert(event);
+
+	agc_fetch_add(&event->refs, 1);
+	return event;
+}
+
+AGC_DECLARE(void) agc_event_release(agc_event_t **event)
+{
+	agc_event_destroy(event);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_add_header(agc_event_t *event, const char *header_name, const char *fmt, ...)
 {
-	int ret = 0;
 	char *data;
 	va_list ap;
+
+	if (EVENT_SHARED(event)) {
+		return AGC_STATUS_GENERR;
+	}
     
 	va_start(ap, fmt);
-	ret = agc_vasprintf(&data, fmt, ap);
+	data = event_arena_vprintf(event, fmt, ap);
 	va_end(ap);
     
-	if (ret == -1) {
+	if (!data) {
 		return AGC_STATUS_MEMERR;
 	}
     
@@ -295,15 +1082,18 @@ AGC_DECLARE(agc_status_t) agc_event_add_header(agc_event_t *event, const char *h
 
 AGC_DECLARE(agc_status_t) agc_event_add_header_repeatcheck(agc_event_t *event, const char *header_name, const char *fmt, ...)
 {
-	int ret = 0;
 	char *data;
 	va_list ap;
+
+	if (EVENT_SHARED(event)) {
+		return AGC_STATUS_GENERR;
+	}
     
 	va_start(ap, fmt);
-	ret = agc_vasprintf(&data, fmt, ap);
+	data = event_arena_vprintf(event, fmt, ap);
 	va_end(ap);
     
-	if (ret == -1) {
+	if (!data) {
 		return AGC_STATUS_MEMERR;
 	}
     
@@ -312,8 +1102,8 @@ AGC_DECLARE(agc_status_t) agc_event_add_header_repeatcheck(agc_event_t *event, c
 
 AGC_DECLARE(agc_status_t) agc_event_add_header_string(agc_event_t *event, const char *header_name, const char *data)
 {
-    if (data) {
-		return agc_event_base_add_header(event, header_name, strdup(data));
+    if (data && !EVENT_SHARED(event)) {
+		return agc_event_base_add_header(event, header_name, event_arena_strdup(event, data));
 	}
     
 	return AGC_STATUS_GENERR;
@@ -322,6 +1112,16 @@ AGC_DECLARE(agc_status_t) agc_event_add_header_string(agc_event_t *event, const
 AGC_DECLARE(agc_status_t) agc_event_del_header(agc_event_t *event, const char *header_name)
 {
 	agc_event_header_t *hp, *lp = NULL, *tp;
+	uint32_t atom = agc_event_atom_find(header_name);
+	int deleted = 0;
+
+	if (EVENT_SHARED(event)) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (!atom && !event->loose_headers) {
+		return AGC_STATUS_SUCCESS;
+	}
 
 	tp = event->headers;
 
@@ -329,7 +1129,7 @@ AGC_DECLARE(agc_status_t) agc_event_del_header(agc_event_t *event, const char *h
 		hp = tp;
 		tp = tp->next;
 	    
-		if (!strcasecmp(header_name, hp->name)) {
+		if ((atom && hp->atom == atom) || (!hp->atom && event->loose_headers && !strcasecmp(header_name, hp->name))) {
 			if (lp) {
 				lp->next = hp->next;
 			} else {
@@ -340,14 +1140,17 @@ AGC_DECLARE(agc_status_t) agc_event_del_header(agc_event_t *event, const char *h
 				event->last_header = lp;
 			}
 	        
-			agc_safe_free(hp->name);
-			agc_safe_free(hp->value);
-			agc_safe_free(hp);
+			event->header_count--;
+			deleted++;
 	    } else {
 			lp = hp;
 	    }
 	}
 
+	if (deleted && event->index) {
+		event_index_rebuild(event);
+	}
+
 	return AGC_STATUS_SUCCESS;
 }
 
@@ -355,7 +1158,20 @@ AGC_DECLARE(const char *) agc_event_get_header(agc_event_t *event, const char *h
 {
 	agc_event_header_t *hp;
 	if ((hp = agc_event_get_header_ptr(event, header_name))) {
-		return hp->value;
+		return event_header_text(hp);
+	}
+
+	return NULL;
+}
+
+AGC_DECLARE(const char *) agc_event_get_header_atom(agc_event_t *event, uint32_t atom)
+{
+	agc_event_header_t *hp;
+
+	assert(event);
+
+	if (atom && (hp = event_find_header(event, atom))) {
+		return event_header_text(hp);
 	}
 
 	return NULL;
@@ -363,21 +1179,19 @@ AGC_DECLARE(const char *) agc_event_get_header(agc_event_t *event, const char *h
 
 AGC_DECLARE(agc_status_t) agc_event_add_body(agc_event_t *event, const char *fmt, ...)
 {
-	int ret = 0;
 	char *data;
 
 	assert(event);
 	va_list ap;
     
-	if (fmt) {
+	if (fmt && !EVENT_SHARED(event)) {
 		va_start(ap, fmt);
-		ret = agc_vasprintf(&data, fmt, ap);
+		data = event_arena_vprintf(event, fmt, ap);
 		va_end(ap);
 
-		if (ret == -1) {
+		if (!data) {
 			return AGC_STATUS_GENERR;
 		} else {
-			agc_safe_free(event->body);
 			event->body = data;
 			return AGC_STATUS_SUCCESS;
 		}
@@ -388,15 +1202,15 @@ AGC_DECLARE(agc_status_t) agc_event_add_body(agc_event_t *event, const char *fmt
 
 AGC_DECLARE(agc_status_t) agc_event_set_body(agc_event_t *event, const char *body)
 {
+	char *data;
+
 	assert(event);
 
-	if (!body) {
+	if (!body || EVENT_SHARED(event) || !(data = event_arena_strdup(event, body))) {
 		return AGC_STATUS_GENERR;
 	}
 	
-	agc_safe_free(event->body);
-	if (body)
-		event->body = strdup(body);
+	event->body = data;
     
 	return AGC_STATUS_SUCCESS;
 }
@@ -409,20 +1223,36 @@ AGC_DECLARE(const char *) agc_event_get_body(agc_event_t *event)
 AGC_DECLARE(agc_status_t) agc_event_dup(agc_event_t **event, agc_event_t *todup)
 {
     agc_event_header_t *hp;
+    size_t size = EVENT_ARENA_ALIGN(sizeof(agc_event_t)) + EVENT_ARENA_ALIGN(sizeof(event_arena_t));
     
     assert(todup);
+
+    // size the copy so that it fits in one block
+    for (hp = todup->headers; hp; hp = hp->next) {
+        size += EVENT_ARENA_ALIGN(sizeof(agc_event_header_t)) + EVENT_ARENA_ALIGN(strlen(hp->name) + 1) + EVENT_ARENA_ALIGN(strlen(event_header_text(hp)) + 1);
+    }
+
+    if (todup->header_count >= EVENT_INDEX_THRESHOLD) {
+        size += todup->header_count * 8 * sizeof(agc_event_header_t *);
+    }
+
+    if (todup->body) {
+        size += EVENT_ARENA_ALIGN(strlen(todup->body) + 1);
+    }
     
-    if (agc_event_create(event, todup->event_id, todup->source_id) != AGC_STATUS_SUCCESS) {
+    if (event_create_sized(event, todup->event_id, todup->source_id, size) != AGC_STATUS_SUCCESS) {
         return AGC_STATUS_GENERR;
     }
     
     for (hp = todup->headers; hp; hp = hp->next) {
-        agc_event_add_header_string(*event, hp->name, hp->value);
+        agc_event_base_add_header_nocheck(*event, hp->name, event_arena_strdup(*event, event_header_text(hp)));
     }
     
     if (todup->body) {
-		(*event)->body = strdup(todup->body);
+		(*event)->body = event_arena_strdup(*event, todup->body);
 	}
+
+	(*event)->deadline = todup->deadline;
     
     return AGC_STATUS_SUCCESS;
 }
@@ -438,11 +1268,45 @@ AGC_DECLARE(agc_status_t) agc_event_bind_removable(const char *id,
                                                    int event_id, 
                                                    agc_event_callback_func callback, 
                                                    agc_event_node_t **node)
+{
+	return agc_event_bind_filtered(id, event_id, callback, NULL, node);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_bind_filtered(const char *id, 
+                                                  int event_id, 
+                                                  agc_event_callback_func callback, 
+                                                  agc_event_filter_t *filter, 
+                                                  agc_event_node_t **node)
+{
+	return agc_event_bind_async(id, event_id, callback, filter, NULL, node);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_bind_async(const char *id, 
+                                               int event_id, 
+                                               agc_event_callback_func callback, 
+                                               agc_event_filter_t *filter, 
+                                               const agc_event_lane_options_t *options, 
+                                               agc_event_node_t **node)
 {
 	agc_event_node_t *event_node;
     
-	if (event_id > EVENT_ID_LIMIT)
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT)
+		return AGC_STATUS_GENERR;
+
+	if (options && (options->workers < 0 || options->workers > EVENT_LANE_WORKERS_LIMIT || 
+					options->overflow < EVENT_OVERFLOW_BLOCK || options->overflow >= EVENT_OVERFLOW_SPILL)) {
 		return AGC_STATUS_GENERR;
+	}
+
+	if (filter) {
+		int unbound = 0;
+
+		// a node frees its filter, it can not be shared
+		if (!agc_cas(&filter->bound, &unbound, 1)) {
+			agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Filter of %s is bound already.\n", id);
+			return AGC_STATUS_GENERR;
+		}
+	}
     
 	event_node = (agc_event_node_t *)malloc(sizeof(agc_event_node_t));
 	assert(event_node);
@@ -451,14 +1315,31 @@ AGC_DECLARE(agc_status_t) agc_event_bind_removable(const char *id,
 	event_node->id = strdup(id);
 	event_node->event_id = event_id;
 	event_node->callback = callback;
+	event_node->filter = filter;
+	event_node->latency = (agc_event_latency_t *) calloc(DISPATCH_CAPACITY, sizeof(agc_event_latency_t));
+	assert(event_node->latency);
+
+	if (options && !(event_node->lane = agc_event_lane_create(event_node, options))) {
+		if (filter) {
+			agc_store_release(&filter->bound, 0);
+		}
+		agc_safe_free(event_node->latency);
+		agc_safe_free(event_node->id);
+		agc_safe_free(event_node);
+		return AGC_STATUS_GENERR;
+	}
           
-	agc_thread_rwlock_wrlock(EVENT_NODES_RWLOCK);
+	agc_mutex_lock(EVENT_NODES_MUTEX);
 	if (EVENT_NODES[event_id]) {
 		event_node->next = EVENT_NODES[event_id];
 	}
     
 	EVENT_NODES[event_id] = event_node;
-	agc_thread_rwlock_unlock(EVENT_NODES_RWLOCK);
+	agc_event_publish_subscribers(event_id);
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+
+	// binding does not wait for the dispatchers, an unbind or a quiescent state frees the rest
+	agc_event_reclaim(AGC_FALSE);
 
 	if (node)
 		*node = event_node;
@@ -466,334 +1347,3294 @@ AGC_DECLARE(agc_status_t) agc_event_bind_removable(const char *id,
 	return AGC_STATUS_SUCCESS;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_fire(agc_event_t **event)
+AGC_DECLARE(agc_status_t) agc_event_filter_create(agc_event_filter_t **filter)
 {
-	agc_queue_t *event_queue = NULL;
-	int queue_index = 0;
-	agc_event_t *eventp = *event;
+	agc_event_filter_t *new_filter;
 
-	if (!eventp) {
+	new_filter = (agc_event_filter_t *) calloc(1, sizeof(agc_event_filter_t));
+	assert(new_filter);
+	new_filter->key = -1;
+
+	*filter = new_filter;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_filter_add(agc_event_filter_t *filter, const char *header_name, agc_event_filter_op_t op, const char *value)
+{
+	event_filter_term_t *term = NULL;
+	uint32_t atom;
+	int i, pos;
+
+	if (!filter || !header_name || op < EVENT_FILTER_EQUALS || op > EVENT_FILTER_IN || (!value && op != EVENT_FILTER_EXISTS)) {
 		return AGC_STATUS_GENERR;
 	}
 
-	if (SYSTEM_RUNNING == 0) {
-		agc_event_destroy(event);
-		return AGC_STATUS_SUCCESS;
+	// the dispatchers match against it without lock
+	if (agc_load_acquire(&filter->bound)) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Filter is bound, header %s can not be added.\n", header_name);
+		return AGC_STATUS_GENERR;
 	}
 
-	if (eventp->debug_id) {
-		agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d received.\n", eventp->debug_id);
+	if ((atom = agc_event_atom(header_name)) == EVENT_ATOM_NONE) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Filter header %s can not be interned.\n", header_name);
+		return AGC_STATUS_GENERR;
 	}
 
-	if (eventp->source_id != EVENT_NULL_SOURCEID) {
-		queue_index = eventp->source_id % MAX_DISPATCHER;
-	} else {
-		queue_index = agc_random(MAX_DISPATCHER);
+	if (op == EVENT_FILTER_IN) {
+		for (i = 0; i < filter->count; i++) {
+			if (filter->terms[i].atom == atom && filter->terms[i].op == EVENT_FILTER_IN) {
+				term = &filter->terms[i];
+				break;
+			}
+		}
 	}
 
-	event_queue = EVENT_DISPATCH_QUEUES[queue_index];
-	if (!event_queue) {
-		return AGC_STATUS_GENERR;
+	if (!term) {
+		filter->terms = (event_filter_term_t *) realloc(filter->terms, (filter->count + 1) * sizeof(event_filter_term_t));
+		assert(filter->terms);
+		term = &filter->terms[filter->count];
+		memset(term, 0, sizeof(event_filter_term_t));
+		term->atom = atom;
+		term->op = op;
+
+		// an equals term narrows more than a set
+		if (op == EVENT_FILTER_EQUALS && (filter->key < 0 || filter->terms[filter->key].op != EVENT_FILTER_EQUALS)) {
+			filter->key = filter->count;
+		} else if (op == EVENT_FILTER_IN && filter->key < 0) {
+			filter->key = filter->count;
+		}
+		filter->count++;
+	}
+
+	if (op == EVENT_FILTER_EXISTS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	// keep the set sorted for the binary search
+	for (pos = 0; pos < term->count; pos++) {
+		int cmp = strcmp(value, term->values[pos]);
+
+		if (cmp == 0) {
+			return AGC_STATUS_SUCCESS;
+		} else if (cmp < 0) {
+			break;
+		}
 	}
 
-	agc_queue_push(event_queue, eventp);
+	term->values = (char **) realloc(term->values, (term->count + 1) * sizeof(char *));
+	term->lens = (size_t *) realloc(term->lens, (term->count + 1) * sizeof(size_t));
+	assert(term->values && term->lens);
+	memmove(&term->values[pos + 1], &term->values[pos], (term->count - pos) * sizeof(char *));
+	memmove(&term->lens[pos + 1], &term->lens[pos], (term->count - pos) * sizeof(size_t));
+	term->values[pos] = strdup(value);
+	term->lens[pos] = strlen(value);
+	term->count++;
+
 	return AGC_STATUS_SUCCESS;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_unbind(agc_event_node_t **node)
+AGC_DECLARE(agc_bool_t) agc_event_filter_match(agc_event_filter_t *filter, agc_event_t *event)
 {
-	int event_id = 0;
-	agc_event_node_t *event_node, *np, *lnp = NULL;
-	agc_status_t status = AGC_STATUS_FALSE;
-    
-	event_node = *node;
-    
-	if (!event_node) {
-		return AGC_STATUS_GENERR;
+	event_filter_term_t *term;
+	const char *value;
+	int i, low, high, mid, cmp;
+
+	if (!filter) {
+		return AGC_TRUE;
 	}
-    
-	event_id = event_node->event_id;
-	agc_thread_rwlock_wrlock(EVENT_NODES_RWLOCK);
-    
-	for (np = EVENT_NODES[event_id]; np; np = np->next) {
-		if (np == event_node) {
-			if (lnp) {
-				lnp->next = event_node->next;
-			} else {
-				EVENT_NODES[event_id] = event_node->next;
+
+	for (i = 0; i < filter->count; i++) {
+		term = &filter->terms[i];
+
+		if (!(value = agc_event_get_header_atom(event, term->atom))) {
+			return AGC_FALSE;
+		}
+
+		switch (term->op) {
+		case EVENT_FILTER_EQUALS:
+			if (strcmp(value, term->values[0])) {
+				return AGC_FALSE;
 			}
-            
-			agc_safe_free(event_node->id);
-			agc_safe_free(event_node);
-			*node = NULL;
-			status = AGC_STATUS_SUCCESS;
 			break;
-		} else {
-			lnp = np;
+		case EVENT_FILTER_PREFIX:
+			if (strncmp(value, term->values[0], term->lens[0])) {
+				return AGC_FALSE;
+			}
+			break;
+		case EVENT_FILTER_IN:
+			low = 0;
+			high = term->count - 1;
+			cmp = 1;
+			while (low <= high) {
+				mid = (low + high) / 2;
+				if ((cmp = strcmp(value, term->values[mid])) == 0) {
+					break;
+				} else if (cmp < 0) {
+					high = mid - 1;
+				} else {
+					low = mid + 1;
+				}
+			}
+			if (cmp) {
+				return AGC_FALSE;
+			}
+			break;
+		default:
+			break;
 		}
 	}
-    
-	agc_thread_rwlock_unlock(EVENT_NODES_RWLOCK);
-    
-	return status;    
+
+	return AGC_TRUE;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_unbind_callback(agc_event_callback_func callback)
+AGC_DECLARE(void) agc_event_filter_destroy(agc_event_filter_t **filter)
 {
-	agc_event_node_t *event_node, *np, *lnp = NULL;
-	agc_status_t status = AGC_STATUS_FALSE;
-	int id = 0;
+	agc_event_filter_t *fp = *filter;
+	int i, j;
 
-	agc_thread_rwlock_wrlock(EVENT_NODES_RWLOCK);
+	if (!fp) {
+		return;
+	}
 
-	for (id = 0; id < EVENT_ID_LIMIT; id++) {
-		lnp = NULL;
-	    
-		for (np = EVENT_NODES[id]; np;) {
-			event_node = np;
-			np = np->next;
-	        
-			if (event_node->callback == callback) {
-				if (lnp) {
-					lnp->next = event_node->next;
-				} else {
-					EVENT_NODES[id] = event_node->next;
-				}
-	            
-				agc_safe_free(event_node->id);
-				agc_safe_free(event_node);
-				status = AGC_STATUS_SUCCESS;
-				break;
-			} else {
-				lnp = event_node;
-			}
+	for (i = 0; i < fp->count; i++) {
+		for (j = 0; j < fp->terms[i].count; j++) {
+			free(fp->terms[i].values[j]);
 		}
+		agc_safe_free(fp->terms[i].values);
+		agc_safe_free(fp->terms[i].lens);
 	}
 
-	agc_thread_rwlock_unlock(EVENT_NODES_RWLOCK);
-	return status;
+	agc_safe_free(fp->terms);
+	free(fp);
+	*filter = NULL;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_serialize_json_obj(agc_event_t *event, cJSON **json)
+AGC_DECLARE(agc_status_t) agc_event_fire(agc_event_t **event)
 {
-	agc_event_header_t *hp;
-	cJSON *cj;
-	char str_evtid[25];
+	return agc_event_fire_ex(event, EVENT_PRIORITY_CLASSES, AGC_TRUE);
+}
 
-	cj = cJSON_CreateObject();
+AGC_DECLARE(agc_status_t) agc_event_try_fire(agc_event_t **event)
+{
+	return agc_event_fire_ex(event, EVENT_PRIORITY_CLASSES, AGC_FALSE);
+}
 
-	for (hp = event->headers; hp; hp = hp->next) {
-		cJSON_AddItemToObject(cj, hp->name, cJSON_CreateString(hp->value));
+AGC_DECLARE(agc_status_t) agc_event_fire_priority(agc_event_t **event, agc_event_priority_t priority)
+{
+	if (priority < EVENT_PRIORITY_HIGH || priority >= EVENT_PRIORITY_CLASSES) {
+		return AGC_STATUS_GENERR;
 	}
-    
-	agc_snprintf(str_evtid, sizeof(str_evtid), "%d", event->event_id);
-	 cJSON_AddItemToObject(cj, "_id", cJSON_CreateString(str_evtid));
 
-	if (event_templates[event->event_id]) {
-		cJSON_AddItemToObject(cj, "_name", cJSON_CreateString(event_templates[event->event_id]));
+	return agc_event_fire_ex(event, priority, AGC_TRUE);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_set_overflow_policy(int event_id, agc_event_overflow_t policy)
+{
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT || policy < EVENT_OVERFLOW_BLOCK || policy > EVENT_OVERFLOW_SPILL) {
+		return AGC_STATUS_GENERR;
 	}
 
-	if (event->body) {
-		int blen = (int) strlen(event->body);
-		char tmp[25];
+	// EVENT_ID_ALL sets every id
+	if (event_id == EVENT_ID_ALL) {
+		memset(EVENT_OVERFLOW_POLICY, policy, sizeof(EVENT_OVERFLOW_POLICY));
+	} else {
+		EVENT_OVERFLOW_POLICY[event_id] = policy;
+	}
 
-		agc_snprintf(tmp, sizeof(tmp), "%d", blen);
+	return AGC_STATUS_SUCCESS;
+}
 
-		cJSON_AddItemToObject(cj, "_length", cJSON_CreateString(tmp));
-		cJSON_AddItemToObject(cj, "_body", cJSON_CreateString(event->body));
+AGC_DECLARE(agc_event_overflow_t) agc_event_get_overflow_policy(int event_id)
+{
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT) {
+		return EVENT_OVERFLOW_BLOCK;
 	}
 
-	*json = cj;
+	return (agc_event_overflow_t) EVENT_OVERFLOW_POLICY[event_id];
+}
 
-	return AGC_STATUS_SUCCESS;
+AGC_DECLARE(agc_status_t) agc_event_set_priority(int event_id, agc_event_priority_t priority)
+{
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT || priority < EVENT_PRIORITY_HIGH || priority >= EVENT_PRIORITY_CLASSES) {
+		return AGC_STATUS_GENERR;
+	}
+
+	// EVENT_ID_ALL sets every id
+	if (event_id == EVENT_ID_ALL) {
+		memset(EVENT_PRIORITY, priority, sizeof(EVENT_PRIORITY));
+	} else {
+		EVENT_PRIORITY[event_id] = priority;
+	}
 
+	return AGC_STATUS_SUCCESS;
 }
 
-AGC_DECLARE(agc_status_t) agc_event_create_json(agc_event_t **event, const char *json)
+AGC_DECLARE(agc_event_priority_t) agc_event_get_priority(int event_id)
 {
-	agc_event_t *new_event = NULL;
-	cJSON *cj, *cjp;
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT) {
+		return EVENT_PRIORITY_NORMAL;
+	}
 
-	if (!(cj = cJSON_Parse(json))) {
-		return AGC_STATUS_FALSE;
+	return (agc_event_priority_t) EVENT_PRIORITY[event_id];
+}
+
+AGC_DECLARE(agc_status_t) agc_event_set_priority_weight(agc_event_priority_t priority, int weight)
+{
+	if (priority < EVENT_PRIORITY_HIGH || priority >= EVENT_PRIORITY_CLASSES || weight < 1 || weight > DISPATCH_WEIGHT_LIMIT) {
+		return AGC_STATUS_GENERR;
 	}
 
-	if (agc_event_create(&new_event, 0, EVENT_NULL_SOURCEID) != AGC_STATUS_SUCCESS) {
-		cJSON_Delete(cj);
-		return AGC_STATUS_FALSE;
+	DISPATCH_WEIGHTS[priority] = weight;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_get_priority_stats(agc_event_priority_t priority, agc_event_priority_stats_t *stats)
+{
+	unsigned int i;
+
+	if (!EVENT_DISPATCHERS || priority < EVENT_PRIORITY_HIGH || priority >= EVENT_PRIORITY_CLASSES || !stats) {
+		return AGC_STATUS_GENERR;
 	}
 
-	for (cjp = cj->child; cjp; cjp = cjp->next)  {
-		int event_id = 0;
-		char *name = cjp->string;
-		char *value = cjp->valuestring;
-
-		if (name && value) {
-			if (!strcasecmp(name, "_body")) {
-				agc_event_set_body(new_event, value);
-			} else if (!strcasecmp(name, "_id")) {
-				event_id = atoi(value);
-				if (EVENT_ID_IS_INVALID(event_id)) {
-					cJSON_Delete(cj);
-					agc_event_destroy(&new_event);
-					return AGC_STATUS_FALSE;
-				}
-				agc_event_set_id(new_event, event_id);
-			} else {
-				agc_event_add_header_string(new_event, name, value);
-			}
+	memset(stats, 0, sizeof(agc_event_priority_stats_t));
+
+	// written by the dispatchers only, a snapshot may be slightly stale
+	for (i = 0; i < DISPATCH_SLOTS; i++) {
+		event_dispatcher_t *dispatcher = &EVENT_DISPATCHERS[i];
+		event_priority_class_t *pclass = &dispatcher->classes[priority];
+
+		stats->depth += agc_event_class_depth(dispatcher, priority);
+		if (pclass->high_water > stats->high_water) {
+			stats->high_water = pclass->high_water;
 		}
+		stats->starved += pclass->starved;
+		event_latency_merge(&stats->queue_delay, &pclass->delay);
 	}
 
-	cJSON_Delete(cj);
-	
-	if (EVENT_ID_IS_INVALID(new_event->event_id)) {
-		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid event received.\n");
-		agc_event_destroy(&new_event);
-		return AGC_STATUS_FALSE;
-	}
-	
-	*event = new_event;
 	return AGC_STATUS_SUCCESS;
-	
 }
 
-AGC_DECLARE(agc_status_t) agc_event_serialize_json(agc_event_t *event, char **str)
+AGC_DECLARE(agc_status_t) agc_event_set_expiry_callback(int event_id, agc_event_callback_func callback)
 {
-	cJSON *cj;
-	*str = NULL;
-
-	if (agc_event_serialize_json_obj(event, &cj) == AGC_STATUS_SUCCESS) {
-		*str = cJSON_PrintUnformatted(cj);
-		cJSON_Delete(cj);
-		
-		return AGC_STATUS_SUCCESS;
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT) {
+		return AGC_STATUS_GENERR;
 	}
 
-	return AGC_STATUS_FALSE;
+	agc_store_release(&EVENT_EXPIRY_CALLBACK[event_id], callback);
+	return AGC_STATUS_SUCCESS;
 }
 
-static void agc_event_launch_dispatch_threads()
+AGC_DECLARE(uint64_t) agc_event_get_expired(int event_id)
 {
-	agc_threadattr_t *thd_attr;
-	int index = 0;
-	uint32_t wait_times = 0;
+	uint64_t expired = 0;
+	int i;
 
-	EVENT_DISPATCH_THREADS = agc_memory_alloc(RUNTIME_POOL, MAX_DISPATCHER*sizeof(agc_thread_t *));
-    
-	for (index = 0; index < MAX_DISPATCHER; index++)
-	{
-		wait_times = 200;
-		agc_threadattr_create(&thd_attr, RUNTIME_POOL);
-		agc_threadattr_stacksize_set(thd_attr, AGC_THREAD_STACKSIZE);
-		agc_threadattr_priority_set(thd_attr, AGC_PRI_REALTIME);
-		agc_thread_create(&EVENT_DISPATCH_THREADS[index], thd_attr, agc_event_dispatch_thread, EVENT_DISPATCH_QUEUES[index], RUNTIME_POOL);
-	    
-		while(--wait_times && !EVENT_DISPATCH_QUEUE_RUNNING[index]) {
-			agc_yield(10000);
+	if (!EVENT_DISPATCHERS || event_id < 0 || event_id >= EVENT_ID_LIMIT) {
+		return 0;
+	}
+
+	for (i = 0; i < DISPATCH_SLOTS; i++) {
+		event_latency_stats_t *stats = agc_load_acquire(&EVENT_DISPATCHERS[i].latency[event_id]);
+
+		if (stats) {
+			expired += agc_load_acquire(&stats->expired);
 		}
-	    
-		agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Create event dispatch thread %d.\n", index);
 	}
+
+	return expired;
 }
 
-static void *agc_event_dispatch_thread(agc_thread_t *thread, void *obj)
+/* priority EVENT_PRIORITY_CLASSES is the class of the event id */
+static agc_status_t agc_event_fire_ex(agc_event_t **event, int priority, agc_bool_t wait)
 {
-	agc_queue_t *queue = (agc_queue_t *) obj;
-	int my_id = 0;
+	event_dispatcher_t *dispatcher = NULL;
+	agc_queue_t *queue;
+	int queue_index = 0;
+	agc_event_t *eventp = *event;
+	agc_status_t status;
 
-	for (my_id = 0; my_id < MAX_DISPATCHER; my_id++) {
-		if (EVENT_DISPATCH_THREADS[my_id] == thread) {
-			break;
-		}
+	if (!eventp) {
+		return AGC_STATUS_GENERR;
 	}
 
-	agc_mutex_lock(EVENTSTATE_MUTEX);
-	EVENT_DISPATCH_QUEUE_RUNNING[my_id] = 1;
+	if (SYSTEM_RUNNING == 0) {
+		agc_event_destroy(event);
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (eventp->debug_id) {
+		agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d received.\n", eventp->debug_id);
+	}
+
+	eventp->fired = agc_time_now();
+	eventp->displacing = 0;
+	eventp->priority = priority < EVENT_PRIORITY_CLASSES ? priority : EVENT_PRIORITY[eventp->event_id];
+
+	for (;;) {
+		unsigned int count = agc_load_acquire(&MAX_DISPATCHER);
+
+		if (eventp->source_id != EVENT_NULL_SOURCEID) {
+			queue_index = agc_event_dispatch_index(eventp->source_id, count);
+			dispatcher = &EVENT_DISPATCHERS[queue_index];
+			queue = dispatcher->queue;
+		} else {
+			// the shorter of two random queues, idle dispatchers steal the rest
+			int other = agc_random(count);
+
+			queue_index = agc_random(count);
+			if (agc_queue_size(EVENT_DISPATCHERS[other].unordered) < agc_queue_size(EVENT_DISPATCHERS[queue_index].unordered)) {
+				queue_index = other;
+			}
+			dispatcher = &EVENT_DISPATCHERS[queue_index];
+			queue = dispatcher->unordered;
+		}
+
+		// the other classes have one queue for the events with and without a source
+		if (eventp->priority != EVENT_PRIORITY_NORMAL) {
+			queue = dispatcher->classes[eventp->priority].queue;
+		}
+
+		// a resize publishes the count, then waits for inflight, so one of the two sees the other
+		agc_fetch_add(&dispatcher->inflight, 1);
+		if (__atomic_load_n(&MAX_DISPATCHER, __ATOMIC_SEQ_CST) == count) {
+			break;
+		}
+		agc_fetch_add(&dispatcher->inflight, -1);
+	}
+
+	if (!queue) {
+		agc_fetch_add(&dispatcher->inflight, -1);
+		return AGC_STATUS_GENERR;
+	}
+
+	if ((status = agc_event_enqueue(dispatcher, queue, event, wait)) == AGC_STATUS_SUCCESS) {
+		agc_event_dispatch_wakeup(dispatcher);
+		if (queue == dispatcher->unordered && !dispatcher->sleeping) {
+			agc_event_wakeup_idle();
+		}
+	}
+
+	agc_fetch_add(&dispatcher->inflight, -1);
+	return status;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fire_batch(agc_event_t **events, int n)
+{
+	agc_event_t *group[DISPATCH_FIRE_BATCH];
+	int targets[DISPATCH_FIRE_BATCH];
+	agc_status_t status = AGC_STATUS_SUCCESS;
+	agc_time_t now;
+	unsigned int count;
+	int start, size, i, j, k, target, other, unordered;
+
+	if (!events || n < 0) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (SYSTEM_RUNNING == 0) {
+		for (i = 0; i < n; i++) {
+			agc_event_destroy(&events[i]);
+		}
+		return AGC_STATUS_SUCCESS;
+	}
+
+	now = agc_time_now();
+
+	for (start = 0; start < n; start += DISPATCH_FIRE_BATCH) {
+		size = n - start < DISPATCH_FIRE_BATCH ? n - start : DISPATCH_FIRE_BATCH;
+		count = agc_load_acquire(&MAX_DISPATCHER);
+
+		// the events without a source go to one unordered queue, the shorter of two
+		unordered = agc_random(count);
+		other = agc_random(count);
+		if (agc_queue_size(EVENT_DISPATCHERS[other].unordered) < agc_queue_size(EVENT_DISPATCHERS[unordered].unordered)) {
+			unordered = other;
+		}
+
+		for (i = 0; i < size; i++) {
+			agc_event_t *eventp = events[start + i];
+
+			if (!eventp) {
+				targets[i] = -1;
+				continue;
+			}
+
+			if (eventp->debug_id) {
+				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d received.\n", eventp->debug_id);
+			}
+
+			eventp->fired = now;
+			eventp->displacing = 0;
+			eventp->priority = EVENT_PRIORITY[eventp->event_id];
+			if (eventp->source_id != EVENT_NULL_SOURCEID) {
+				targets[i] = agc_event_dispatch_index(eventp->source_id, count);
+			} else {
+				targets[i] = DISPATCH_LIMIT + unordered;
+			}
+
+			if (eventp->priority != EVENT_PRIORITY_NORMAL) {
+				targets[i] = (targets[i] % DISPATCH_LIMIT) + DISPATCH_LIMIT * (2 + eventp->priority);
+			}
+		}
+
+		// one group per target, in the order the events were given
+		for (i = 0; i < size; i++) {
+			if ((target = targets[i]) < 0) {
+				continue;
+			}
+
+			for (j = i, k = 0; j < size; j++) {
+				if (targets[j] == target) {
+					group[k++] = events[start + j];
+					events[start + j] = NULL;
+					targets[j] = -1;
+				}
+			}
+
+			if (agc_event_fire_group(target, count, group, k) != AGC_STATUS_SUCCESS) {
+				status = AGC_STATUS_FALSE;
+			}
+		}
+	}
+
+	return status;
+}
+
+/*
+ * Queue the events of one dispatcher, as many as fit with one push and the rest one by one
+ * under the overflow policy. target / DISPATCH_LIMIT picks the queue of the dispatcher:
+ * 0 the ordered one, 1 the unordered one, 2 + class the queue of a class other than normal.
+ */
+static agc_status_t agc_event_fire_group(int target, unsigned int count, agc_event_t **group, int n)
+{
+	event_dispatcher_t *dispatcher;
+	agc_queue_t *queue;
+	agc_status_t status = AGC_STATUS_SUCCESS;
+	unsigned int pushed = 0;
+	int i;
+
+	dispatcher = &EVENT_DISPATCHERS[target % DISPATCH_LIMIT];
+	if (target >= 2 * DISPATCH_LIMIT) {
+		queue = dispatcher->classes[target / DISPATCH_LIMIT - 2].queue;
+	} else if (target >= DISPATCH_LIMIT) {
+		queue = dispatcher->unordered;
+	} else {
+		queue = dispatcher->queue;
+	}
+
+	// the pool was resized since the targets were chosen, fire them one by one
+	agc_fetch_add(&dispatcher->inflight, 1);
+	if (__atomic_load_n(&MAX_DISPATCHER, __ATOMIC_SEQ_CST) != count) {
+		agc_fetch_add(&dispatcher->inflight, -1);
+		for (i = 0; i < n; i++) {
+			if (agc_event_fire(&group[i]) != AGC_STATUS_SUCCESS) {
+				status = AGC_STATUS_FALSE;
+			}
+		}
+		return status;
+	}
+
+	// spilled events are ahead of these
+	if (!agc_load_acquire(&agc_event_spill_list(dispatcher, queue)->count)) {
+		pushed = agc_queue_trypush_bulk(queue, (void **) group, n);
+	}
+
+	for (i = pushed; i < n; i++) {
+		if (agc_event_enqueue(dispatcher, queue, &group[i], AGC_TRUE) != AGC_STATUS_SUCCESS) {
+			status = AGC_STATUS_FALSE;
+		}
+	}
+
+	agc_event_dispatch_wakeup(dispatcher);
+	if (queue == dispatcher->unordered && !dispatcher->sleeping) {
+		agc_event_wakeup_idle();
+	}
+
+	agc_fetch_add(&dispatcher->inflight, -1);
+	return status;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_request(agc_event_t **event, uint32_t timeout_ms, agc_event_reply_func callback, void *data)
+{
+	agc_event_t *eventp, *expire = NULL;
+	event_request_t *request;
+	event_request_shard_t *shard;
+	agc_status_t status;
+	uint64_t id;
+
+	if (!event || !(eventp = *event) || eventp->call_back || !callback || !timeout_ms) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (!(request = (event_request_t *) calloc(1, sizeof(event_request_t)))) {
+		return AGC_STATUS_MEMERR;
+	}
+
+	id = agc_fetch_add(&EVENT_REQUEST_ID, 1) + 1;
+	request->id = id;
+	request->source = eventp->source_id;
+	request->callback = callback;
+	request->data = data;
+	request->refs = 2;
+
+	agc_event_del_header(eventp, EVENT_HEADER_CORRELATION);
+	if (agc_event_create_callback(&expire, request->source, request, agc_event_request_expire) != AGC_STATUS_SUCCESS ||
+		agc_event_add_header(eventp, EVENT_HEADER_CORRELATION, "%" PRIu64, id) != AGC_STATUS_SUCCESS) {
+		agc_event_destroy(&expire);
+		free(request);
+		return AGC_STATUS_GENERR;
+	}
+
+	// pending before it is fired, the reply may come back first
+	shard = &EVENT_REQUESTS[id % EVENT_REQUEST_SHARDS];
+	agc_mutex_lock(shard->mutex);
+	request->next = shard->buckets[(id / EVENT_REQUEST_SHARDS) % EVENT_REQUEST_BUCKETS];
+	shard->buckets[(id / EVENT_REQUEST_SHARDS) % EVENT_REQUEST_BUCKETS] = request;
+	agc_fetch_add(&EVENT_REQUESTS_PENDING, 1);
+	agc_mutex_unlock(shard->mutex);
+
+	if ((status = agc_event_fire(event)) != AGC_STATUS_SUCCESS) {
+		// dropped, nothing can answer it
+		if (agc_event_request_remove(id, NULL)) {
+			agc_event_request_release(request);
+		}
+
+		agc_event_request_release(request);
+		agc_event_destroy(&expire);
+		return status;
+	}
+
+	agc_timer_add_timer(expire, timeout_ms);
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_set_reply(agc_event_t *request, agc_event_t *reply)
+{
+	const char *id;
+
+	if (!request || !reply || !(id = agc_event_get_header_atom(request, EVENT_ATOM_CORRELATION))) {
+		return AGC_STATUS_GENERR;
+	}
+
+	agc_event_del_header(reply, EVENT_HEADER_REPLY);
+	reply->source_id = request->source_id;
+	return agc_event_add_header_string(reply, EVENT_HEADER_REPLY, id);
+}
+
+AGC_DECLARE(void) agc_event_request_stats(uint32_t *pending, uint64_t *timeouts)
+{
+	if (pending) {
+		*pending = agc_load_acquire(&EVENT_REQUESTS_PENDING);
+	}
+
+	if (timeouts) {
+		*timeouts = agc_load_acquire(&EVENT_REQUESTS_TIMEOUT);
+	}
+}
+
+/*
+ * Unlink a pending request. With a reply from another source nothing is unlinked,
+ * the reply gets the requester's source instead so its dispatcher takes it.
+ */
+static event_request_t *agc_event_request_remove(uint64_t id, agc_event_t *reply)
+{
+	event_request_shard_t *shard = &EVENT_REQUESTS[id % EVENT_REQUEST_SHARDS];
+	event_request_t **link, *request;
+
+	agc_mutex_lock(shard->mutex);
+	for (link = &shard->buckets[(id / EVENT_REQUEST_SHARDS) % EVENT_REQUEST_BUCKETS]; (request = *link); link = &request->next) {
+		if (request->id != id) {
+			continue;
+		}
+
+		if (reply && request->source != EVENT_NULL_SOURCEID && reply->source_id != request->source) {
+			reply->source_id = request->source;
+			request = NULL;
+		} else {
+			*link = request->next;
+			agc_fetch_add(&EVENT_REQUESTS_PENDING, -1);
+		}
+		break;
+	}
+	agc_mutex_unlock(shard->mutex);
+
+	return request;
+}
+
+static void agc_event_request_release(event_request_t *request)
+{
+	if (agc_fetch_add(&request->refs, -1) == 1) {
+		free(request);
+	}
+}
+
+/* the timeout event, on the requester's dispatcher as well */
+static void agc_event_request_expire(void *data)
+{
+	event_request_t *request = (event_request_t *) data;
+
+	if (agc_event_request_remove(request->id, NULL)) {
+		agc_fetch_add(&EVENT_REQUESTS_TIMEOUT, 1);
+		request->callback(NULL, request->data);
+		agc_event_request_release(request);
+	}
+
+	agc_event_request_release(request);
+}
+
+/*
+ * At shutdown the pending requests time out on the calling thread,
+ * their timeout events are not delivered any more.
+ */
+static void agc_event_request_sweep(void)
+{
+	event_request_shard_t *shard;
+	event_request_t *request;
+	int i, j;
+
+	for (i = 0; i < EVENT_REQUEST_SHARDS; i++) {
+		shard = &EVENT_REQUESTS[i];
+		for (j = 0; j < EVENT_REQUEST_BUCKETS; j++) {
+			for (;;) {
+				agc_mutex_lock(shard->mutex);
+				if ((request = shard->buckets[j])) {
+					shard->buckets[j] = request->next;
+					agc_fetch_add(&EVENT_REQUESTS_PENDING, -1);
+				}
+				agc_mutex_unlock(shard->mutex);
+
+				if (!request) {
+					break;
+				}
+
+				agc_fetch_add(&EVENT_REQUESTS_TIMEOUT, 1);
+				request->callback(NULL, request->data);
+				agc_event_request_release(request);
+			}
+		}
+	}
+}
+
+/* correlation headers are local, a received event can not answer or pose as a request */
+static void agc_event_strip_ingress(agc_event_t *event)
+{
+	agc_event_del_header(event, EVENT_HEADER_REPLY);
+	agc_event_del_header(event, EVENT_HEADER_CORRELATION);
+}
+
+/*
+ * Give a reply to its pending request, AGC_TRUE when it was taken.
+ * A reply delivered by another dispatcher is fired again and *event set to NULL.
+ */
+static agc_bool_t agc_event_request_reply(agc_event_t **event)
+{
+	agc_event_t *reply = *event;
+	event_request_t *request;
+	const char *value;
+	uint64_t source = reply->source_id;
+	uint64_t id;
+
+	if (!(value = agc_event_get_header_atom(reply, EVENT_ATOM_REPLY)) || !(id = strtoull(value, NULL, 10))) {
+		return AGC_FALSE;
+	}
+
+	if (!(request = agc_event_request_remove(id, reply))) {
+		if (reply->source_id == source) {
+			// timed out already, or the request of another process
+			return AGC_FALSE;
+		}
+
+		// the overflow policy does not apply to replies, nothing was dropped unless it succeeded
+		if (agc_event_try_fire(event) == AGC_STATUS_SUCCESS) {
+			*event = NULL;
+			return AGC_TRUE;
+		}
+
+		// the requester's dispatcher is full, answer here
+		if (!(request = agc_event_request_remove(id, NULL))) {
+			return AGC_FALSE;
+		}
+	}
+
+	request->callback(reply, request->data);
+	agc_event_request_release(request);
+
+	return AGC_TRUE;
+}
+
+/* queue an event, apply the overflow policy of its id when the queue is full */
+static agc_status_t agc_event_enqueue(event_dispatcher_t *dispatcher, agc_queue_t *queue, agc_event_t **event, agc_bool_t wait)
+{
+	agc_event_t *eventp = *event;
+	int event_id = eventp->event_id;
+	// callbacks such as timers and request timeouts are never dropped, they wait or are retried
+	agc_event_overflow_t policy = eventp->call_back ? EVENT_OVERFLOW_BLOCK : (agc_event_overflow_t) EVENT_OVERFLOW_POLICY[event_id];
+	event_spill_list_t *list = agc_event_spill_list(dispatcher, queue);
+	agc_status_t status;
+	agc_time_t start;
+	agc_bool_t spilling;
+
+	// neither are replies, their request would time out though it was answered
+	if (policy != EVENT_OVERFLOW_BLOCK && agc_load_acquire(&EVENT_REQUESTS_PENDING) && agc_event_get_header_atom(eventp, EVENT_ATOM_REPLY)) {
+		policy = EVENT_OVERFLOW_BLOCK;
+	}
+
+	// once spilling, the later events of the id go behind the spilled ones of their queue
+	spilling = (policy == EVENT_OVERFLOW_SPILL || policy == EVENT_OVERFLOW_DROP_OLDEST) && agc_load_acquire(&list->count);
+
+	if (!spilling && agc_queue_trypush(queue, eventp) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	switch (policy) {
+	case EVENT_OVERFLOW_DROP_OLDEST:
+		// only the events of a source are in order, there is no oldest among the others
+		if (eventp->source_id != EVENT_NULL_SOURCEID) {
+			return agc_event_spill_evict(dispatcher, list, event);
+		}
+		agc_event_destroy(event);
+		agc_fetch_add(&dispatcher->dropped, 1);
+		return AGC_STATUS_FALSE;
+	case EVENT_OVERFLOW_DROP_NEWEST:
+		agc_event_destroy(event);
+		agc_fetch_add(&dispatcher->dropped, 1);
+		return AGC_STATUS_FALSE;
+	case EVENT_OVERFLOW_SPILL:
+		return agc_event_spill(dispatcher, list, event);
+	default:
+		break;
+	}
+
+	if (!wait) {
+		return AGC_STATUS_BREAK;
+	}
+
+	start = agc_time_now();
+	agc_queue_push(queue, eventp);
+	agc_fetch_add(&dispatcher->blocked, 1);
+	agc_fetch_add(&dispatcher->blocked_us, agc_time_now() - start);
+
+	return AGC_STATUS_SUCCESS;
+}
+
+static event_spill_list_t *agc_event_spill_list(event_dispatcher_t *dispatcher, agc_queue_t *queue)
+{
+	int i;
+
+	for (i = 0; i < EVENT_SPILL_LISTS - 1; i++) {
+		if (dispatcher->spills[i].queue == queue) {
+			break;
+		}
+	}
+
+	return &dispatcher->spills[i];
+}
+
+/* called with spill_mutex */
+static void agc_event_spill_append(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t *event)
+{
+	event->next = NULL;
+	if (list->tail) {
+		list->tail->next = event;
+	} else {
+		list->head = event;
+	}
+	list->tail = event;
+	agc_store_release(&list->count, list->count + 1);
+	agc_store_release(&dispatcher->spill_count, dispatcher->spill_count + 1);
+}
+
+static agc_status_t agc_event_spill(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t **event)
+{
+	agc_mutex_lock(dispatcher->spill_mutex);
+
+	if (dispatcher->spill_count >= DISPATCH_SPILL_LIMIT) {
+		agc_mutex_unlock(dispatcher->spill_mutex);
+		agc_event_destroy(event);
+		agc_fetch_add(&dispatcher->dropped, 1);
+		return AGC_STATUS_FALSE;
+	}
+
+	agc_event_spill_append(dispatcher, list, *event);
+
+	agc_mutex_unlock(dispatcher->spill_mutex);
+
+	agc_fetch_add(&dispatcher->spilled, 1);
+	return AGC_STATUS_SUCCESS;
+}
+
+/*
+ * EVENT_OVERFLOW_DROP_OLDEST: spill the event, the dispatcher drops an event of its source and id
+ * queued before it instead. The spilled event is never dropped for that, without an older one
+ * both are delivered. The newest is dropped when the slots of the queue are taken.
+ */
+static agc_status_t agc_event_spill_evict(event_dispatcher_t *dispatcher, event_spill_list_t *list, agc_event_t **event)
+{
+	agc_event_t *eventp = *event;
+	event_evict_t *evict = NULL;
+	int i;
+
+	agc_mutex_lock(dispatcher->spill_mutex);
+
+	for (i = 0; i < EVENT_EVICT_SLOTS; i++) {
+		event_evict_t *slot = &list->evict[i];
+
+		if (!slot->count) {
+			if (!evict) {
+				evict = slot;
+			}
+		} else if (slot->event_id == eventp->event_id && slot->source_id == eventp->source_id) {
+			evict = slot;
+			break;
+		}
+	}
+
+	if (!evict || dispatcher->spill_count >= DISPATCH_SPILL_LIMIT) {
+		agc_mutex_unlock(dispatcher->spill_mutex);
+		agc_event_destroy(event);
+		agc_fetch_add(&dispatcher->dropped, 1);
+		return AGC_STATUS_FALSE;
+	}
+
+	if (!evict->count) {
+		evict->event_id = eventp->event_id;
+		evict->source_id = eventp->source_id;
+		// what is queued of the source was fired before, what comes later is spilled behind
+		evict->before = eventp->fired;
+		agc_store_release(&list->evicting, list->evicting + 1);
+	}
+
+	evict->count++;
+	eventp->displacing = 1;
+	agc_event_spill_append(dispatcher, list, eventp);
+
+	agc_mutex_unlock(dispatcher->spill_mutex);
+
+	agc_fetch_add(&dispatcher->spilled, 1);
+	return AGC_STATUS_SUCCESS;
+}
+
+/* the event is dropped for a newer one of its source and id spilled from its queue, called by the dispatcher */
+static agc_bool_t agc_event_evicted(event_dispatcher_t *dispatcher, agc_event_t *event)
+{
+	event_spill_list_t *list;
+	agc_queue_t *queue;
+	agc_bool_t evicted = AGC_FALSE;
+	int i;
+
+	// callbacks are never dropped, stolen events have no source
+	if (event->call_back || event->source_id == EVENT_NULL_SOURCEID) {
+		return AGC_FALSE;
+	}
+
+	queue = event->priority != EVENT_PRIORITY_NORMAL ? dispatcher->classes[event->priority].queue : dispatcher->queue;
+	list = agc_event_spill_list(dispatcher, queue);
+	if (!agc_load_acquire(&list->evicting)) {
+		return AGC_FALSE;
+	}
+
+	agc_mutex_lock(dispatcher->spill_mutex);
+
+	for (i = 0; i < EVENT_EVICT_SLOTS; i++) {
+		event_evict_t *evict = &list->evict[i];
+
+		if (!evict->count || evict->event_id != event->event_id || evict->source_id != event->source_id) {
+			continue;
+		}
+
+		if (!event->displacing && event->fired <= evict->before) {
+			evicted = AGC_TRUE;
+			evict->count--;
+		} else {
+			// the older ones of the source are passed, the rest of the spilled ones are kept
+			evict->count = 0;
+		}
+
+		if (!evict->count) {
+			agc_store_release(&list->evicting, list->evicting - 1);
+		}
+		break;
+	}
+
+	agc_mutex_unlock(dispatcher->spill_mutex);
+
+	return evicted;
+}
+
+/* move spilled events back into their queues as far as they have room, called by the dispatcher */
+static void agc_event_unspill(event_dispatcher_t *dispatcher)
+{
+	agc_event_t *eventp;
+	int i;
+
+	if (!agc_load_acquire(&dispatcher->spill_count)) {
+		return;
+	}
+
+	agc_mutex_lock(dispatcher->spill_mutex);
+
+	for (i = 0; i < EVENT_SPILL_LISTS; i++) {
+		event_spill_list_t *list = &dispatcher->spills[i];
+
+		while ((eventp = list->head)) {
+			if (agc_queue_trypush(list->queue, eventp) != AGC_STATUS_SUCCESS) {
+				break;
+			}
+
+			if (!(list->head = eventp->next)) {
+				list->tail = NULL;
+			}
+			eventp->next = NULL;
+			list->count--;
+			dispatcher->spill_count--;
+		}
+
+		agc_store_release(&list->count, list->count);
+	}
+
+	agc_store_release(&dispatcher->spill_count, dispatcher->spill_count);
+	agc_mutex_unlock(dispatcher->spill_mutex);
+}
+
+AGC_DECLARE(int) agc_event_dispatcher_count(void)
+{
+	return agc_load_acquire(&MAX_DISPATCHER);
+}
+
+AGC_DECLARE(int) agc_event_dispatcher_capacity(void)
+{
+	return DISPATCH_CAPACITY;
+}
+
+/*
+ * Sources are mapped with a jump consistent hash, so growing from n to m dispatchers
+ * moves the sources of (m - n) / m of them, all to the new dispatchers, and shrinking moves
+ * only the sources of the removed ones.
+ * The dispatchers which get sources put the events of the moving ones aside until the
+ * dispatchers losing them delivered what was queued before the switch, which keeps the order
+ * of every source. The other sources go on meanwhile.
+ * A dispatcher waits for the fences of its peers, so it can not resize the pool itself.
+ */
+AGC_DECLARE(agc_status_t) agc_event_resize_dispatchers(int count)
+{
+	unsigned int old, i, first_gain, last_gain, first_lose, last_lose;
+	uint64_t epoch;
+
+	if (!EVENT_DISPATCHERS || !SYSTEM_RUNNING || count < 1 || count > DISPATCH_CAPACITY) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (agc_event_on_dispatcher()) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Event dispatchers can not be resized from a dispatch thread.\n");
+		return AGC_STATUS_GENERR;
+	}
+
+	agc_mutex_lock(DISPATCH_RESIZE_MUTEX);
+
+	if ((old = MAX_DISPATCHER) == count) {
+		agc_mutex_unlock(DISPATCH_RESIZE_MUTEX);
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (count > old) {
+		first_gain = old;
+		last_gain = count;
+		first_lose = 0;
+		last_lose = old;
+	} else {
+		first_gain = 0;
+		last_gain = count;
+		first_lose = count;
+		last_lose = old;
+	}
+
+	DISPATCH_RESIZE_FROM = old;
+	DISPATCH_RESIZE_TO = count;
+
+	for (i = first_gain; i < last_gain; i++) {
+		event_dispatcher_t *dispatcher = &EVENT_DISPATCHERS[i];
+
+		agc_store_release(&dispatcher->hold, 1);
+		if (i < old) {
+			continue;
+		}
+
+		if (!dispatcher->queue) {
+			agc_event_dispatcher_setup(dispatcher, i);
+		}
+
+		// a removed dispatcher may still be draining, it simply stays
+		agc_mutex_lock(EVENTSTATE_MUTEX);
+		dispatcher->retiring = 0;
+		agc_mutex_unlock(EVENTSTATE_MUTEX);
+
+		if (!dispatcher->running) {
+			agc_event_launch_dispatch_thread(dispatcher);
+		}
+	}
+
+	// a dispatcher popping right now may not have seen hold yet, wait for its next quiescent state
+	epoch = agc_fetch_add(&RCU_EPOCH, 1) + 1;
+	for (i = first_gain; i < last_gain; i++) {
+		uint64_t seen;
+
+		while ((seen = agc_load_acquire(&EVENT_DISPATCHERS[i].rcu_epoch)) && seen < epoch) {
+			agc_yield(100);
+		}
+	}
+
+	__atomic_store_n(&MAX_DISPATCHER, count, __ATOMIC_SEQ_CST);
+
+	// producers which mapped with the old count finish their push
+	for (i = first_lose; i < last_lose; i++) {
+		while (__atomic_load_n(&EVENT_DISPATCHERS[i].inflight, __ATOMIC_SEQ_CST)) {
+			agc_yield(100);
+		}
+	}
+
+	// everything queued with the old count is delivered before the fences
+	agc_store_release(&DISPATCH_FENCES, (last_lose - first_lose) * EVENT_PRIORITY_CLASSES);
+	for (i = first_lose; i < last_lose; i++) {
+		agc_event_fence_push(&EVENT_DISPATCHERS[i]);
+	}
+
+	while (agc_load_acquire(&DISPATCH_FENCES)) {
+		agc_yield(1000);
+	}
+
+	for (i = count; i < old; i++) {
+		agc_store_release(&EVENT_DISPATCHERS[i].retiring, 1);
+		agc_event_dispatch_wakeup(&EVENT_DISPATCHERS[i]);
+	}
+
+	for (i = first_gain; i < last_gain; i++) {
+		agc_store_release(&EVENT_DISPATCHERS[i].hold, 0);
+		agc_event_dispatch_wakeup(&EVENT_DISPATCHERS[i]);
+	}
+
+	// the next resize maps differently, what was put aside goes out with this one
+	for (i = first_gain; i < last_gain; i++) {
+		int priority;
+
+		for (priority = 0; priority < EVENT_PRIORITY_CLASSES; priority++) {
+			while (SYSTEM_RUNNING && agc_load_acquire(&EVENT_DISPATCHERS[i].classes[priority].held_count)) {
+				agc_yield(1000);
+			}
+		}
+	}
+
+	agc_mutex_unlock(DISPATCH_RESIZE_MUTEX);
+
+	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Event dispatchers resized from %d to %d.\n", old, count);
+	return AGC_STATUS_SUCCESS;
+}
+
+/* jump consistent hash (Lamping and Veach) */
+static inline unsigned int agc_event_dispatch_index(uint64_t source_id, unsigned int buckets)
+{
+	uint64_t key = source_id;
+	int64_t b = -1, j = 0;
+
+	while (j < buckets) {
+		b = j;
+		key = key * 2862933555777941757ULL + 1;
+		j = (int64_t) ((b + 1) * ((double) (1LL << 31) / (double) ((key >> 33) + 1)));
+	}
+
+	return (unsigned int) b;
+}
+
+/* queued behind the events of the sources a dispatcher loses, spilled ones included, one per class */
+static void agc_event_fence_push(event_dispatcher_t *dispatcher)
+{
+	agc_event_t *fence = NULL;
+	int i;
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		event_spill_list_t *list = &dispatcher->spills[i];
+
+		agc_event_create_callback(&fence, EVENT_NULL_SOURCEID, NULL, agc_event_fence_pass);
+		assert(fence);
+
+		// a full queue takes it later, over the spill limit if need be
+		agc_mutex_lock(dispatcher->spill_mutex);
+		if (list->count || agc_queue_trypush(list->queue, fence) != AGC_STATUS_SUCCESS) {
+			agc_event_spill_append(dispatcher, list, fence);
+		}
+		agc_mutex_unlock(dispatcher->spill_mutex);
+	}
+
+	agc_event_dispatch_wakeup(dispatcher);
+}
+
+static void agc_event_fence_pass(void *data)
+{
+	agc_fetch_add(&DISPATCH_FENCES, -1);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_get_dispatch_stats(int index, agc_event_dispatch_stats_t *stats)
+{
+	event_dispatcher_t *dispatcher;
+
+	if (!EVENT_DISPATCHERS || index < 0 || index >= DISPATCH_SLOTS || !stats) {
+		return AGC_STATUS_GENERR;
+	}
+
+	dispatcher = &EVENT_DISPATCHERS[index];
+
+	// written by the dispatcher only, a snapshot may be slightly stale
+	memcpy(stats, &dispatcher->stats, sizeof(agc_event_dispatch_stats_t));
+
+	stats->spill_depth = agc_load_acquire(&dispatcher->spill_count);
+	stats->dropped = agc_load_acquire(&dispatcher->dropped);
+	stats->spilled = agc_load_acquire(&dispatcher->spilled);
+	stats->blocked = agc_load_acquire(&dispatcher->blocked);
+	stats->blocked_us = agc_load_acquire(&dispatcher->blocked_us);
+
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_get_latency(int event_id, agc_event_latency_t *queue_delay, agc_event_latency_t *handle)
+{
+	agc_status_t status = AGC_STATUS_NOTFOUND;
+	int i;
+
+	if (!EVENT_DISPATCHERS || event_id < 0 || event_id >= EVENT_ID_LIMIT) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (queue_delay) {
+		memset(queue_delay, 0, sizeof(agc_event_latency_t));
+	}
+
+	if (handle) {
+		memset(handle, 0, sizeof(agc_event_latency_t));
+	}
+
+	// the histograms are written by their dispatcher only, a snapshot may be slightly stale
+	for (i = 0; i < DISPATCH_SLOTS; i++) {
+		event_latency_stats_t *stats = agc_load_acquire(&EVENT_DISPATCHERS[i].latency[event_id]);
+
+		if (!stats) {
+			continue;
+		}
+
+		if (queue_delay) {
+			event_latency_merge(queue_delay, &stats->queue_delay);
+		}
+
+		if (handle) {
+			event_latency_merge(handle, &stats->handle);
+		}
+
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	return status;
+}
+
+AGC_DECLARE(uint32_t) agc_event_retired_count(void)
+{
+	return agc_load_acquire(&RCU_RETIRED_COUNT);
+}
+
+AGC_DECLARE(int) agc_event_get_subscriber_stats(int event_id, agc_event_subscriber_stats_t *stats, int max)
+{
+	agc_event_node_t *node;
+	int count = 0;
+	int i;
+
+	if (event_id < 0 || event_id >= EVENT_ID_LIMIT || !stats || max <= 0) {
+		return 0;
+	}
+
+	// retired nodes are freed under the same lock
+	agc_mutex_lock(EVENT_NODES_MUTEX);
+	for (node = EVENT_NODES[event_id]; node && count < max; node = node->next) {
+		agc_event_subscriber_stats_t *stat = &stats[count++];
+
+		memset(stat, 0, sizeof(agc_event_subscriber_stats_t));
+		agc_copy_string(stat->id, node->id, sizeof(stat->id));
+		stat->event_id = node->event_id;
+
+		for (i = 0; i < DISPATCH_SLOTS; i++) {
+			event_latency_merge(&stat->callback, &node->latency[i]);
+		}
+
+		if (node->lane) {
+			event_lane_t *lane = node->lane;
+
+			stat->async = 1;
+			for (i = 0; i < lane->workers; i++) {
+				event_latency_merge(&stat->callback, &lane->latency[i]);
+				event_latency_merge(&stat->lane_delay, &lane->delay[i]);
+			}
+			stat->lane_depth = agc_queue_size(lane->queue);
+			stat->lane_high_water = lane->high_water;
+			stat->lane_queued = lane->queued;
+			stat->lane_dropped = lane->dropped;
+			stat->lane_blocked = lane->blocked;
+			stat->lane_blocked_us = lane->blocked_us;
+		}
+	}
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+
+	return count;
+}
+
+AGC_DECLARE(uint64_t) agc_event_latency_percentile(const agc_event_latency_t *latency, double percent)
+{
+	uint64_t target, seen = 0, low, width, value;
+	int i, msb;
+
+	if (!latency || !latency->count) {
+		return 0;
+	}
+
+	target = (uint64_t) (latency->count * percent / 100.0);
+	if (target >= latency->count) {
+		return latency->max_us;
+	}
+
+	for (i = 0; i < EVENT_LATENCY_BUCKETS; i++) {
+		if (seen + latency->buckets[i] > target) {
+			break;
+		}
+		seen += latency->buckets[i];
+	}
+
+	if (i < 4) {
+		return i;
+	}
+
+	if (i >= EVENT_LATENCY_BUCKETS - 1) {
+		return latency->max_us;
+	}
+
+	// interpolate by rank inside the bucket, never above what was seen
+	msb = (i - 4) / 4 + 2;
+	width = (uint64_t) 1 << (msb - 2);
+	low = (uint64_t) (4 + (i - 4) % 4) << (msb - 2);
+	value = low + width * (target - seen) / latency->buckets[i];
+
+	return value < latency->max_us ? value : latency->max_us;
+}
+
+static inline void event_latency_add(agc_event_latency_t *latency, agc_time_t elapsed)
+{
+	uint64_t value = elapsed > 0 ? (uint64_t) elapsed : 0;
+	int bucket = (int) value;
+
+	if (value >= 4) {
+		int msb = 63 - __builtin_clzll(value);
+
+		bucket = 4 + 4 * (msb - 2) + (int) ((value >> (msb - 2)) & 3);
+		if (bucket >= EVENT_LATENCY_BUCKETS) {
+			bucket = EVENT_LATENCY_BUCKETS - 1;
+		}
+	}
+
+	latency->count++;
+	latency->sum_us += value;
+	latency->buckets[bucket]++;
+	if (value > latency->max_us) {
+		latency->max_us = value;
+	}
+}
+
+static void event_latency_merge(agc_event_latency_t *to, const agc_event_latency_t *from)
+{
+	int i;
+
+	to->count += from->count;
+	to->sum_us += from->sum_us;
+	if (from->max_us > to->max_us) {
+		to->max_us = from->max_us;
+	}
+
+	for (i = 0; i < EVENT_LATENCY_BUCKETS; i++) {
+		to->buckets[i] += from->buckets[i];
+	}
+}
+
+AGC_DECLARE(agc_status_t) agc_event_unbind(agc_event_node_t **node)
+{
+	int event_id = 0;
+	agc_event_node_t *event_node, *np, *lnp = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+    
+	event_node = *node;
+    
+	if (!event_node) {
+		return AGC_STATUS_GENERR;
+	}
+
+	// the workers of the lane are joined below
+	if (event_node->lane && event_node->lane == EVENT_LANE_SELF) {
+		return AGC_STATUS_GENERR;
+	}
+    
+	event_id = event_node->event_id;
+	agc_mutex_lock(EVENT_NODES_MUTEX);
+    
+	for (np = EVENT_NODES[event_id]; np; np = np->next) {
+		if (np == event_node) {
+			if (lnp) {
+				lnp->next = event_node->next;
+			} else {
+				EVENT_NODES[event_id] = event_node->next;
+			}
+            
+			agc_event_publish_subscribers(event_id);
+			// dispatchers may still be calling it
+			agc_event_retire(NULL, event_node, RCU_EPOCH);
+			*node = NULL;
+			status = AGC_STATUS_SUCCESS;
+			break;
+		} else {
+			lnp = np;
+		}
+	}
+    
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+
+	// the node is not freed before its lane is stopped
+	if (status == AGC_STATUS_SUCCESS && event_node->lane) {
+		agc_event_lane_stop(event_node->lane);
+	}
+
+	agc_event_reclaim(AGC_TRUE);
+    
+	return status;    
+}
+
+AGC_DECLARE(agc_status_t) agc_event_unbind_callback(agc_event_callback_func callback)
+{
+	agc_event_node_t *event_node, *np, *lnp = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	event_lane_t **lanes = NULL;
+	int id = 0, lane_count = 0, i;
+
+	agc_mutex_lock(EVENT_NODES_MUTEX);
+
+	for (id = 0; id < EVENT_ID_LIMIT; id++) {
+		lnp = NULL;
+	    
+		for (np = EVENT_NODES[id]; np;) {
+			event_node = np;
+			np = np->next;
+	        
+			if (event_node->callback == callback && (!event_node->lane || event_node->lane != EVENT_LANE_SELF)) {
+				if (lnp) {
+					lnp->next = event_node->next;
+				} else {
+					EVENT_NODES[id] = event_node->next;
+				}
+	            
+				agc_event_publish_subscribers(id);
+				agc_event_retire(NULL, event_node, RCU_EPOCH);
+				if (event_node->lane) {
+					lanes = (event_lane_t **) realloc(lanes, (lane_count + 1) * sizeof(event_lane_t *));
+					assert(lanes);
+					lanes[lane_count++] = event_node->lane;
+				}
+				status = AGC_STATUS_SUCCESS;
+				break;
+			} else {
+				lnp = event_node;
+			}
+		}
+	}
+
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+
+	for (i = 0; i < lane_count; i++) {
+		agc_event_lane_stop(lanes[i]);
+	}
+	agc_safe_free(lanes);
+
+	agc_event_reclaim(AGC_TRUE);
+	return status;
+}
+
+/*
+ * Subscribers are read without lock by the dispatchers (quiescent state based reclamation).
+ * Writers hold EVENT_NODES_MUTEX, build a new snapshot of the list and publish it,
+ * the old snapshot and the unbound nodes are retired with the epoch they were replaced in.
+ * A dispatcher passes a quiescent state between two batches and is offline while parked, 
+ * a retired entry is freed once every online dispatcher has observed a newer epoch.
+ */
+static void agc_event_publish_subscribers(int event_id)
+{
+	event_subscribers_t *subs = NULL;
+	event_subscribers_t *old = EVENT_SUBSCRIBERS[event_id];
+	agc_event_node_t *np;
+	event_filter_term_t *key;
+	int count = 0, entries = 0, i;
+
+	for (np = EVENT_NODES[event_id]; np; np = np->next) {
+		if (np->filter && np->filter->key >= 0) {
+			entries += np->filter->terms[np->filter->key].count;
+		} else {
+			count++;
+		}
+	}
+
+	if (count || entries) {
+		// nodes, entries and atoms in one block, freed together
+		subs = malloc(sizeof(event_subscribers_t) + count * sizeof(agc_event_node_t *) + 
+					  entries * (sizeof(event_filter_entry_t) + sizeof(uint32_t)));
+		assert(subs);
+		subs->count = 0;
+		subs->entry_count = 0;
+		subs->atom_count = 0;
+		subs->lanes = 0;
+		subs->entries = (event_filter_entry_t *) &subs->nodes[count];
+		subs->atoms = (uint32_t *) &subs->entries[entries];
+
+		for (np = EVENT_NODES[event_id]; np; np = np->next) {
+			if (np->lane) {
+				subs->lanes++;
+			}
+
+			if (!np->filter || np->filter->key < 0) {
+				subs->nodes[subs->count++] = np;
+				continue;
+			}
+
+			key = &np->filter->terms[np->filter->key];
+			for (i = 0; i < key->count; i++) {
+				event_filter_entry_t *entry = &subs->entries[subs->entry_count++];
+
+				entry->atom = key->atom;
+				entry->hash = event_filter_hash(key->values[i]);
+				entry->value = key->values[i];
+				entry->node = np;
+			}
+		}
+
+		qsort(subs->entries, subs->entry_count, sizeof(event_filter_entry_t), event_filter_entry_cmp);
+		for (i = 0; i < subs->entry_count; i++) {
+			if (!i || subs->entries[i].atom != subs->entries[i - 1].atom) {
+				subs->atoms[subs->atom_count++] = subs->entries[i].atom;
+			}
+		}
+	}
+
+	agc_store_release(&EVENT_SUBSCRIBERS[event_id], subs);
+
+	// readers entering from now on see the new snapshot
+	agc_fetch_add(&RCU_EPOCH, 1);
+
+	if (old) {
+		agc_event_retire(old, NULL, RCU_EPOCH);
+	}
+}
+
+static void agc_event_retire(event_subscribers_t *subs, agc_event_node_t *node, uint64_t epoch)
+{
+	event_retired_t *retired = malloc(sizeof(event_retired_t));
+
+	assert(retired);
+	retired->epoch = epoch;
+	retired->subs = subs;
+	retired->node = node;
+	retired->next = RCU_RETIRED;
+	RCU_RETIRED = retired;
+	agc_fetch_add(&RCU_RETIRED_COUNT, 1);
+}
+
+static agc_bool_t agc_event_on_dispatcher(void)
+{
+	agc_thread_id_t self = agc_thread_self();
+	int i;
+
+	for (i = 0; EVENT_DISPATCHERS && i < DISPATCH_SLOTS; i++) {
+		if (EVENT_DISPATCHERS[i].running && agc_thread_equal(EVENT_DISPATCHERS[i].tid, self)) {
+			return AGC_TRUE;
+		}
+	}
+
+	return AGC_FALSE;
+}
+
+static void agc_event_reclaim(agc_bool_t wait)
+{
+	event_retired_t *retired, *next, **prev;
+	uint64_t min_epoch = 0;
+	int i;
+
+	if (!agc_load_acquire(&RCU_RETIRED)) {
+		return;
+	}
+
+	// a dispatcher can not wait for itself, it leaves the retired entries to the next quiescent state
+	if (wait && agc_event_on_dispatcher()) {
+		wait = AGC_FALSE;
+	}
+
+	if (wait) {
+		agc_mutex_lock(EVENT_NODES_MUTEX);
+	} else if (agc_mutex_trylock(EVENT_NODES_MUTEX) != AGC_STATUS_SUCCESS) {
+		return;
+	}
+
+	for (;;) {
+		min_epoch = RCU_EPOCH;
+		for (i = 0; EVENT_DISPATCHERS && i < DISPATCH_SLOTS; i++) {
+			uint64_t epoch = agc_load_acquire(&EVENT_DISPATCHERS[i].rcu_epoch);
+
+			if (epoch && epoch < min_epoch) {
+				min_epoch = epoch;
+			}
+		}
+
+		prev = &RCU_RETIRED;
+		for (retired = RCU_RETIRED; retired; retired = next) {
+			next = retired->next;
+			if (retired->epoch <= min_epoch && (!retired->node || !retired->node->lane || agc_load_acquire(&retired->node->lane->stopped))) {
+				*prev = next;
+				if (retired->node) {
+					if (retired->node->lane) {
+						agc_event_lane_destroy(retired->node->lane);
+					}
+					agc_safe_free(retired->node->id);
+					agc_safe_free(retired->node->latency);
+					agc_event_filter_destroy(&retired->node->filter);
+					agc_safe_free(retired->node);
+				}
+				agc_safe_free(retired->subs);
+				agc_safe_free(retired);
+				agc_fetch_add(&RCU_RETIRED_COUNT, -1);
+			} else {
+				prev = &retired->next;
+			}
+		}
+
+		if (!wait || !RCU_RETIRED) {
+			break;
+		}
+
+		agc_mutex_unlock(EVENT_NODES_MUTEX);
+		agc_yield(1000);
+		agc_mutex_lock(EVENT_NODES_MUTEX);
+	}
+
+	agc_mutex_unlock(EVENT_NODES_MUTEX);
+}
+
+static inline void agc_event_rcu_online(event_dispatcher_t *dispatcher)
+{
+	__atomic_store_n(&dispatcher->rcu_epoch, agc_load_acquire(&RCU_EPOCH), __ATOMIC_SEQ_CST);
+	agc_memory_barrier();
+}
+
+static inline void agc_event_rcu_offline(event_dispatcher_t *dispatcher)
+{
+	agc_store_release(&dispatcher->rcu_epoch, 0);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_json_obj(agc_event_t *event, cJSON **json)
+{
+	agc_event_header_t *hp;
+	cJSON *cj;
+	char str_evtid[25];
+
+	cj = cJSON_CreateObject();
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		cJSON_AddItemToObject(cj, hp->name, cJSON_CreateString(event_header_text(hp)));
+	}
+    
+	agc_snprintf(str_evtid, sizeof(str_evtid), "%d", event->event_id);
+	 cJSON_AddItemToObject(cj, "_id", cJSON_CreateString(str_evtid));
+
+	if (event_templates[event->event_id]) {
+		cJSON_AddItemToObject(cj, "_name", cJSON_CreateString(event_templates[event->event_id]));
+	}
+
+	if (event->body) {
+		int blen = (int) strlen(event->body);
+		char tmp[25];
+
+		agc_snprintf(tmp, sizeof(tmp), "%d", blen);
+
+		cJSON_AddItemToObject(cj, "_length", cJSON_CreateString(tmp));
+		cJSON_AddItemToObject(cj, "_body", cJSON_CreateString(event->body));
+	}
+
+	*json = cj;
+
+	return AGC_STATUS_SUCCESS;
+
+}
+
+AGC_DECLARE(agc_status_t) agc_event_create_json(agc_event_t **event, const char *json)
+{
+	agc_event_t *new_event = NULL;
+	agc_size_t len;
+	size_t size;
+	char *ptr, *name, *value;
+
+	if (!json || (len = strnlen(json, EVENT_JSON_MAX + 1)) > EVENT_JSON_MAX) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Oversize event received.\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	// room for the text and a header per 16 bytes of it in one block
+	size = EVENT_ARENA_ALIGN(sizeof(agc_event_t)) + EVENT_ARENA_ALIGN(sizeof(event_arena_t)) + EVENT_ARENA_ALIGN(len + 1);
+	size += (len / 16 + 1) * EVENT_ARENA_ALIGN(sizeof(agc_event_header_t));
+
+	if (event_create_sized(&new_event, 0, EVENT_NULL_SOURCEID, size) != AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_FALSE;
+	}
+
+	// the text is copied once and unescaped in place, names and values point into it
+	if (!(ptr = event_arena_alloc(new_event, len + 1))) {
+		agc_event_destroy(&new_event);
+		return AGC_STATUS_FALSE;
+	}
+	memcpy(ptr, json, len + 1);
+
+	ptr = event_json_skip(ptr);
+	if (*ptr++ != '{') {
+		goto error;
+	}
+
+	ptr = event_json_skip(ptr);
+	while (*ptr != '}') {
+		if (*ptr++ != '"' || !(ptr = event_json_string(ptr, &name))) {
+			goto error;
+		}
+
+		ptr = event_json_skip(ptr);
+		if (*ptr++ != ':') {
+			goto error;
+		}
+
+		ptr = event_json_skip(ptr);
+		if (*ptr == '"') {
+			if (!(ptr = event_json_string(ptr + 1, &value)) || event_json_field(new_event, name, value) != AGC_STATUS_SUCCESS) {
+				goto error;
+			}
+		} else if (!(ptr = event_json_skip_value(ptr))) {
+			// only string members become headers
+			goto error;
+		}
+
+		ptr = event_json_skip(ptr);
+		if (*ptr == ',') {
+			// another member has to follow
+			ptr = event_json_skip(ptr + 1);
+			if (*ptr != '"') {
+				goto error;
+			}
+		} else if (*ptr != '}') {
+			goto error;
+		}
+	}
+
+	// nothing but white space after the object
+	if (*event_json_skip(ptr + 1)) {
+		goto error;
+	}
+	
+	if (EVENT_ID_IS_INVALID(new_event->event_id)) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid event received.\n");
+		agc_event_destroy(&new_event);
+		return AGC_STATUS_FALSE;
+	}
+
+	agc_event_strip_ingress(new_event);
+	
+	*event = new_event;
+	return AGC_STATUS_SUCCESS;
+
+error:
+	agc_event_destroy(&new_event);
+	return AGC_STATUS_FALSE;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_json(agc_event_t *event, char **str)
+{
+	agc_size_t size = 0;
+	agc_size_t len;
+
+	*str = NULL;
+
+	return agc_event_serialize_json_ex(event, str, &size, &len);
+}
+
+AGC_DECLARE(agc_size_t) agc_event_serialize_binary_size(agc_event_t *event)
+{
+	event_writer_t writer = { NULL, 0, 0 };
+
+	assert(event);
+
+	event_binary_write(&writer, event);
+	return writer.len;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_binary(agc_event_t *event, char *buf, agc_size_t size, agc_size_t *len)
+{
+	event_writer_t writer;
+
+	assert(event && len);
+
+	writer.buf = buf;
+	writer.size = buf ? size + 1 : 0;
+	writer.len = 0;
+
+	event_binary_write(&writer, event);
+	*len = writer.len;
+
+	return writer.len < writer.size ? AGC_STATUS_SUCCESS : AGC_STATUS_MEMERR;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_binary_ex(agc_event_t *event, char **buf, agc_size_t *size, agc_size_t *len)
+{
+	char *data;
+
+	assert(event && buf && size && len);
+
+	if (*buf && agc_event_serialize_binary(event, *buf, *size, len) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	*len = agc_event_serialize_binary_size(event);
+	if (!(data = realloc(*buf, *len))) {
+		return AGC_STATUS_MEMERR;
+	}
+	*buf = data;
+	*size = *len;
+
+	return agc_event_serialize_binary(event, *buf, *size, len);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_create_binary(agc_event_t **event, const void *data, agc_size_t len)
+{
+	const unsigned char *ptr = data;
+	const unsigned char *end;
+	agc_event_t *new_event = NULL;
+	agc_event_header_t *header;
+	uint32_t frame_len, head_size, name_len, value_len, body_len;
+	uint64_t source_id;
+	uint16_t count, i;
+	uint8_t type, flags;
+	size_t size;
+	char *name;
+	int event_id;
+
+	if (!data || len < AGC_EVENT_BINARY_V1_HEAD_SIZE) {
+		return AGC_STATUS_FALSE;
+	}
+
+	// the same limit as json text
+	frame_len = event_get_u32(ptr);
+	head_size = ptr[4] == 1 ? AGC_EVENT_BINARY_V1_HEAD_SIZE : AGC_EVENT_BINARY_HEAD_SIZE;
+	if (frame_len < head_size || frame_len > len || frame_len > EVENT_JSON_MAX || (ptr[4] != 1 && ptr[4] != AGC_EVENT_BINARY_VERSION)) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid binary event received.\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	flags = ptr[5];
+	count = (ptr[6] << 8) | ptr[7];
+	event_id = (int) event_get_u32(ptr + 8);
+	if (event_id < 0 || EVENT_ID_IS_INVALID(event_id)) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid event id %d received.\n", event_id);
+		return AGC_STATUS_FALSE;
+	}
+
+	// every header takes 8 bytes of the frame at least, a bogus count must not size the arena
+	if (count > (frame_len - head_size) / 8) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Malformed binary event received.\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	// names and values get a terminating zero, int values room to render
+	size = EVENT_ARENA_ALIGN(sizeof(agc_event_t)) + EVENT_ARENA_ALIGN(sizeof(event_arena_t)) + frame_len;
+	size += count * (EVENT_ARENA_ALIGN(sizeof(agc_event_header_t)) + 2 * EVENT_ARENA_ALIGN(1) + EVENT_BINARY_TEXT_SIZE);
+
+	source_id = event_get_u32(ptr + 12);
+	if (head_size == AGC_EVENT_BINARY_HEAD_SIZE) {
+		source_id = (source_id << 32) | event_get_u32(ptr + 16);
+	}
+
+	if (event_create_sized(&new_event, event_id, source_id, size) != AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_FALSE;
+	}
+
+	end = ptr + frame_len;
+	ptr += head_size;
+
+	for (i = 0; i < count; i++) {
+		if (end - ptr < 8) {
+			goto error;
+		}
+
+		type = ptr[0];
+		name_len = (ptr[2] << 8) | ptr[3];
+		value_len = event_get_u32(ptr + 4);
+		ptr += 8;
+
+		if (!name_len || name_len > (uint32_t) (end - ptr) || value_len > (uint32_t) (end - ptr - name_len)) {
+			goto error;
+		}
+
+		if (!(name = event_arena_alloc(new_event, name_len + 1))) {
+			goto error;
+		}
+		memcpy(name, ptr, name_len);
+		name[name_len] = '\0';
+		ptr += name_len;
+
+		if (!(header = new_header_inplace(new_event, name))) {
+			goto error;
+		}
+
+		switch (type) {
+		case EVENT_HEADER_STRING:
+		case EVENT_HEADER_BYTES:
+			if (!(header->value = event_arena_alloc(new_event, value_len + 1))) {
+				goto error;
+			}
+			memcpy(header->value, ptr, value_len);
+			header->value[value_len] = '\0';
+			header->length = value_len;
+			header->size = value_len + 1;
+			break;
+		case EVENT_HEADER_INT32:
+		case EVENT_HEADER_UINT32:
+		case EVENT_HEADER_INT64:
+			if (value_len != (type == EVENT_HEADER_INT64 ? 8 : 4) || !(header->value = event_arena_alloc(new_event, EVENT_BINARY_TEXT_SIZE))) {
+				goto error;
+			}
+
+			// rendered to text when somebody asks for it
+			if (type == EVENT_HEADER_INT64) {
+				header->native.i64 = (int64_t) (((uint64_t) event_get_u32(ptr) << 32) | event_get_u32(ptr + 4));
+			} else {
+				header->native.u32 = event_get_u32(ptr);
+			}
+			header->size = EVENT_BINARY_TEXT_SIZE;
+			header->rendered = 0;
+			break;
+		default:
+			goto error;
+		}
+
+		header->type = type;
+		ptr += value_len;
+		event_link_header(new_event, header);
+	}
+
+	if (flags & AGC_EVENT_BINARY_BODY) {
+		if (end - ptr < 4) {
+			goto error;
+		}
+
+		body_len = event_get_u32(ptr);
+		ptr += 4;
+		if (body_len > (uint32_t) (end - ptr) || !(new_event->body = event_arena_alloc(new_event, body_len + 1))) {
+			goto error;
+		}
+		memcpy(new_event->body, ptr, body_len);
+		new_event->body[body_len] = '\0';
+		ptr += body_len;
+	}
+
+	if (ptr != end) {
+		goto error;
+	}
+
+	agc_event_strip_ingress(new_event);
+
+	*event = new_event;
+	return AGC_STATUS_SUCCESS;
+
+error:
+	agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Malformed binary event received.\n");
+	agc_event_destroy(&new_event);
+	return AGC_STATUS_FALSE;
+}
+
+AGC_DECLARE(agc_size_t) agc_event_serialize_json_size(agc_event_t *event)
+{
+	agc_event_header_t *hp;
+	agc_size_t size = sizeof("{\"_id\":\"\"}") + 12;
+
+	assert(event);
+
+	// "name":"value",
+	for (hp = event->headers; hp; hp = hp->next) {
+		size += strlen(hp->name) + strlen(event_header_text(hp)) + 6;
+	}
+
+	if (event_templates[event->event_id]) {
+		size += strlen(event_templates[event->event_id]) + sizeof(",\"_name\":\"\"");
+	}
+
+	if (event->body) {
+		size += strlen(event->body) + sizeof(",\"_length\":\"\",\"_body\":\"\"") + 12;
+	}
+
+	return size;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_json_buf(agc_event_t *event, char *buf, agc_size_t size, agc_size_t *len)
+{
+	event_writer_t writer;
+
+	assert(event && len);
+
+	writer.buf = buf;
+	writer.size = buf ? size : 0;
+	writer.len = 0;
+
+	event_json_write(&writer, event);
+	*len = writer.len;
+
+	if (writer.len >= writer.size) {
+		return AGC_STATUS_MEMERR;
+	}
+
+	buf[writer.len] = '\0';
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_serialize_json_ex(agc_event_t *event, char **buf, agc_size_t *size, agc_size_t *len)
+{
+	agc_size_t need;
+	char *data;
+
+	assert(event && buf && size && len);
+
+	// a new buffer is sized by the estimate, a reused one is tried as it is
+	if (!*buf) {
+		need = agc_event_serialize_json_size(event);
+		if (!(data = malloc(need))) {
+			return AGC_STATUS_MEMERR;
+		}
+		*buf = data;
+		*size = need;
+	}
+
+	if (agc_event_serialize_json_buf(event, *buf, *size, len) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	// the writer counted the exact length
+	need = *len + 1;
+	if (!(data = realloc(*buf, need))) {
+		return AGC_STATUS_MEMERR;
+	}
+	*buf = data;
+	*size = need;
+
+	return agc_event_serialize_json_buf(event, *buf, *size, len);
+}
+
+static inline char *event_json_skip(char *str)
+{
+	while (*str && (unsigned char) *str <= 32) {
+		str++;
+	}
+	return str;
+}
+
+static int event_json_hex4(const char *str, unsigned int *value)
+{
+	int i;
+
+	*value = 0;
+	for (i = 0; i < 4; i++) {
+		char c = str[i];
+
+		*value <<= 4;
+		if (c >= '0' && c <= '9') {
+			*value |= c - '0';
+		} else if (c >= 'a' && c <= 'f') {
+			*value |= c - 'a' + 10;
+		} else if (c >= 'A' && c <= 'F') {
+			*value |= c - 'A' + 10;
+		} else {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* 
+ * unescape the string after the opening quote in place, it never grows: 
+ * \uXXXX is at most three bytes of utf-8 and a surrogate pair four.
+ * returns the position after the closing quote.
+ */
+static char *event_json_string(char *str, char **out)
+{
+	char *wr = str;
+	unsigned int uc, lo;
+
+	*out = str;
+
+	for (;;) {
+		// copy the plain run
+		while (*str && *str != '"' && *str != '\\') {
+			*wr++ = *str++;
+		}
+
+		if (*str == '"') {
+			break;
+		}
+
+		if (!*str) {
+			return NULL;
+		}
+
+		str++;
+		switch (*str++) {
+		case 'b':	*wr++ = '\b'; break;
+		case 'f':	*wr++ = '\f'; break;
+		case 'n':	*wr++ = '\n'; break;
+		case 'r':	*wr++ = '\r'; break;
+		case 't':	*wr++ = '\t'; break;
+		case '"':	*wr++ = '"'; break;
+		case '\\':	*wr++ = '\\'; break;
+		case '/':	*wr++ = '/'; break;
+		case 'u':
+			if (!event_json_hex4(str, &uc) || (uc >= 0xDC00 && uc <= 0xDFFF) || !uc) {
+				return NULL;
+			}
+			str += 4;
+
+			if (uc >= 0xD800 && uc <= 0xDBFF) {
+				if (str[0] != '\\' || str[1] != 'u' || !event_json_hex4(str + 2, &lo) || lo < 0xDC00 || lo > 0xDFFF) {
+					return NULL;
+				}
+				str += 6;
+				uc = 0x10000 + (((uc & 0x3FF) << 10) | (lo & 0x3FF));
+			}
+
+			if (uc < 0x80) {
+				*wr++ = uc;
+			} else if (uc < 0x800) {
+				*wr++ = 0xC0 | (uc >> 6);
+				*wr++ = 0x80 | (uc & 0x3F);
+			} else if (uc < 0x10000) {
+				*wr++ = 0xE0 | (uc >> 12);
+				*wr++ = 0x80 | ((uc >> 6) & 0x3F);
+				*wr++ = 0x80 | (uc & 0x3F);
+			} else {
+				*wr++ = 0xF0 | (uc >> 18);
+				*wr++ = 0x80 | ((uc >> 12) & 0x3F);
+				*wr++ = 0x80 | ((uc >> 6) & 0x3F);
+				*wr++ = 0x80 | (uc & 0x3F);
+			}
+			break;
+		default:
+			return NULL;
+		}
+	}
+
+	*wr = '\0';
+	return str + 1;
+}
+
+/* step over a member value which is not a string, nested objects and arrays included */
+static char *event_json_skip_value(char *str)
+{
+	char *tmp;
+	char last = 0;
+	int depth = 0;
+
+	do {
+		str = event_json_skip(str);
+
+		// no empty elements, like [1,], [,1] or {"a":}
+		if ((last == ',' || last == ':') && (*str == ',' || *str == ':' || *str == '}' || *str == ']')) {
+			return NULL;
+		} else if ((last == '[' || last == '{') && (*str == ',' || *str == ':')) {
+			return NULL;
+		}
+		last = *str;
+
+		if (*str == '"') {
+			if (!(str = event_json_string(str + 1, &tmp))) {
+				return NULL;
+			}
+		} else if (*str == '{' || *str == '[') {
+			depth++;
+			str++;
+		} else if (*str == '}' || *str == ']') {
+			if (!depth--) {
+				return NULL;
+			}
+			str++;
+		} else if (*str == ',' || *str == ':') {
+			if (!depth) {
+				return NULL;
+			}
+			str++;
+		} else if (!strncmp(str, "true", 4) || !strncmp(str, "null", 4)) {
+			str += 4;
+		} else if (!strncmp(str, "false", 5)) {
+			str += 5;
+		} else if (*str == '-' || (*str >= '0' && *str <= '9')) {
+			while (*str && strchr("+-.eE0123456789", *str)) {
+				str++;
+			}
+		} else {
+			return NULL;
+		}
+	} while (depth);
+
+	return str;
+}
+
+static agc_status_t event_json_field(agc_event_t *event, char *name, char *value)
+{
+	agc_event_header_t *header;
+	char *end = NULL;
+	long event_id;
+
+	if (!strcasecmp(name, "_body")) {
+		event->body = value;
+	} else if (!strcasecmp(name, "_id")) {
+		event_id = strtol(value, &end, 10);
+		if (end == value || *end || event_id < 0 || EVENT_ID_IS_INVALID(event_id)) {
+			agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Invalid event id %s received.\n", value);
+			return AGC_STATUS_FALSE;
+		}
+		event->event_id = (int) event_id;
+	} else if ((header = agc_event_get_header_ptr(event, name))) {
+		// a repeated key keeps the last value, as agc_event_add_header_repeatcheck does
+		header->value = value;
+		header->size = 0;
+		header->length = 0;
+		header->type = EVENT_HEADER_STRING;
+		agc_store_release(&header->rendered, 2);
+	} else {
+		if (!(header = new_header_inplace(event, name))) {
+			return AGC_STATUS_MEMERR;
+		}
+		header->value = value;
+		event_link_header(event, header);
+	}
+
+	return AGC_STATUS_SUCCESS;
+}
+
+static inline void event_write(event_writer_t *writer, const char *data, agc_size_t len)
+{
+	if (writer->len + len < writer->size) {
+		memcpy(writer->buf + writer->len, data, len);
+	}
+	writer->len += len;
+}
+
+/* the same escaping as cJSON, everything below 32, the quote and the backslash */
+static void event_json_put_string(event_writer_t *writer, const char *str)
+{
+	const unsigned char *run = (const unsigned char *) str;
+	const unsigned char *ptr = run;
+	char esc[8];
+
+	event_write(writer, "\"", 1);
+
+	for (;; ptr++) {
+		if (*ptr > 31 && *ptr != '"' && *ptr != '\\') {
+			continue;
+		}
+
+		event_write(writer, (const char *) run, ptr - run);
+		run = ptr + 1;
+
+		if (!*ptr) {
+			break;
+		}
+
+		switch (*ptr) {
+		case '\\':	event_write(writer, "\\\\", 2); break;
+		case '"':	event_write(writer, "\\\"", 2); break;
+		case '\b':	event_write(writer, "\\b", 2); break;
+		case '\f':	event_write(writer, "\\f", 2); break;
+		case '\n':	event_write(writer, "\\n", 2); break;
+		case '\r':	event_write(writer, "\\r", 2); break;
+		case '\t':	event_write(writer, "\\t", 2); break;
+		default:
+			agc_snprintf(esc, sizeof(esc), "\\u%04x", *ptr);
+			event_write(writer, esc, 6);
+			break;
+		}
+	}
+
+	event_write(writer, "\"", 1);
+}
+
+static void event_json_put_field(event_writer_t *writer, const char *name, const char *value)
+{
+	if (writer->len > 1) {
+		event_write(writer, ",", 1);
+	}
+
+	event_json_put_string(writer, name);
+	event_write(writer, ":", 1);
+	event_json_put_string(writer, value);
+}
+
+/* writes what agc_event_serialize_json_obj builds, in the same order */
+static void event_json_write(event_writer_t *writer, agc_event_t *event)
+{
+	agc_event_header_t *hp;
+	char tmp[25];
+
+	event_write(writer, "{", 1);
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		event_json_put_field(writer, hp->name, event_header_text(hp));
+	}
+
+	agc_snprintf(tmp, sizeof(tmp), "%d", event->event_id);
+	event_json_put_field(writer, "_id", tmp);
+
+	if (event_templates[event->event_id]) {
+		event_json_put_field(writer, "_name", event_templates[event->event_id]);
+	}
+
+	if (event->body) {
+		agc_snprintf(tmp, sizeof(tmp), "%d", (int) strlen(event->body));
+		event_json_put_field(writer, "_length", tmp);
+		event_json_put_field(writer, "_body", event->body);
+	}
+
+	event_write(writer, "}", 1);
+}
+
+static inline uint32_t event_get_u32(const unsigned char *ptr)
+{
+	return ((uint32_t) ptr[0] << 24) | ((uint32_t) ptr[1] << 16) | ((uint32_t) ptr[2] << 8) | ptr[3];
+}
+
+static inline void event_write_u32(event_writer_t *writer, uint32_t value)
+{
+	unsigned char data[4];
+
+	data[0] = value >> 24;
+	data[1] = value >> 16;
+	data[2] = value >> 8;
+	data[3] = value;
+	event_write(writer, (const char *) data, 4);
+}
+
+static void event_binary_write(event_writer_t *writer, agc_event_t *event)
+{
+	agc_event_header_t *hp;
+	unsigned char head[8];
+	const char *value;
+	uint32_t value_len, name_len;
+	agc_size_t start = writer->len;
+	uint16_t count = 0;
+
+	// the frame length and the header count are filled in at the end
+	event_write_u32(writer, 0);
+	head[0] = AGC_EVENT_BINARY_VERSION;
+	head[1] = event->body ? AGC_EVENT_BINARY_BODY : 0;
+	head[2] = head[3] = 0;
+	event_write(writer, (const char *) head, 4);
+	event_write_u32(writer, event->event_id);
+	event_write_u32(writer, (uint32_t) (event->source_id >> 32));
+	event_write_u32(writer, (uint32_t) event->source_id);
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		if ((name_len = strlen(hp->name)) > 0xFFFF || count == 0xFFFF) {
+			continue;
+		}
+
+		switch (hp->type) {
+		case EVENT_HEADER_INT32:
+		case EVENT_HEADER_UINT32:
+			value = NULL;
+			value_len = 4;
+			break;
+		case EVENT_HEADER_INT64:
+			value = NULL;
+			value_len = 8;
+			break;
+		case EVENT_HEADER_BYTES:
+			value = hp->value;
+			value_len = hp->length;
+			break;
+		default:
+			value = hp->value;
+			value_len = strlen(value);
+			break;
+		}
+
+		head[0] = hp->type;
+		head[1] = 0;
+		head[2] = name_len >> 8;
+		head[3] = name_len;
+		event_write(writer, (const char *) head, 4);
+		event_write_u32(writer, value_len);
+		event_write(writer, hp->name, name_len);
+
+		if (value) {
+			event_write(writer, value, value_len);
+		} else if (hp->type == EVENT_HEADER_INT64) {
+			event_write_u32(writer, (uint32_t) ((uint64_t) hp->native.i64 >> 32));
+			event_write_u32(writer, (uint32_t) hp->native.i64);
+		} else {
+			event_write_u32(writer, hp->native.u32);
+		}
+
+		count++;
+	}
+
+	if (event->body) {
+		value_len = strlen(event->body);
+		event_write_u32(writer, value_len);
+		event_write(writer, event->body, value_len);
+	}
+
+	if (writer->len < writer->size) {
+		head[0] = (writer->len - start) >> 24;
+		head[1] = (writer->len - start) >> 16;
+		head[2] = (writer->len - start) >> 8;
+		head[3] = (writer->len - start);
+		memcpy(writer->buf + start, head, 4);
+		writer->buf[start + 6] = count >> 8;
+		writer->buf[start + 7] = count;
+	}
+}
+
+static void agc_event_dispatcher_setup(event_dispatcher_t *dispatcher, int index)
+{
+	int i;
+
+	dispatcher->index = index;
+	dispatcher->spin = DISPATCH_SPIN_MAX;
+	agc_queue_create_ex(&dispatcher->queue, DISPATCH_QUEUE_LIMIT, DISPATCH_QUEUE_TYPE, RUNTIME_POOL);
+	agc_queue_create_ex(&dispatcher->unordered, DISPATCH_QUEUE_LIMIT, DISPATCH_QUEUE_TYPE, RUNTIME_POOL);
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		if (i != EVENT_PRIORITY_NORMAL) {
+			agc_queue_create_ex(&dispatcher->classes[i].queue, DISPATCH_QUEUE_LIMIT, DISPATCH_QUEUE_TYPE, RUNTIME_POOL);
+		}
+		dispatcher->spills[i].queue = i == EVENT_PRIORITY_NORMAL ? dispatcher->queue : dispatcher->classes[i].queue;
+	}
+	dispatcher->spills[EVENT_SPILL_UNORDERED].queue = dispatcher->unordered;
+	dispatcher->boost = -1;
+	agc_mutex_init(&dispatcher->mutex, AGC_MUTEX_DEFAULT, RUNTIME_POOL);
+	agc_thread_cond_create(&dispatcher->cond, RUNTIME_POOL);
+	agc_mutex_init(&dispatcher->spill_mutex, AGC_MUTEX_DEFAULT, RUNTIME_POOL);
+
+	agc_store_release(&DISPATCH_SLOTS, index + 1);
+}
+
+static void agc_event_launch_dispatch_thread(event_dispatcher_t *dispatcher)
+{
+	agc_threadattr_t *thd_attr;
+	uint32_t wait_times = 200;
+
+	agc_threadattr_create(&thd_attr, RUNTIME_POOL);
+	agc_threadattr_stacksize_set(thd_attr, AGC_THREAD_STACKSIZE);
+	agc_threadattr_priority_set(thd_attr, AGC_PRI_REALTIME);
+	agc_thread_create(&dispatcher->thread, thd_attr, agc_event_dispatch_thread, dispatcher, RUNTIME_POOL);
+    
+	while(--wait_times && !dispatcher->running) {
+		agc_yield(10000);
+	}
+    
+	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Create event dispatch thread %d.\n", dispatcher->index);
+}
+
+static void *agc_event_dispatch_thread(agc_thread_t *thread, void *obj)
+{
+	event_dispatcher_t *dispatcher = (event_dispatcher_t *) obj;
+	int my_id = dispatcher->index;
+
+	dispatcher->tid = agc_thread_self();
+	agc_core_thread_place(AGC_THREAD_DISPATCHER, my_id);
+
+	// touched first here, so it is on the node of the placed thread, kept when it retires
+	if (!dispatcher->batch) {
+		dispatcher->batch = (void **) calloc(DISPATCH_BATCH_SIZE, sizeof(void *));
+		assert(dispatcher->batch);
+	}
+
+	agc_event_rcu_online(dispatcher);
+
+	agc_mutex_lock(EVENTSTATE_MUTEX);
+	dispatcher->running = 1;
 	DISPATCH_THREAD_COUNT++;
 	agc_mutex_unlock(EVENTSTATE_MUTEX);
 
-	for (;;) {
-		void *pop = NULL;
-		agc_event_t *event = NULL;
-		agc_time_t time_start;
-		int debug_id = 0;
-		
+	for (;;) {
+		void *pop = NULL;
+		unsigned int count = 1;
+
+		if (!SYSTEM_RUNNING) {
+			break;
+		}
+
+		if (agc_load_acquire(&dispatcher->retiring) && agc_event_dispatch_idle(dispatcher)) {
+			agc_bool_t retired = AGC_FALSE;
+
+			// decided under the lock, a resize may take the dispatcher back meanwhile
+			agc_event_rcu_offline(dispatcher);
+			agc_mutex_lock(EVENTSTATE_MUTEX);
+			if (dispatcher->retiring) {
+				dispatcher->running = 0;
+				DISPATCH_THREAD_COUNT--;
+				retired = AGC_TRUE;
+			}
+			agc_mutex_unlock(EVENTSTATE_MUTEX);
+
+			if (retired) {
+				agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Dispatch thread %d retired.\n", my_id);
+				return NULL;
+			}
+
+			agc_event_rcu_online(dispatcher);
+		}
+
+		if (agc_event_dispatch_wait(dispatcher, &pop) != AGC_STATUS_SUCCESS) {
+			continue;
+		}
+
+		if (!pop) {
+			break;
+		}
+
+		dispatcher->batch[0] = pop;
+		count = agc_event_dispatch_fill(dispatcher, count);
+
+		agc_event_dispatch_batch(dispatcher, count);
+
+		// the batch made room for spilled events
+		agc_event_unspill(dispatcher);
+
+		// quiescent state, no snapshot is referenced between two batches
+		agc_event_rcu_online(dispatcher);
+		agc_event_reclaim(AGC_FALSE);
+	}
+
+	agc_event_rcu_offline(dispatcher);
+
+	agc_mutex_lock(EVENTSTATE_MUTEX);
+	dispatcher->running = 0;
+	DISPATCH_THREAD_COUNT--;
+	agc_mutex_unlock(EVENTSTATE_MUTEX);
+
+	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Dispatch thread %d ended.\n", my_id);
+	return NULL;
+}
+
+/*
+ * Get the next event of the dispatcher.
+ * poll mode: try once and sleep 10ms when the queue is empty.
+ * block mode: spin for a while (the budget adapts to the traffic), then park on cond 
+ * until agc_event_fire wakes us up.
+ * Before sleeping or spinning, unordered events are stolen from the busiest peer.
+ */
+static agc_status_t agc_event_dispatch_wait(event_dispatcher_t *dispatcher, void **pop)
+{
+	int spins = 0;
+
+	// spilled after the last batch made room, the queue may be empty meanwhile
+	agc_event_unspill(dispatcher);
+
+	if (agc_event_dispatch_pop(dispatcher, pop) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (agc_event_steal(dispatcher, pop) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (DISPATCH_WAIT_MODE == EVENT_WAIT_POLL) {
+		agc_event_rcu_offline(dispatcher);
+		agc_yield(10000);
+		agc_event_rcu_online(dispatcher);
+		return AGC_STATUS_FALSE;
+	}
+
+	for (spins = 0; spins < dispatcher->spin; spins++) {
+		agc_cpu_relax();
+		if (agc_event_dispatch_pop(dispatcher, pop) == AGC_STATUS_SUCCESS) {
+			// an event arrived while spinning, spin longer next time
+			dispatcher->spin = dispatcher->spin * 2 > DISPATCH_SPIN_MAX ? DISPATCH_SPIN_MAX : dispatcher->spin * 2;
+			return AGC_STATUS_SUCCESS;
+		}
+	}
+
+	// spinning was wasted, spin less next time
+	dispatcher->spin = dispatcher->spin / 2;
+	if (dispatcher->spin < 1 && DISPATCH_SPIN_MAX > 0) {
+		dispatcher->spin = 1;
+	}
+
+	agc_mutex_lock(dispatcher->mutex);
+	dispatcher->sleeping = 1;
+	agc_fetch_add(&DISPATCH_SLEEPERS, 1);
+	agc_memory_barrier();
+
+	if (agc_event_dispatch_pop(dispatcher, pop) == AGC_STATUS_SUCCESS ||
+		agc_event_steal(dispatcher, pop) == AGC_STATUS_SUCCESS) {
+		dispatcher->sleeping = 0;
+		agc_fetch_add(&DISPATCH_SLEEPERS, -1);
+		agc_mutex_unlock(dispatcher->mutex);
+		return AGC_STATUS_SUCCESS;
+	}
+
+	// a spilling producer wakes us after its push, it may have found us awake
+	if (SYSTEM_RUNNING && !dispatcher->retiring && !agc_load_acquire(&dispatcher->spill_count)) {
+		agc_event_rcu_offline(dispatcher);
+		agc_thread_cond_wait(dispatcher->cond, dispatcher->mutex);
+		agc_event_rcu_online(dispatcher);
+	}
+
+	dispatcher->sleeping = 0;
+	agc_fetch_add(&DISPATCH_SLEEPERS, -1);
+	agc_mutex_unlock(dispatcher->mutex);
+
+	if (agc_event_dispatch_pop(dispatcher, pop) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_SUCCESS;
+	}
+
+	return agc_event_steal(dispatcher, pop);
+}
+
+/* the own queues by class, a starved class first */
+static inline agc_status_t agc_event_dispatch_pop(event_dispatcher_t *dispatcher, void **pop)
+{
+	int i;
+
+	if ((i = dispatcher->boost) >= 0) {
+		dispatcher->boost = -1;
+		if (agc_event_class_pop_bulk(dispatcher, i, pop, 1)) {
+			return AGC_STATUS_SUCCESS;
+		}
+	}
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		if (agc_event_class_pop_bulk(dispatcher, i, pop, 1)) {
+			return AGC_STATUS_SUCCESS;
+		}
+	}
+
+	return AGC_STATUS_FALSE;
+}
+
+/*
+ * Fill the batch behind the first count events. The classes with events share the room
+ * by weight, one slot at least, and the room a class leaves goes to the others.
+ * A class which had events and got none for DISPATCH_STARVE_ROUNDS batches is taken first
+ * by the next pop, which matters for batches too small to give every class a slot.
+ */
+static unsigned int agc_event_dispatch_fill(event_dispatcher_t *dispatcher, unsigned int count)
+{
+	unsigned int size = DISPATCH_BATCH_SIZE, room, weights, share, got, depth;
+	unsigned int taken[EVENT_PRIORITY_CLASSES] = { 0 };
+	agc_bool_t hungry[EVENT_PRIORITY_CLASSES];
+	int i;
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		hungry[i] = AGC_TRUE;
+	}
+
+	taken[((agc_event_t *) dispatcher->batch[0])->priority] = count;
+
+	while (count < size) {
+		room = size - count;
+		weights = 0;
+		for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+			if (hungry[i]) {
+				weights += DISPATCH_WEIGHTS[i];
+			}
+		}
+
+		if (!weights) {
+			break;
+		}
+
+		for (i = 0; i < EVENT_PRIORITY_CLASSES && count < size; i++) {
+			if (!hungry[i]) {
+				continue;
+			}
+
+			share = room * DISPATCH_WEIGHTS[i] / weights;
+			if (!share) {
+				share = 1;
+			}
+
+			if (share > size - count) {
+				share = size - count;
+			}
+
+			got = agc_event_class_pop_bulk(dispatcher, i, &dispatcher->batch[count], share);
+			if (got < share) {
+				// drained or held, the others take its room
+				hungry[i] = AGC_FALSE;
+			}
+
+			taken[i] += got;
+			count += got;
+		}
+	}
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		event_priority_class_t *pclass = &dispatcher->classes[i];
+
+		depth = taken[i] + agc_event_class_depth(dispatcher, i);
+		if (depth > pclass->high_water) {
+			pclass->high_water = depth;
+		}
+
+		if (taken[i] || !depth) {
+			pclass->waiting = 0;
+		} else if (++pclass->waiting >= DISPATCH_STARVE_ROUNDS) {
+			pclass->waiting = 0;
+			pclass->starved++;
+			dispatcher->boost = i;
+		}
+	}
+
+	return count;
+}
+
+/* a source which maps to another dispatcher after the running resize */
+static inline agc_bool_t agc_event_source_moving(uint64_t source_id)
+{
+	return source_id != EVENT_NULL_SOURCEID &&
+		agc_event_dispatch_index(source_id, DISPATCH_RESIZE_FROM) != agc_event_dispatch_index(source_id, DISPATCH_RESIZE_TO);
+}
+
+/* pop from a queue with sources, during a resize the events of the moving ones are put aside */
+static unsigned int agc_event_class_pop_sourced(event_dispatcher_t *dispatcher, event_priority_class_t *pclass,
+												agc_queue_t *queue, void **events, unsigned int max)
+{
+	unsigned int count, base, got, i;
+	agc_bool_t held = agc_load_acquire(&dispatcher->hold) ? AGC_TRUE : AGC_FALSE;
+
+	// put aside events go first, in the order they came
+	for (count = 0; !held && pclass->held_head && count < max; count++) {
+		agc_event_t *event = pclass->held_head;
+
+		if (!(pclass->held_head = event->next)) {
+			pclass->held_tail = NULL;
+		}
+		event->next = NULL;
+		pclass->held_count--;
+		events[count] = event;
+	}
+
+	if (count == max || (!held && pclass->held_head)) {
+		return count;
+	}
+
+	got = agc_queue_trypop_bulk(queue, events + count, max - count);
+	if (!held) {
+		return count + got;
+	}
+
+	for (base = count, i = 0; i < got; i++) {
+		agc_event_t *event = (agc_event_t *) events[base + i];
+
+		// the NULL stopping the dispatcher goes through as well
+		if (!event || !agc_event_source_moving(event->source_id)) {
+			events[count++] = event;
+			continue;
+		}
+
+		event->next = NULL;
+		if (pclass->held_tail) {
+			pclass->held_tail->next = event;
+		} else {
+			pclass->held_head = event;
+		}
+		pclass->held_tail = event;
+		pclass->held_count++;
+	}
+
+	return count;
+}
+
+/* up to max events of a class, the normal class takes the ordered queue first */
+static unsigned int agc_event_class_pop_bulk(event_dispatcher_t *dispatcher, int priority, void **events, unsigned int max)
+{
+	event_priority_class_t *pclass = &dispatcher->classes[priority];
+	unsigned int count = 0;
+
+	if (priority != EVENT_PRIORITY_NORMAL) {
+		// the events with and without a source share the queue
+		return agc_event_class_pop_sourced(dispatcher, pclass, pclass->queue, events, max);
+	}
+
+	count = agc_event_class_pop_sourced(dispatcher, pclass, dispatcher->queue, events, max);
+
+	if (count < max) {
+		count += agc_queue_trypop_bulk(dispatcher->unordered, events + count, max - count);
+	}
+
+	return count;
+}
+
+static unsigned int agc_event_class_depth(event_dispatcher_t *dispatcher, int priority)
+{
+	event_priority_class_t *pclass = &dispatcher->classes[priority];
+
+	if (priority != EVENT_PRIORITY_NORMAL) {
+		return agc_queue_size(pclass->queue) + agc_load_acquire(&dispatcher->spills[priority].count) + pclass->held_count;
+	}
+
+	return agc_queue_size(dispatcher->queue) + agc_queue_size(dispatcher->unordered) + pclass->held_count +
+		agc_load_acquire(&dispatcher->spills[priority].count) + agc_load_acquire(&dispatcher->spills[EVENT_SPILL_UNORDERED].count);
+}
+
+static inline agc_bool_t agc_event_dispatch_idle(event_dispatcher_t *dispatcher)
+{
+	int i;
+
+	for (i = 0; i < EVENT_PRIORITY_CLASSES; i++) {
+		if (agc_event_class_depth(dispatcher, i)) {
+			return AGC_FALSE;
+		}
+	}
+
+	return AGC_TRUE;
+}
+
+/*
+ * Take half of the unordered events of the busiest peer, up to a batch.
+ * The first one is returned, the others go to our own unordered queue.
+ */
+static agc_status_t agc_event_steal(event_dispatcher_t *dispatcher, void **pop)
+{
+	event_dispatcher_t *victim = NULL;
+	unsigned int i, size, most = 0, count, slots = agc_load_acquire(&DISPATCH_SLOTS);
+
+	// a retiring dispatcher only drains, the others help it
+	if (dispatcher->retiring) {
+		return AGC_STATUS_FALSE;
+	}
+
+	for (i = 1; i < slots; i++) {
+		event_dispatcher_t *peer = &EVENT_DISPATCHERS[(dispatcher->index + i) % slots];
+
+		if (peer->running && (size = agc_queue_size(peer->unordered)) > most) {
+			most = size;
+			victim = peer;
+		}
+	}
+
+	if (!victim) {
+		return AGC_STATUS_FALSE;
+	}
+
+	count = (most + 1) / 2;
+	if (count > (unsigned int) DISPATCH_BATCH_SIZE) {
+		count = DISPATCH_BATCH_SIZE;
+	}
+
+	// the batch is unused while waiting
+	if (!(count = agc_queue_trypop_bulk(victim->unordered, dispatcher->batch, count))) {
+		return AGC_STATUS_FALSE;
+	}
+
+	*pop = dispatcher->batch[0];
+	for (i = 1; i < count; i++) {
+		// producers filled our queue meanwhile, keep the rest aside instead of waiting for room
+		if (agc_queue_trypush(dispatcher->unordered, dispatcher->batch[i]) != AGC_STATUS_SUCCESS) {
+			agc_mutex_lock(dispatcher->spill_mutex);
+			for (; i < count; i++) {
+				agc_event_spill_append(dispatcher, &dispatcher->spills[EVENT_SPILL_UNORDERED], (agc_event_t *) dispatcher->batch[i]);
+				dispatcher->batch[i] = NULL;
+			}
+			agc_mutex_unlock(dispatcher->spill_mutex);
+			break;
+		}
+		dispatcher->batch[i] = NULL;
+	}
+
+	dispatcher->stats.stolen += count;
+	return AGC_STATUS_SUCCESS;
+}
+
+/* unordered events were queued on a busy dispatcher, let a parked one steal them */
+static void agc_event_wakeup_idle(void)
+{
+	unsigned int i, start, count;
+
+	if (DISPATCH_WAIT_MODE != EVENT_WAIT_BLOCK || !agc_load_acquire(&DISPATCH_SLEEPERS)) {
+		return;
+	}
+
+	count = agc_load_acquire(&MAX_DISPATCHER);
+	start = agc_random(count);
+	for (i = 0; i < count; i++) {
+		event_dispatcher_t *peer = &EVENT_DISPATCHERS[(start + i) % count];
+
+		if (peer->sleeping) {
+			agc_event_dispatch_wakeup(peer);
+			return;
+		}
+	}
+}
+
+static inline void agc_event_dispatch_wakeup(event_dispatcher_t *dispatcher)
+{
+	if (DISPATCH_WAIT_MODE != EVENT_WAIT_BLOCK) {
+		return;
+	}
+
+	agc_memory_barrier();
+
+	if (dispatcher->sleeping) {
+		agc_mutex_lock(dispatcher->mutex);
+		agc_thread_cond_signal(dispatcher->cond);
+		agc_mutex_unlock(dispatcher->mutex);
+	}
+}
+
+/*
+ * Deliver the drained events back to back.
+ */
+static void agc_event_dispatch_batch(event_dispatcher_t *dispatcher, unsigned int count)
+{
+	agc_event_dispatch_stats_t *stats = &dispatcher->stats;
+	unsigned int i;
+	uint32_t depth;
+	int bucket = 0;
+
+	for (i = 0; i < count; i++) {
+		agc_event_t *event = (agc_event_t *) dispatcher->batch[i];
+		agc_time_t time_start;
+		int debug_id = 0;
+
+		dispatcher->batch[i] = NULL;
+		if (!event) {
+			continue;
+		}
+
+		if (event->call_back == agc_event_fence_pass) {
+			agc_event_fence_pass(NULL);
+			agc_event_destroy(&event);
+			continue;
+		}
+
+		// room made for a newer event of the source and id
+		if (agc_event_evicted(dispatcher, event)) {
+			agc_fetch_add(&dispatcher->dropped, 1);
+			agc_event_destroy(&event);
+			continue;
+		}
+
+		if ((debug_id = event->debug_id)) {
+			agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d handle by event_thread %d .\n", debug_id, dispatcher->index);
+			time_start = agc_time_now();
+		}
+		agc_event_deliver(dispatcher, &event);
+		if (debug_id) {
+			int time_used = 0;
+			time_used = (int)((agc_time_now() - time_start)/1000);
+			agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d handle by event_thread %d finished %d milliseconds used .\n", debug_id, dispatcher->index, time_used);
+		}
+	}
+
+	while (bucket < EVENT_BATCH_BUCKETS - 1 && (count >> (bucket + 1))) {
+		bucket++;
+	}
+
+	// what was waiting at this wakeup
+	depth = count + agc_queue_size(dispatcher->queue) + agc_queue_size(dispatcher->unordered);
+	if (depth > stats->queue_high_water) {
+		stats->queue_high_water = depth;
+	}
+
+	stats->batches++;
+	stats->events += count;
+	stats->batch_sizes[bucket]++;
+	if (count > stats->max_batch) {
+		stats->max_batch = count;
+	}
+}
+
+static void agc_event_deliver(event_dispatcher_t *dispatcher, agc_event_t **event)
+{
+	event_subscribers_t *subs, *all;
+	event_latency_stats_t *stats;
+	agc_event_t *pevent = *event;
+	agc_time_t start, now;
+    
+	assert(pevent);
+
+	if (!(stats = dispatcher->latency[pevent->event_id])) {
+		stats = (event_latency_stats_t *) calloc(1, sizeof(event_latency_stats_t));
+		assert(stats);
+		agc_store_release(&dispatcher->latency[pevent->event_id], stats);
+	}
+
+	start = now = agc_time_now();
+
+	// too late to be of use, its delivery time goes to the events still valid
+	if (pevent->deadline && pevent->deadline <= start) {
+		agc_event_callback_func expiry = agc_load_acquire(&EVENT_EXPIRY_CALLBACK[pevent->event_id]);
+
+		stats->expired++;
+		if (expiry && SYSTEM_RUNNING) {
+			expiry(pevent);
+		}
+
+		if (pevent->fast) {
+			agc_event_fast_release(event);
+		} else {
+			agc_event_destroy(event);
+		}
+		return;
+	}
+
+	event_latency_add(&stats->queue_delay, start - pevent->fired);
+	event_latency_add(&dispatcher->classes[pevent->priority].delay, start - pevent->fired);
+    
+	if (SYSTEM_RUNNING) {
+		if (pevent->call_back) {
+			//agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "Dispatch callback.\n");
+			if (pevent->debug_id) {
+				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d callback trigger.\n", pevent->debug_id);
+			}
+			
+			pevent->call_back(pevent->context);
+			now = agc_time_now();
+		} else if (agc_load_acquire(&EVENT_REQUESTS_PENDING) && agc_event_request_reply(event)) {
+			// a reply is taken by its request, the subscribers do not see it
+			now = agc_time_now();
+			if (!*event) {
+				// it went on to the requester's dispatcher
+				event_latency_add(&stats->handle, now - start);
+				return;
+			}
+		} else {
+			if (pevent->debug_id) {
+				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d subs trigger.\n", pevent->debug_id);
+			}
+
+			if ((subs = agc_load_acquire(&EVENT_SUBSCRIBERS[pevent->event_id]))) {
+				agc_event_deliver_subscribers(dispatcher, subs, pevent, &now, AGC_FALSE);
+			}
+            
+			if ((all = agc_load_acquire(&EVENT_SUBSCRIBERS[EVENT_ID_ALL]))) {
+				agc_event_deliver_subscribers(dispatcher, all, pevent, &now, AGC_FALSE);
+			}
+
+			// once a lane holds the event it is read only, the others have seen it by then
+			if (subs && subs->lanes) {
+				agc_event_deliver_subscribers(dispatcher, subs, pevent, &now, AGC_TRUE);
+			}
+
+			if (all && all->lanes) {
+				agc_event_deliver_subscribers(dispatcher, all, pevent, &now, AGC_TRUE);
+			}
+		}
+	}
+
+	event_latency_add(&stats->handle, now - start);
+
+	if (pevent->fast) {
+		agc_event_fast_release(event);
+	} else {
+		agc_event_destroy(event);
+	}
+}
+
+/*
+ * Call the subscribers of a snapshot matching the event, each callback ends where the next one starts,
+ * one clock read per subscriber. Indexed subscribers are looked up by the event's value of each key header.
+ * lanes selects the async subscribers, they are queued to instead.
+ */
+static void agc_event_deliver_subscribers(event_dispatcher_t *dispatcher, event_subscribers_t *subs, agc_event_t *event, agc_time_t *now, agc_bool_t lanes)
+{
+	agc_event_node_t *node;
+	const char *value;
+	uint32_t hash;
+	int i, a, low, high, mid;
+
+	for (i = 0; i < subs->count; i++) {
+		agc_time_t begin = *now;
+
+		node = subs->nodes[i];
+		if (!node->lane != !lanes || (node->filter && !agc_event_filter_match(node->filter, event))) {
+			continue;
+		}
+
+		if (node->lane) {
+			agc_event_lane_push(node->lane, event);
+			continue;
+		}
+
+		node->callback(event);
+		*now = agc_time_now();
+		event_latency_add(&node->latency[dispatcher->index], *now - begin);
+	}
+
+	for (a = 0; a < subs->atom_count; a++) {
+		if (!(value = agc_event_get_header_atom(event, subs->atoms[a]))) {
+			continue;
+		}
+
+		// first entry of (atom, hash)
+		hash = event_filter_hash(value);
+		low = 0;
+		high = subs->entry_count;
+		while (low < high) {
+			event_filter_entry_t *entry;
+
+			mid = (low + high) / 2;
+			entry = &subs->entries[mid];
+			if (entry->atom < subs->atoms[a] || (entry->atom == subs->atoms[a] && entry->hash < hash)) {
+				low = mid + 1;
+			} else {
+				high = mid;
+			}
+		}
+
+		for (i = low; i < subs->entry_count && subs->entries[i].atom == subs->atoms[a] && subs->entries[i].hash == hash; i++) {
+			agc_time_t begin = *now;
+
+			node = subs->entries[i].node;
+			if (!node->lane != !lanes || strcmp(value, subs->entries[i].value) || !agc_event_filter_match(node->filter, event)) {
+				continue;
+			}
+
+			if (node->lane) {
+				agc_event_lane_push(node->lane, event);
+				continue;
+			}
+
+			node->callback(event);
+			*now = agc_time_now();
+			event_latency_add(&node->latency[dispatcher->index], *now - begin);
+		}
+	}
+}
+
+static event_lane_t *agc_event_lane_create(agc_event_node_t *node, const agc_event_lane_options_t *options)
+{
+	event_lane_t *lane;
+	agc_memory_pool_t *pool = NULL;
+	agc_threadattr_t *thd_attr;
+	int i;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		return NULL;
+	}
+
+	lane = agc_memory_alloc(pool, sizeof(event_lane_t));
+	memset(lane, 0, sizeof(event_lane_t));
+	lane->pool = pool;
+	lane->node = node;
+	lane->overflow = options->overflow;
+	lane->workers = options->workers ? options->workers : 1;
+
+	if (agc_queue_create_ex(&lane->queue, options->queue_size ? options->queue_size : EVENT_LANE_QUEUE_DEFAULT, 
+							DISPATCH_QUEUE_TYPE, pool) != AGC_STATUS_SUCCESS) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Create lane of %s failed.\n", node->id);
+		agc_memory_destroy_pool(&pool);
+		return NULL;
+	}
 
-		if (!SYSTEM_RUNNING) {
+	lane->delay = agc_memory_alloc(pool, lane->workers * sizeof(agc_event_latency_t));
+	lane->latency = agc_memory_alloc(pool, lane->workers * sizeof(agc_event_latency_t));
+	memset(lane->delay, 0, lane->workers * sizeof(agc_event_latency_t));
+	memset(lane->latency, 0, lane->workers * sizeof(agc_event_latency_t));
+
+	agc_threadattr_create(&thd_attr, pool);
+	agc_threadattr_stacksize_set(thd_attr, AGC_THREAD_STACKSIZE);
+	for (i = 0; i < lane->workers; i++) {
+		agc_thread_create(&lane->threads[i], thd_attr, agc_event_lane_thread, lane, pool);
+	}
+
+	return lane;
+}
+
+/* queue an event to an async subscriber, apply the lane's overflow policy when it is full */
+static void agc_event_lane_push(event_lane_t *lane, agc_event_t *event)
+{
+	agc_event_t *eventp;
+	agc_time_t start;
+	void *pop = NULL;
+	uint32_t depth;
+
+	if (agc_load_acquire(&lane->stopping)) {
+		agc_fetch_add(&lane->dropped, 1);
+		return;
+	}
+
+	eventp = agc_event_retain(event);
+
+	if (agc_queue_trypush(lane->queue, eventp) != AGC_STATUS_SUCCESS) {
+		switch (lane->overflow) {
+		case EVENT_OVERFLOW_DROP_OLDEST:
+			if (agc_queue_trypop(lane->queue, &pop) == AGC_STATUS_SUCCESS) {
+				agc_event_t *oldest = (agc_event_t *) pop;
+
+				if (!oldest) {
+					// a stop raced in, its worker still needs the NULL, the workers free the room
+					agc_queue_push(lane->queue, NULL);
+					agc_event_release(&eventp);
+					agc_fetch_add(&lane->dropped, 1);
+					return;
+				}
+
+				agc_event_release(&oldest);
+				agc_fetch_add(&lane->dropped, 1);
+			}
+
+			if (agc_queue_trypush(lane->queue, eventp) == AGC_STATUS_SUCCESS) {
+				break;
+			}
+			// others keep filling it, drop this one instead
+			agc_event_release(&eventp);
+			agc_fetch_add(&lane->dropped, 1);
+			return;
+		case EVENT_OVERFLOW_DROP_NEWEST:
+			agc_event_release(&eventp);
+			agc_fetch_add(&lane->dropped, 1);
+			return;
+		default:
+			// the workers are joined on unbind, do not wait for them then, the stop wakes us up
+			start = agc_time_now();
+			while (agc_queue_push_timeout(lane->queue, eventp, EVENT_LANE_BLOCK_WAIT) != AGC_STATUS_SUCCESS) {
+				if (agc_load_acquire(&lane->stopping)) {
+					agc_event_release(&eventp);
+					agc_fetch_add(&lane->dropped, 1);
+					return;
+				}
+			}
+			agc_fetch_add(&lane->blocked, 1);
+			agc_fetch_add(&lane->blocked_us, agc_time_now() - start);
 			break;
 		}
+	}
+
+	agc_fetch_add(&lane->queued, 1);
+	if ((depth = agc_queue_size(lane->queue)) > lane->high_water) {
+		lane->high_water = depth;
+	}
+}
 
-		if (agc_queue_trypop(queue, &pop) != AGC_STATUS_SUCCESS) {
-			agc_yield(10000);
+static void *agc_event_lane_thread(agc_thread_t *thread, void *obj)
+{
+	event_lane_t *lane = (event_lane_t *) obj;
+	int index = agc_fetch_add(&lane->started, 1);
+	agc_event_t *event;
+	agc_time_t start, now;
+
+	EVENT_LANE_SELF = lane;
+
+	for (;;) {
+		void *pop = NULL;
+
+		if (agc_queue_pop(lane->queue, &pop) != AGC_STATUS_SUCCESS) {
 			continue;
 		}
 
-		if (!pop) {
+		// one NULL per worker stops the lane
+		if (!(event = (agc_event_t *) pop)) {
 			break;
 		}
 
-		event = (agc_event_t *) pop;
-		if ((debug_id = event->debug_id)) {
-			agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d handle by event_thread %d .\n", debug_id, my_id);
-			time_start = agc_time_now();
-		}
-		agc_event_deliver(&event);
-		if (debug_id) {
-			int time_used = 0;
-			time_used = (int)((agc_time_now() - time_start)/1000);
-			agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d handle by event_thread %d finished %d milliseconds used .\n", debug_id, my_id, time_used);
+		start = agc_time_now();
+		event_latency_add(&lane->delay[index], start - event->fired);
+
+		if (SYSTEM_RUNNING) {
+			lane->node->callback(event);
+			now = agc_time_now();
+			event_latency_add(&lane->latency[index], now - start);
 		}
+
+		agc_event_release(&event);
 	}
 
-	agc_mutex_lock(EVENTSTATE_MUTEX);
-	EVENT_DISPATCH_QUEUE_RUNNING[my_id] = 0;
-	DISPATCH_THREAD_COUNT--;
-	agc_mutex_unlock(EVENTSTATE_MUTEX);
+	EVENT_LANE_SELF = NULL;
+	return NULL;
+}
 
-	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Dispatch thread %d ended.\n", my_id);
+/* the events already queued are still delivered */
+static void agc_event_lane_stop(event_lane_t *lane)
+{
+	agc_status_t retval;
+	int i;
+
+	if (agc_load_acquire(&lane->stopped)) {
+		return;
+	}
+
+	agc_store_release(&lane->stopping, 1);
+	// the dispatchers waiting for room give up
+	agc_queue_interrupt_all(lane->queue);
+
+	for (i = 0; i < lane->workers; i++) {
+		agc_queue_push(lane->queue, NULL);
+	}
+
+	for (i = 0; i < lane->workers; i++) {
+		agc_thread_join(&retval, lane->threads[i]);
+	}
+
+	agc_event_lane_drain(lane);
+	agc_store_release(&lane->stopped, 1);
 }
 
-static void agc_event_deliver(agc_event_t **event)
+/* release what was queued behind the stop */
+static void agc_event_lane_drain(event_lane_t *lane)
 {
-	int event_id = 0;
-	agc_event_node_t *node;
-	agc_event_t *pevent = *event;
-    
-	assert(pevent);
-    
-	if (SYSTEM_RUNNING) {
-		if (pevent->call_back) {
-			//agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "Dispatch callback.\n");
-			if (pevent->debug_id) {
-				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d callback trigger.\n", pevent->debug_id);
-			}
-			
-			pevent->call_back(pevent->context);
-		} else {
-			agc_thread_rwlock_rdlock(EVENT_NODES_RWLOCK);
-			if (pevent->debug_id) {
-				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "event: %d subs trigger.\n", pevent->debug_id);
-			}
-			
-			event_id = pevent->event_id;
-			for (node = EVENT_NODES[event_id]; node; node = node->next) {
-				node->callback(pevent);
-			}
-            
-			for (node = EVENT_NODES[EVENT_ID_ALL]; node; node = node->next) {
-				node->callback(pevent);
-			}
-        
-			agc_thread_rwlock_unlock(EVENT_NODES_RWLOCK);
+	void *pop = NULL;
+
+	while (agc_queue_trypop(lane->queue, &pop) == AGC_STATUS_SUCCESS) {
+		agc_event_t *event = (agc_event_t *) pop;
+
+		if (event) {
+			agc_event_release(&event);
 		}
 	}
+}
 
-	if (pevent->fast) {
-		agc_event_fast_release(event);
-	} else {
-		agc_event_destroy(event);
+/* once the dispatchers let go of the node */
+static void agc_event_lane_destroy(event_lane_t *lane)
+{
+	agc_memory_pool_t *pool = lane->pool;
+
+	agc_event_lane_drain(lane);
+	agc_memory_destroy_pool(&pool);
+}
+
+static inline uint32_t event_filter_hash(const char *value)
+{
+	const unsigned char *p = (const unsigned char *) value;
+	uint32_t hash = 2166136261u;
+
+	for (; *p; p++) {
+		hash ^= *p;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static int event_filter_entry_cmp(const void *a, const void *b)
+{
+	const event_filter_entry_t *ea = (const event_filter_entry_t *) a;
+	const event_filter_entry_t *eb = (const event_filter_entry_t *) b;
+
+	if (ea->atom != eb->atom) {
+		return ea->atom < eb->atom ? -1 : 1;
+	}
+
+	if (ea->hash != eb->hash) {
+		return ea->hash < eb->hash ? -1 : 1;
 	}
+
+	return 0;
 }
 
 static agc_status_t agc_event_base_add_header(agc_event_t *event, const char *header_name, char *data)
@@ -802,24 +4643,31 @@ static agc_status_t agc_event_base_add_header(agc_event_t *event, const char *he
     
 	header = agc_event_get_header_ptr(event, header_name);
     
-	if (!header) {
-		header = new_header(header_name);
-	} else {
-		agc_safe_free(header->value);
+	if (header) {
+		size_t len = strlen(data) + 1;
+
+		// replaced by text, a typed value would otherwise be rendered over it
+		header->type = EVENT_HEADER_STRING;
+		header->length = 0;
+		if (len <= header->size) {
+			// fast event slots, decoded numbers and longer old values keep their buffer
+			memcpy(header->value, data, len);
+			event_arena_unalloc(event, data, len);
+		} else {
+			header->value = data;
+			header->size = len;
+		}
+		agc_store_release(&header->rendered, 2);
+
+		return AGC_STATUS_SUCCESS;
 	}
-    
+
+	header = new_header(event, header_name);
 	assert(header);
     
 	header->value = data;
-    
-	if (event->last_header) {
-		event->last_header->next = header;
-	} else {
-		event->headers = header;
-		header->next = NULL;
-	}
-    
-	event->last_header = header;
+	header->size = strlen(data) + 1;
+	event_link_header(event, header);
     
 	return AGC_STATUS_SUCCESS;
 }
@@ -829,49 +4677,366 @@ static agc_status_t agc_event_base_add_header_nocheck(agc_event_t *event, const
 {
 	agc_event_header_t *header = NULL;
 
-	header = new_header(header_name);
+	header = new_header(event, header_name);
 
 	assert(header);
     
 	header->value = data;
+	header->size = strlen(data) + 1;
+	event_link_header(event, header);
+    
+	return AGC_STATUS_SUCCESS;
+}
+
+static agc_event_header_t *agc_event_get_header_ptr(agc_event_t *event, const char *header_name)
+{
+	uint32_t atom;
+    
+	assert(event);
+    
+	if (!header_name)
+		return NULL;
+
+	if ((atom = event_atom_lookup(header_name, event_atom_hash(header_name)))) {
+		return event_find_header(event, atom);
+	}
+
+	if (!event->loose_headers) {
+		// every header name of the event has an atom
+		return NULL;
+	}
     
+	return event_find_loose_header(event, header_name);
+}
+
+static agc_event_header_t *new_header(agc_event_t *event, const char *header_name)
+{
+	char *name;
+
+	if (!(name = event_arena_strdup(event, header_name))) {
+		return NULL;
+	}
+
+	return new_header_inplace(event, name);
+}
+
+/* a header whose name is already in the event memory */
+static agc_event_header_t *new_header_inplace(agc_event_t *event, char *header_name)
+{
+	agc_event_header_t *header;
+
+	if (!(header = event_arena_alloc(event, sizeof(*header)))) {
+		return NULL;
+	}
+
+	memset(header, 0, sizeof(*header));
+	header->name = header_name;
+	// names from the wire are not interned, the table would fill up with them
+	if (!(header->atom = agc_event_atom_find(header_name))) {
+		event->loose_headers = 1;
+	}
+	header->type = EVENT_HEADER_STRING;
+	header->rendered = 2;
+	return header;
+}
+
+static void *event_arena_alloc(agc_event_t *event, size_t size)
+{
+	event_arena_t *arena = event->arena;
+	struct event_arena_chunk *chunk;
+	size_t chunk_size;
+	void *ptr;
+
+	size = EVENT_ARENA_ALIGN(size);
+
+	if (!arena) {
+		// fast events have a fixed layout, extra headers fall back to malloc
+		return malloc(size);
+	}
+
+	if ((size_t)(arena->end - arena->pos) < size) {
+		chunk_size = arena->size * 2;
+		while (chunk_size < size + EVENT_ARENA_ALIGN(sizeof(struct event_arena_chunk))) {
+			chunk_size *= 2;
+		}
+
+		if (!(chunk = malloc(chunk_size))) {
+			return NULL;
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->pos = (char *) chunk + EVENT_ARENA_ALIGN(sizeof(struct event_arena_chunk));
+		arena->end = (char *) chunk + chunk_size;
+		arena->size = chunk_size;
+	}
+
+	ptr = arena->pos;
+	arena->pos += size;
+
+	return ptr;
+}
+
+/* give back the last allocation, a value copied into an existing buffer is not kept twice */
+static void event_arena_unalloc(agc_event_t *event, void *ptr, size_t size)
+{
+	event_arena_t *arena = event->arena;
+
+	if (!arena) {
+		free(ptr);
+		return;
+	}
+
+	if ((char *) ptr + EVENT_ARENA_ALIGN(size) == arena->pos) {
+		arena->pos = ptr;
+	}
+}
+
+static char *event_arena_strdup(agc_event_t *event, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	char *data;
+
+	if ((data = event_arena_alloc(event, len))) {
+		memcpy(data, str, len);
+	}
+
+	return data;
+}
+
+static char *event_arena_vprintf(agc_event_t *event, const char *fmt, va_list ap)
+{
+	event_arena_t *arena = event->arena;
+	char *data;
+	va_list ap2;
+	int len;
+
+	if (!arena) {
+		return agc_vasprintf(&data, fmt, ap) == -1 ? NULL : data;
+	}
+
+	// print straight into the free space, retry in a bigger chunk when it does not fit
+	va_copy(ap2, ap);
+	len = vsnprintf(arena->pos, arena->end - arena->pos, fmt, ap2);
+	va_end(ap2);
+
+	if (len < 0) {
+		return NULL;
+	}
+
+	if ((size_t) len < (size_t)(arena->end - arena->pos)) {
+		return event_arena_alloc(event, len + 1);
+	}
+
+	if ((data = event_arena_alloc(event, len + 1))) {
+		vsnprintf(data, len + 1, fmt, ap);
+	}
+
+	return data;
+}
+
+static void event_link_header(agc_event_t *event, agc_event_header_t *header)
+{
+	header->next = NULL;
+
 	if (event->last_header) {
 		event->last_header->next = header;
 	} else {
-		event->headers = header;
-		header->next = NULL;
+		event->headers = header;
+	}
+    
+	event->last_header = header;
+	event->header_count++;
+
+	if (event->index) {
+		event_index_add(event, header);
+	} else if (event->header_count >= EVENT_INDEX_THRESHOLD && !event->fast) {
+		event_index_rebuild(event);
+	}
+}
+
+static inline uint32_t event_atom_hash(const char *header_name)
+{
+	const unsigned char *p = (const unsigned char *) header_name;
+	uint32_t hash = 2166136261u;
+
+	// fnv-1a over the lower case bytes
+	for (; *p; p++) {
+		hash ^= (*p >= 'A' && *p <= 'Z') ? (*p | 0x20) : *p;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static uint32_t event_atom_lookup(const char *header_name, uint32_t hash)
+{
+	uint32_t i = hash & (EVENT_ATOM_SLOTS - 1);
+	uint32_t atom;
+
+	// at most half of the slots are used, the probe always ends on an empty slot
+	for (;;) {
+		event_atom_slot_t *slot = &EVENT_ATOMS[i];
+
+		if (!(atom = agc_load_acquire(&slot->atom))) {
+			return EVENT_ATOM_NONE;
+		}
+
+		if (slot->hash == hash && !strcasecmp(slot->name, header_name)) {
+			return atom;
+		}
+
+		i = (i + 1) & (EVENT_ATOM_SLOTS - 1);
+	}
+}
+
+AGC_DECLARE(uint32_t) agc_event_atom_find(const char *header_name)
+{
+	if (!header_name) {
+		return EVENT_ATOM_NONE;
+	}
+
+	return event_atom_lookup(header_name, event_atom_hash(header_name));
+}
+
+AGC_DECLARE(uint32_t) agc_event_atom(const char *header_name)
+{
+	uint32_t hash;
+	uint32_t atom;
+	uint32_t i;
+
+	if (!header_name) {
+		return EVENT_ATOM_NONE;
+	}
+
+	hash = event_atom_hash(header_name);
+	if ((atom = event_atom_lookup(header_name, hash)) || EVENT_ATOM_FULL) {
+		return atom;
+	}
+
+	agc_mutex_lock(EVENT_ATOM_MUTEX);
+
+	if ((atom = event_atom_lookup(header_name, hash))) {
+		agc_mutex_unlock(EVENT_ATOM_MUTEX);
+		return atom;
+	}
+
+	if (EVENT_ATOM_COUNT >= EVENT_ATOM_LIMIT) {
+		if (!EVENT_ATOM_FULL) {
+			agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Event header atom table full, %d names interned.\n", EVENT_ATOM_COUNT);
+		}
+		EVENT_ATOM_FULL = 1;
+		agc_mutex_unlock(EVENT_ATOM_MUTEX);
+		return EVENT_ATOM_NONE;
+	}
+
+	for (i = hash & (EVENT_ATOM_SLOTS - 1); EVENT_ATOMS[i].atom; i = (i + 1) & (EVENT_ATOM_SLOTS - 1));
+
+	EVENT_ATOMS[i].hash = hash;
+	EVENT_ATOMS[i].name = strdup(header_name);
+	atom = ++EVENT_ATOM_COUNT;
+	EVENT_ATOM_NAMES[atom] = EVENT_ATOMS[i].name;
+	agc_store_release(&EVENT_ATOMS[i].atom, atom);
+
+	agc_mutex_unlock(EVENT_ATOM_MUTEX);
+
+	return atom;
+}
+
+static agc_event_header_t *event_find_header(agc_event_t *event, uint32_t atom)
+{
+	agc_event_header_t *hp;
+
+	if (event->index) {
+		uint32_t mask = event->index_size - 1;
+		uint32_t i = (atom * 2654435761u) & mask;
+
+		for (; (hp = event->index[i]); i = (i + 1) & mask) {
+			if (hp->atom == atom) {
+				return hp;
+			}
+		}
+	} else {
+		for (hp = event->headers; hp; hp = hp->next) {
+			if (hp->atom == atom) {
+				return hp;
+			}
+		}
 	}
-    
-	event->last_header = header;
-    
-	return AGC_STATUS_SUCCESS;
+
+	if (event->loose_headers) {
+		return event_find_loose_header(event, EVENT_ATOM_NAMES[atom]);
+	}
+
+	return NULL;
 }
-static agc_event_header_t *agc_event_get_header_ptr(agc_event_t *event, const char *header_name)
+
+/* the headers whose name had no atom when they were added */
+static agc_event_header_t *event_find_loose_header(agc_event_t *event, const char *header_name)
 {
 	agc_event_header_t *hp;
-    
-	assert(event);
-    
-	if (!header_name)
-		return NULL;
-    
+
 	for (hp = event->headers; hp; hp = hp->next) {
-		if (!strcasecmp(hp->name, header_name)) {
+		if (!hp->atom && !strcasecmp(hp->name, header_name)) {
 			return hp;
 		}
 	}
-	
+
 	return NULL;
 }
 
-static agc_event_header_t *new_header(const char *header_name)
+static void event_index_add(agc_event_t *event, agc_event_header_t *header)
 {
-	agc_event_header_t *header;
+	uint32_t mask;
+	uint32_t i;
 
-	header = malloc(sizeof(*header));
-	memset(header, 0, sizeof(*header));
-	header->name = strdup(header_name);
-	return header;
+	if (!header->atom) {
+		return;
+	}
+
+	// keep the load factor under one half
+	if (event->header_count * 2 > event->index_size) {
+		event_index_rebuild(event);
+		return;
+	}
+
+	mask = event->index_size - 1;
+	for (i = (header->atom * 2654435761u) & mask; event->index[i]; i = (i + 1) & mask) {
+		// the first header of a name wins, as in the list
+		if (event->index[i]->atom == header->atom) {
+			return;
+		}
+	}
+
+	event->index[i] = header;
+}
+
+static void event_index_rebuild(agc_event_t *event)
+{
+	agc_event_header_t *hp;
+	uint32_t size = 16;
+
+	// the old index stays in the arena
+	event->index = NULL;
+	event->index_size = 0;
+
+	if (event->header_count < EVENT_INDEX_THRESHOLD) {
+		return;
+	}
+
+	while (size < event->header_count * 4) {
+		size <<= 1;
+	}
+
+	if (!(event->index = event_arena_alloc(event, size * sizeof(agc_event_header_t *)))) {
+		return;
+	}
+	memset(event->index, 0, size * sizeof(agc_event_header_t *));
+	event->index_size = size;
+
+	for (hp = event->headers; hp; hp = hp->next) {
+		event_index_add(event, hp);
+	}
 }
 
 AGC_DECLARE(agc_status_t) agc_event_fast_initial(int fast_event_type, int event_id, int capacity, 
@@ -879,18 +5044,46 @@ AGC_DECLARE(agc_status_t) agc_event_fast_initial(int fast_event_type, int event_
 {
 	int i = 0;
 	agc_event_t *new_event = NULL;
+	fast_event_pool_t *pool = NULL;
 	
-	if (fast_event_type >= EVENT_FAST_TYPE_Invalid) {
+	if (fast_event_type < 0 || fast_event_type >= EVENT_FAST_TYPE_Invalid) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent invalid event type:%d.\n", fast_event_type);
 		return AGC_STATUS_GENERR;
 	}
 
-	if (FAST_EVENT_QUEUES[fast_event_type] != NULL) {
+	if (FAST_EVENT_POOLS[fast_event_type] != NULL) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d already initialed.\n", fast_event_type);
 		return AGC_STATUS_GENERR;
 	}
 
-	agc_queue_create(&FAST_EVENT_QUEUES[fast_event_type], (capacity + 10), RUNTIME_POOL);
+	pool = malloc(sizeof(fast_event_pool_t));
+	assert(pool);
+	memset(pool, 0, sizeof(fast_event_pool_t));
+
+	// keep the template, the pool grows later
+	pool->type = fast_event_type;
+	pool->event_id = event_id;
+	pool->header_numbers = headernumbers;
+	pool->bodylength = bodylength;
+	pool->headers = malloc((headernumbers + 1) * sizeof(char *));
+	pool->valuelengths = malloc((headernumbers + 1) * sizeof(int));
+	assert(pool->headers && pool->valuelengths);
+	for (i = 0; i < headernumbers; i++) {
+		pool->headers[i] = strdup(headers[i]);
+		pool->valuelengths[i] = valuelengths[i];
+	}
+
+	pool->low_water = (uint32_t)((int64_t) capacity * FAST_EVENT_LOW_WATER / 100);
+	pool->high_water = (uint32_t)((int64_t) capacity * FAST_EVENT_HIGH_WATER / 100);
+	if (pool->high_water < (uint32_t) capacity) {
+		pool->high_water = capacity;
+	}
+	if (pool->high_water < (uint32_t) FAST_EVENT_CACHE_SIZE) {
+		pool->high_water = FAST_EVENT_CACHE_SIZE;
+	}
+
+	pool->queue_size = pool->high_water;
+	agc_queue_create_ex(&pool->queue, pool->queue_size, AGC_QUEUE_RING, RUNTIME_POOL);
 
 	for (i = 0; i < capacity; i++ ) {
 		if (fast_event_create(&new_event, fast_event_type, event_id, headers, valuelengths, headernumbers, bodylength) != AGC_STATUS_SUCCESS) {
@@ -898,37 +5091,103 @@ AGC_DECLARE(agc_status_t) agc_event_fast_initial(int fast_event_type, int event_
 			return AGC_STATUS_GENERR;
 		}
 
-		if (agc_queue_trypush(FAST_EVENT_QUEUES[fast_event_type], new_event) != AGC_STATUS_SUCCESS) {
+		if (agc_queue_trypush(pool->queue, new_event) != AGC_STATUS_SUCCESS) {
 			agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d push event failed.\n", fast_event_type);
+			fast_event_free(new_event);
 			return AGC_STATUS_GENERR;
 		}
 
+		pool->total++;
 		new_event = NULL;
 	}
 
+	agc_store_release(&FAST_EVENT_POOLS[fast_event_type], pool);
+
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_set_watermarks(int fast_event_type, int low_water, int high_water)
+{
+	fast_event_pool_t *pool;
+
+	if (fast_event_type < 0 || fast_event_type >= EVENT_FAST_TYPE_Invalid || !(pool = FAST_EVENT_POOLS[fast_event_type])) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (low_water < 0 || high_water < low_water || (uint32_t) high_water > pool->queue_size) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d invalid water marks %d %d.\n", fast_event_type, low_water, high_water);
+		return AGC_STATUS_GENERR;
+	}
+
+	pool->low_water = low_water;
+	pool->high_water = high_water;
+
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_stats(int fast_event_type, agc_event_fast_stats_t *stats)
+{
+	fast_event_pool_t *pool;
+
+	if (fast_event_type < 0 || fast_event_type >= EVENT_FAST_TYPE_Invalid || !(pool = FAST_EVENT_POOLS[fast_event_type]) || !stats) {
+		return AGC_STATUS_GENERR;
+	}
+
+	stats->allocs = agc_load_acquire(&pool->stats.allocs);
+	stats->releases = agc_load_acquire(&pool->stats.releases);
+	stats->grown = agc_load_acquire(&pool->stats.grown);
+	stats->freed = agc_load_acquire(&pool->stats.freed);
+	stats->total = agc_load_acquire(&pool->total);
+	stats->pooled = agc_queue_size(pool->queue);
+	stats->low_water = pool->low_water;
+	stats->high_water = pool->high_water;
+
 	return AGC_STATUS_SUCCESS;
 }
 
 AGC_DECLARE(agc_status_t) agc_event_fast_alloc(agc_event_t **event, int fast_event_type)
 {
-	void *pop = NULL;
+	fast_event_cache_t *cache;
+	fast_event_pool_t *pool;
+	agc_event_t **events;
+	unsigned int count;
 	
-	if (fast_event_type >= EVENT_FAST_TYPE_Invalid) {
+	if (fast_event_type < 0 || fast_event_type >= EVENT_FAST_TYPE_Invalid) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent invalid event type:%d.\n", fast_event_type);
 		return AGC_STATUS_GENERR;
 	}
 
-	if (FAST_EVENT_QUEUES[fast_event_type] == NULL) {
+	if ((pool = agc_load_acquire(&FAST_EVENT_POOLS[fast_event_type])) == NULL) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d not initialed.\n", fast_event_type);
 		return AGC_STATUS_GENERR;
 	}
 
-	if (agc_queue_trypop(FAST_EVENT_QUEUES[fast_event_type], &pop) != AGC_STATUS_SUCCESS) {
-		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d pop failed.\n", fast_event_type);
-		return AGC_STATUS_GENERR;
+	if (!(cache = fast_cache_get())) {
+		return AGC_STATUS_MEMERR;
 	}
 
-	*event = (agc_event_t *)pop;
+	events = cache->events[fast_event_type];
+	if (!cache->count[fast_event_type]) {
+		// refill half of the cache from the shared pool, create events when it is dry
+		count = agc_queue_trypop_bulk(pool->queue, (void **) events, FAST_EVENT_CACHE_SIZE / 2 + 1);
+		if (!count) {
+			if (!fast_pool_grow(pool, events, FAST_EVENT_CACHE_SIZE / 2 + 1)) {
+				agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d grow failed.\n", fast_event_type);
+				return AGC_STATUS_MEMERR;
+			}
+			count = FAST_EVENT_CACHE_SIZE / 2 + 1;
+		}
+
+		cache->count[fast_event_type] = count;
+
+		agc_fetch_add(&pool->stats.allocs, cache->allocs[fast_event_type]);
+		cache->allocs[fast_event_type] = 0;
+	}
+
+	*event = events[--cache->count[fast_event_type]];
+	(*event)->refs = 1;
+	(*event)->deadline = 0;
+	cache->allocs[fast_event_type]++;
 
 	return AGC_STATUS_SUCCESS;
 }
@@ -951,15 +5210,21 @@ AGC_DECLARE(agc_status_t) agc_event_fast_create_callback(agc_event_t **event, vo
 AGC_DECLARE(agc_status_t) agc_event_fast_set_strheader(agc_event_t *event, int index, const char *name, const char *value)
 {
 	agc_event_header_t *header = NULL;
+	size_t len = value ? strlen(value) : 0;
 	
-	header = fast_get_header(event, index);
-	if (!header) {
+	if (!(header = fast_set_header(event, index, name, EVENT_HEADER_STRING))) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_strheader  header not exist index %d.\n",  index);
 		return AGC_STATUS_GENERR;
 	}
 
-	strcpy(header->name, name);
-	strcpy(header->value, value);
+	if (len >= header->size) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_strheader  value too long index %d.\n",  index);
+		header->value[0] = '\0';
+		return AGC_STATUS_GENERR;
+	}
+
+	memcpy(header->value, value, len + 1);
+	header->length = len;
 	return AGC_STATUS_SUCCESS;
 }
 
@@ -967,15 +5232,12 @@ AGC_DECLARE(agc_status_t) agc_event_fast_set_intheader(agc_event_t *event, int i
 {
 	agc_event_header_t *header = NULL;
 
-	header = fast_get_header(event, index);
-
-	if (!header) {
+	if (!(header = fast_set_header(event, index, name, EVENT_HEADER_INT32))) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_intheader  header not exist index %d.\n", index);
 		return AGC_STATUS_GENERR;
 	}
 
-	strcpy(header->name, name);
-	sprintf(header->value, "%d", value);
+	header->native.i32 = value;
 	return AGC_STATUS_SUCCESS;
 }
 
@@ -983,15 +5245,96 @@ AGC_DECLARE(agc_status_t) agc_event_fast_set_uintheader(agc_event_t *event, int
 {
 	agc_event_header_t *header = NULL;
 
-	header = fast_get_header(event, index);
-
-	if (!header) {
+	if (!(header = fast_set_header(event, index, name, EVENT_HEADER_UINT32))) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_uintheader  header not exist index %d.\n", index);
 		return AGC_STATUS_GENERR;
 	}
 
-	strcpy(header->name, name);
-	sprintf(header->value, "%u", value);
+	header->native.u32 = value;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_set_int64header(agc_event_t *event, int index, const char *name, int64_t value)
+{
+	agc_event_header_t *header = NULL;
+
+	if (!(header = fast_set_header(event, index, name, EVENT_HEADER_INT64))) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_int64header  header not exist index %d.\n", index);
+		return AGC_STATUS_GENERR;
+	}
+
+	header->native.i64 = value;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_set_bytesheader(agc_event_t *event, int index, const char *name, const void *data, int len)
+{
+	agc_event_header_t *header = NULL;
+
+	if (!(header = fast_set_header(event, index, name, EVENT_HEADER_BYTES))) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_bytesheader  header not exist index %d.\n", index);
+		return AGC_STATUS_GENERR;
+	}
+
+	// keep a terminating zero so the text view needs no rendering
+	if (len < 0 || (uint32_t) len >= header->size) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_set_bytesheader  value too long index %d.\n", index);
+		header->value[0] = '\0';
+		header->length = 0;
+		return AGC_STATUS_GENERR;
+	}
+
+	memcpy(header->value, data, len);
+	header->value[len] = '\0';
+	header->length = len;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_intheader(agc_event_t *event, int index, int32_t *value)
+{
+	int64_t native;
+
+	if (fast_get_native(event, index, &native) != AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_GENERR;
+	}
+
+	*value = (int32_t) native;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_uintheader(agc_event_t *event, int index, uint32_t *value)
+{
+	int64_t native;
+
+	if (fast_get_native(event, index, &native) != AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_GENERR;
+	}
+
+	*value = (uint32_t) native;
+	return AGC_STATUS_SUCCESS;
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_int64header(agc_event_t *event, int index, int64_t *value)
+{
+	return fast_get_native(event, index, value);
+}
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_bytesheader(agc_event_t *event, int index, const void **data, int *len)
+{
+	agc_event_header_t *header = NULL;
+
+	if (!(header = fast_get_header(event, index))) {
+		return AGC_STATUS_GENERR;
+	}
+
+	if (header->type == EVENT_HEADER_BYTES || header->type == EVENT_HEADER_STRING) {
+		*data = header->value;
+		*len = header->length;
+	} else {
+		*data = event_header_text(header);
+		*len = strlen(header->value);
+	}
+
 	return AGC_STATUS_SUCCESS;
 }
 
@@ -1001,16 +5344,22 @@ AGC_DECLARE(agc_status_t) agc_event_fast_get_type(agc_event_t *event, int *type)
 
 	header = fast_get_header(event, EVENT_FAST_HEADERINDEX1);
 	if (!header) {
-		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_get_type  header not exist index %d.\n", index);
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "agc_event_fast_get_type  header not exist index %d.\n", EVENT_FAST_HEADERINDEX1);
 		return AGC_STATUS_GENERR;
 	}
 
-	*type = atoi(header->value);
+	if (header->type == EVENT_HEADER_INT32) {
+		*type = header->native.i32;
+	} else {
+		*type = atoi(header->value);
+	}
 	return AGC_STATUS_SUCCESS;
 }
 
 AGC_DECLARE(agc_status_t) agc_event_fast_release(agc_event_t **event) {
 	fast_event_node_t *fast;
+	fast_event_cache_t *cache;
+	fast_event_pool_t *pool;
 	agc_event_t *pevent = *event;
 	
 	if (!pevent || !pevent->fast) {
@@ -1018,17 +5367,35 @@ AGC_DECLARE(agc_status_t) agc_event_fast_release(agc_event_t **event) {
 	}
 
 	fast = pevent->fast;
+	pool = FAST_EVENT_POOLS[fast->type];
+	*event = NULL;
 
-	agc_queue_trypush(FAST_EVENT_QUEUES[fast->type], pevent);
+	if (EVENT_SHARED(pevent) && agc_fetch_add(&pevent->refs, -1) > 1) {
+		return AGC_STATUS_SUCCESS;
+	}
 
-	*event = NULL;
+	if (!(cache = fast_cache_get())) {
+		if (agc_queue_trypush(pool->queue, pevent) != AGC_STATUS_SUCCESS) {
+			fast_event_free(pevent);
+			agc_fetch_add(&pool->total, -1);
+			agc_fetch_add(&pool->stats.freed, 1);
+		}
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (cache->count[fast->type] >= FAST_EVENT_CACHE_SIZE) {
+		fast_cache_flush(cache, pool, FAST_EVENT_CACHE_SIZE / 2);
+	}
+
+	cache->events[fast->type][cache->count[fast->type]++] = pevent;
+	cache->releases[fast->type]++;
 		
 	return AGC_STATUS_SUCCESS;
 }
 
 AGC_DECLARE(agc_status_t) agc_event_fast_set_body(agc_event_t *event, const char *body, int len)
 {
-	if (!event || !event->body) {
+	if (!event || !event->body || EVENT_SHARED(event)) {
 		return AGC_STATUS_FALSE;
 	}
 
@@ -1054,12 +5421,14 @@ static agc_status_t fast_event_create(agc_event_t **event, int fast_event_type,
 	/* payload
 	*  fast_event_node_t
 	*  agc_event_header_t* * headernumbers
+	*  int * headernumbers (name sizes)
 	*  agc_event_header_t * headernumbers
 	*  name->value name->value
 	*  body
 	*/
 	payload_size += sizeof(fast_event_node_t);
 	payload_size += headernumbers * sizeof(agc_event_header_t *);
+	payload_size += EVENT_ARENA_ALIGN(headernumbers * sizeof(int));
 	payload_size += headernumbers * sizeof(agc_event_header_t);
 	
 	for (i = 0; i < headernumbers; i++) {
@@ -1082,6 +5451,8 @@ static agc_status_t fast_event_create(agc_event_t **event, int fast_event_type,
 	fast->header_numbers = headernumbers;
 	fast->headers = (agc_event_header_t **)buff;
 	buff += headernumbers * sizeof(agc_event_header_t *);
+	fast->name_sizes = (int *)buff;
+	buff += EVENT_ARENA_ALIGN(headernumbers * sizeof(int));
 
 	//fill headers
 	for (i = 0; i < headernumbers; i++) {
@@ -1093,8 +5464,12 @@ static agc_status_t fast_event_create(agc_event_t **event, int fast_event_type,
 	for (i = 0; i < headernumbers; i++) {
 		new_header = fast->headers[i];
 		new_header->name = buff;
+		fast->name_sizes[i] = strlen(headers[i]) + 1;
 		buff += (strlen(headers[i]) + 1);
 		new_header->value = buff;
+		new_header->size = valuelengths[i];
+		new_header->type = EVENT_HEADER_STRING;
+		new_header->rendered = 2;
 		buff += valuelengths[i];
 	}
 
@@ -1105,7 +5480,10 @@ static agc_status_t fast_event_create(agc_event_t **event, int fast_event_type,
 	if (headernumbers > 0) {
 		new_header = fast->headers[EVENT_FAST_HEADERINDEX1];
 		strcpy(new_header->name, EVENT_HEADER_TYPE);
-		sprintf(new_header->value, "%d", fast_event_type);
+		new_header->atom = EVENT_ATOM_TYPE;
+		new_header->type = EVENT_HEADER_INT32;
+		new_header->native.i32 = fast_event_type;
+		new_header->rendered = 0;
 	}
 
 	*event = new_event;
@@ -1122,6 +5500,7 @@ static inline void fast_add_header(agc_event_t *event, agc_event_header_t *heade
 	}
 
 	event->last_header = header;
+	event->header_count++;
 }
 
 static inline agc_event_header_t *fast_get_header(agc_event_t *event, int index)
@@ -1149,3 +5528,206 @@ static inline agc_event_header_t *fast_get_header(agc_event_t *event, int index)
 	return header;
 }
 
+static agc_event_header_t *fast_set_header(agc_event_t *event, int index, const char *name, agc_event_header_type_t type)
+{
+	agc_event_header_t *header;
+	fast_event_node_t *fast;
+
+	if (!(header = fast_get_header(event, index)) || EVENT_SHARED(event)) {
+		return NULL;
+	}
+
+	fast = event->fast;
+	if (strlen(name) >= (size_t) fast->name_sizes[index]) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "fastevent event type:%d header name %s too long index %d.\n", fast->type, name, index);
+		return NULL;
+	}
+
+	strcpy(header->name, name);
+	if (!(header->atom = agc_event_atom_find(name))) {
+		event->loose_headers = 1;
+	}
+	header->type = type;
+	header->length = 0;
+	// numbers are printed only when somebody asks for the text
+	header->rendered = (type == EVENT_HEADER_STRING || type == EVENT_HEADER_BYTES) ? 2 : 0;
+
+	return header;
+}
+
+static agc_status_t fast_get_native(agc_event_t *event, int index, int64_t *value)
+{
+	agc_event_header_t *header;
+
+	if (!(header = fast_get_header(event, index))) {
+		return AGC_STATUS_GENERR;
+	}
+
+	switch (header->type) {
+	case EVENT_HEADER_INT32:
+		*value = header->native.i32;
+		break;
+	case EVENT_HEADER_UINT32:
+		*value = header->native.u32;
+		break;
+	case EVENT_HEADER_INT64:
+		*value = header->native.i64;
+		break;
+	default:
+		*value = strtoll(header->value, NULL, 10);
+		break;
+	}
+
+	return AGC_STATUS_SUCCESS;
+}
+
+/*
+ * Text of a header, native fast event values are printed into their slot once.
+ * Events may be read by several threads, the first reader renders and the others wait.
+ */
+static const char *event_header_text(agc_event_header_t *header)
+{
+	uint8_t state = 0;
+
+	if (agc_load_acquire(&header->rendered) == 2) {
+		return header->value;
+	}
+
+	if (agc_cas(&header->rendered, &state, 1)) {
+		switch (header->type) {
+		case EVENT_HEADER_INT32:
+			snprintf(header->value, header->size, "%d", header->native.i32);
+			break;
+		case EVENT_HEADER_UINT32:
+			snprintf(header->value, header->size, "%u", header->native.u32);
+			break;
+		case EVENT_HEADER_INT64:
+			snprintf(header->value, header->size, "%" PRId64, header->native.i64);
+			break;
+		default:
+			break;
+		}
+		agc_store_release(&header->rendered, 2);
+	} else {
+		while (agc_load_acquire(&header->rendered) != 2) {
+			agc_cpu_relax();
+		}
+	}
+
+	return header->value;
+}
+
+static fast_event_cache_t *fast_cache_get(void)
+{
+	fast_event_cache_t *cache = FAST_EVENT_CACHE;
+	int i;
+
+	if (cache) {
+		return cache;
+	}
+
+	if (!(cache = malloc(sizeof(fast_event_cache_t) + EVENT_FAST_TYPE_Invalid * FAST_EVENT_CACHE_SIZE * sizeof(agc_event_t *)))) {
+		return NULL;
+	}
+
+	memset(cache, 0, sizeof(fast_event_cache_t));
+	for (i = 0; i < EVENT_FAST_TYPE_Invalid; i++) {
+		cache->events[i] = (agc_event_t **)(cache + 1) + i * FAST_EVENT_CACHE_SIZE;
+	}
+
+	// the key gives the cached events back when the thread exits
+	pthread_setspecific(FAST_EVENT_CACHE_KEY, cache);
+	FAST_EVENT_CACHE = cache;
+
+	return cache;
+}
+
+static void fast_cache_destroy(void *data)
+{
+	fast_event_cache_t *cache = (fast_event_cache_t *) data;
+	int i;
+
+	for (i = 0; i < EVENT_FAST_TYPE_Invalid; i++) {
+		if (FAST_EVENT_POOLS[i]) {
+			fast_cache_flush(cache, FAST_EVENT_POOLS[i], 0);
+		}
+	}
+
+	FAST_EVENT_CACHE = NULL;
+	free(cache);
+}
+
+/* give the cached events above keep back to the shared pool, free what does not fit under the high water mark */
+static void fast_cache_flush(fast_event_cache_t *cache, fast_event_pool_t *pool, int keep)
+{
+	int type = pool->type;
+	uint32_t freed = 0;
+
+	while (cache->count[type] > keep) {
+		agc_event_t *event = cache->events[type][--cache->count[type]];
+
+		if (agc_queue_size(pool->queue) >= pool->high_water || agc_queue_trypush(pool->queue, event) != AGC_STATUS_SUCCESS) {
+			fast_event_free(event);
+			freed++;
+		}
+	}
+
+	if (freed) {
+		agc_fetch_add(&pool->total, -freed);
+		agc_fetch_add(&pool->stats.freed, freed);
+	}
+
+	agc_fetch_add(&pool->stats.releases, cache->releases[type]);
+	cache->releases[type] = 0;
+}
+
+/* the pool ran dry, create count events for the caller and refill the pool up to the low water mark */
+static agc_event_t *fast_pool_grow(fast_event_pool_t *pool, agc_event_t **events, int count)
+{
+	agc_event_t *new_event = NULL;
+	uint32_t created = 0;
+	int refill = 0;
+	int i;
+
+	if (pool->low_water > agc_queue_size(pool->queue) + count) {
+		refill = pool->low_water - agc_queue_size(pool->queue) - count;
+	}
+
+	for (i = 0; i < count + refill; i++) {
+		if (fast_event_create(&new_event, pool->type, pool->event_id, (const char **) pool->headers, 
+							pool->valuelengths, pool->header_numbers, pool->bodylength) != AGC_STATUS_SUCCESS) {
+			break;
+		}
+
+		if (i < count) {
+			events[i] = new_event;
+		} else if (agc_queue_trypush(pool->queue, new_event) != AGC_STATUS_SUCCESS) {
+			fast_event_free(new_event);
+			break;
+		}
+		created++;
+	}
+
+	if (created) {
+		agc_fetch_add(&pool->total, created);
+		agc_fetch_add(&pool->stats.grown, created);
+	}
+
+	if (created < (uint32_t) count) {
+		while (created) {
+			fast_event_free(events[--created]);
+		}
+		return NULL;
+	}
+
+	agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "fastevent event type:%d grown by %u, %u events.\n", pool->type, created, pool->total);
+
+	return events[0];
+}
+
+static void fast_event_free(agc_event_t *event)
+{
+	// the fast node is the start of the payload block
+	agc_safe_free(event->fast);
+	free(event);
+}
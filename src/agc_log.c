@@ -50,6 +50,8 @@ static agc_log_node_t *agc_log_node_alloc()
 
 static void *log_thread_func(agc_thread_t *t, void *obj)
 {
+	agc_core_thread_place(AGC_THREAD_LOG, -1);
+
 	if (!obj) {
 		obj = NULL;
 	}
@@ -104,6 +104,8 @@ static void *agc_timer_dispatch_timer(agc_thread_t *thread, void *obj)
 	agc_rbtree_node_t  *node, *root, *sentinel;
 	agc_time_t current_ms;
 
+	agc_core_thread_place(AGC_THREAD_TIMER, -1);
+
 	SYSTEM_RUNNING = 1;
 	SYSTEM_SHUTDOWN = 0;
 
@@ -136,7 +138,11 @@ static void *agc_timer_dispatch_timer(agc_thread_t *thread, void *obj)
 		agc_mutex_lock(TIMER_RBTREE_MUTEX);
 		agc_rbtree_delete(timertree, &ev->timer);
 		agc_mutex_unlock(TIMER_RBTREE_MUTEX);
-		agc_event_fire(&ev);
+
+		// never wait on a full dispatcher, the other timers would be late too
+		if (agc_event_try_fire(&ev) == AGC_STATUS_BREAK) {
+			agc_timer_add_timer(ev, 1);
+		}
 
 	}
     
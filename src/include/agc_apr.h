@@ -327,6 +327,15 @@ AGC_DECLARE(agc_status_t) agc_md5_string(char digest_str[AGC_MD5_DIGEST_STRING_S
  */
 AGC_DECLARE(agc_status_t) agc_queue_create(agc_queue_t ** queue, unsigned int queue_capacity, agc_memory_pool_t *pool);
 
+/** 
+ * create a FIFO queue of the given type
+ * @param queue The new queue
+ * @param queue_capacity maximum size of the queue
+ * @param type AGC_QUEUE_APR or AGC_QUEUE_RING
+ * @param pool a pool to allocate queue from
+ */
+AGC_DECLARE(agc_status_t) agc_queue_create_ex(agc_queue_t ** queue, unsigned int queue_capacity, agc_queue_type_t type, agc_memory_pool_t *pool);
+
 /**
  * pop/get an object from the queue, blocking if the queue is already empty
  *
@@ -365,6 +374,20 @@ AGC_DECLARE(agc_status_t) agc_queue_pop_timeout(agc_queue_t *queue, void **data,
  */
 AGC_DECLARE(agc_status_t) agc_queue_push(agc_queue_t *queue, void *data);
 
+/**
+ * push/add a object to the queue, waiting up to timeout if the queue is full
+ *
+ * @param queue the queue
+ * @param data the data
+ * @param timeout The amount of time in microseconds to wait, a ring queue
+ *        only, the others wait until there is room or they are interrupted.
+ * @returns APR_TIMEUP the request timed out
+ * @returns APR_EINTR the blocking was interrupted (try again)
+ * @returns APR_EOF the queue has been terminated
+ * @returns APR_SUCCESS on a successfull push
+ */
+AGC_DECLARE(agc_status_t) agc_queue_push_timeout(agc_queue_t *queue, void *data, agc_interval_time_t timeout);
+
 /**
  * returns the size of the queue.
  *
@@ -387,6 +410,16 @@ AGC_DECLARE(unsigned int) agc_queue_size(agc_queue_t *queue);
  */
 AGC_DECLARE(agc_status_t) agc_queue_trypop(agc_queue_t *queue, void **data);
 
+/**
+ * pop/get up to max objects from the queue, returning immediatly if the queue is empty
+ *
+ * @param queue the queue
+ * @param data array of at least max entries
+ * @param max the maximum number of objects to pop
+ * @returns the number of objects popped
+ */
+AGC_DECLARE(unsigned int) agc_queue_trypop_bulk(agc_queue_t *queue, void **data, unsigned int max);
+
 AGC_DECLARE(agc_status_t) agc_queue_interrupt_all(agc_queue_t *queue);
 
 AGC_DECLARE(agc_status_t) agc_queue_term(agc_queue_t *queue);
@@ -403,6 +436,16 @@ AGC_DECLARE(agc_status_t) agc_queue_term(agc_queue_t *queue);
  */
 AGC_DECLARE(agc_status_t) agc_queue_trypush(agc_queue_t *queue, void *data);
 
+/**
+ * push up to count objects to the queue in order, returning immediatly if the queue is full
+ *
+ * @param queue the queue
+ * @param data the objects
+ * @param count the number of objects
+ * @returns the number of objects pushed, the first ones of data
+ */
+AGC_DECLARE(unsigned int) agc_queue_trypush_bulk(agc_queue_t *queue, void **data, unsigned int count);
+
 
 /* flags for apr_file_seek */
 /** Set the file position */
@@ -21,8 +21,8 @@ struct agc_connection_s {
     
     int thread_index;
     
-    //the unique id of connection
-    int id;
+    //the unique id of connection, never reused
+    uint64_t id;
 };
 
 struct agc_listening_s {
@@ -31,6 +31,16 @@ struct agc_core_thread_obj {
 
 typedef struct agc_core_thread_obj agc_core_thread_obj_t;
 
+/* the kinds of core threads, each is placed by the <role>_cpus and <role>_nodes keys under core: in agc.yml */
+typedef enum {
+	AGC_THREAD_DISPATCHER,
+	AGC_THREAD_EPOLL,
+	AGC_THREAD_TIMER,
+	AGC_THREAD_LOG,
+	AGC_THREAD_POOL,
+	AGC_THREAD_ROLE_MAX
+} agc_thread_role_t;
+
 extern agc_directories_t AGC_GLOBAL_dirs;
 
 #define AGC_PATH_SEPARATOR "/"
@@ -65,6 +75,14 @@ AGC_DECLARE(void) agc_os_yield(void);
 
 AGC_DECLARE(agc_thread_t *) agc_core_launch_thread(agc_thread_start_t func, void *obj, agc_memory_pool_t *pool);
 
+/*
+ * Name the calling thread after its role (and index, -1 for none) and bind it to the cpus
+ * and numa nodes configured for the role. Threads with an index get one cpu each,
+ * round robin over the set. Memory the thread touches first afterwards is local to it,
+ * what was allocated before, like the event queues, stays where it was.
+ */
+AGC_DECLARE(agc_status_t) agc_core_thread_place(agc_thread_role_t role, int index);
+
 AGC_DECLARE(agc_status_t) agc_core_modload(const char **err);
 
 AGC_DECLARE(const char *) agc_core_get_hostname(void);
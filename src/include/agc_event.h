@@ -34,11 +34,32 @@ AGC_BEGIN_EXTERN_C
 #define EVENT_HEADER_DESC "_desc"
 #define EVENT_HEADER_SUBNAME "_subname" 
 #define EVENT_HEADER_TYPE "_t"
+#define EVENT_HEADER_CORRELATION "_corr"
+#define EVENT_HEADER_REPLY "_reply"
 
 #define EVENT_HEADER_TYPE_LEN 4
 
+/* atoms of the well known headers, interned by agc_event_init */
+#define EVENT_ATOM_NONE 0
+#define EVENT_ATOM_ROUTING 1
+#define EVENT_ATOM_UUID 2
+#define EVENT_ATOM_CODE 3
+#define EVENT_ATOM_DESC 4
+#define EVENT_ATOM_SUBNAME 5
+#define EVENT_ATOM_TYPE 6
+#define EVENT_ATOM_CORRELATION 7
+#define EVENT_ATOM_REPLY 8
+
 #define EVENT_FAST_HEADER_INDEX1 0
 
+typedef enum {
+	EVENT_HEADER_STRING,
+	EVENT_HEADER_INT32,
+	EVENT_HEADER_UINT32,
+	EVENT_HEADER_INT64,
+	EVENT_HEADER_BYTES
+} agc_event_header_type_t;
+
 typedef enum {
 	EVENT_FAST_HEADERINDEX1,
 	EVENT_FAST_HEADERINDEX2,	
@@ -85,6 +106,22 @@ struct agc_event_header {
 	char *name;
 	/*! the header value */
 	char *value;
+	/*! the interned, case insensitive name, EVENT_ATOM_NONE if the atom table is full */
+	uint32_t atom;
+	/*! agc_event_header_type_t, fast event slots may hold native values */
+	uint8_t type;
+	/*! native values are rendered into value on first text access, 0 no, 1 rendering, 2 yes */
+	volatile uint8_t rendered;
+	/*! size of the value buffer of a fast event slot */
+	uint32_t size;
+	/*! length of a bytes value */
+	uint32_t length;
+	/*! the native value */
+	union {
+		int32_t i32;
+		uint32_t u32;
+		int64_t i64;
+	} native;
 
 	struct agc_event_header *next;
 };
@@ -96,7 +133,7 @@ struct agc_event {
 	int event_id;
         
 	/*! the source of event, the same soure will be handled by same thread */
-	uint32_t source_id;
+	uint64_t source_id;
 
 	int debug_id;
     
@@ -104,6 +141,20 @@ struct agc_event {
 	agc_event_header_t *headers; 
     
 	agc_event_header_t *last_header;
+
+	/*! number of headers */
+	uint32_t header_count;
+
+	/*! set once a header was added whose name had no atom, such headers are found by name */
+	uint8_t loose_headers;
+
+	/*! open addressed atom index, built once the event has EVENT_INDEX_THRESHOLD headers */
+	agc_event_header_t **index;
+
+	uint32_t index_size;
+
+	/*! memory of headers, values and body, allocated in the same block as the event */
+	void *arena;
     
 	 /*! the context of event */
 	void *context;
@@ -122,34 +173,193 @@ struct agc_event {
 	agc_rbtree_node_t  timer;
     
 	struct agc_event *next;
+
+	/*! the holders of the event, it is read only while more than one holds it */
+	volatile uint32_t refs;
+
+	/*! when it was fired, to measure the queueing delay */
+	agc_time_t fired;
+
+	/*! the priority class it was queued in, set when fired */
+	uint8_t priority;
+
+	/*! spilled by EVENT_OVERFLOW_DROP_OLDEST, an older event of its source and id is dropped for it */
+	uint8_t displacing;
+
+	/*! dropped instead of delivered once passed, 0 for none */
+	agc_time_t deadline;
 };
 
 struct agc_event_node;
 
 typedef struct agc_event agc_event_t;
 
+#define EVENT_BATCH_BUCKETS 11
+
+typedef struct agc_event_dispatch_stats {
+	/*! the number of wakeups which delivered events */
+	uint64_t batches;
+	/*! the number of events delivered */
+	uint64_t events;
+	/*! the biggest batch */
+	uint32_t max_batch;
+	/*! batch size histogram, bucket i counts the batches of size [2^i, 2^(i+1)) */
+	uint64_t batch_sizes[EVENT_BATCH_BUCKETS];
+	/*! the deepest the queue was seen at a wakeup */
+	uint32_t queue_high_water;
+	/*! events waiting in the spill list now */
+	uint32_t spill_depth;
+	/*! events dropped by their overflow policy */
+	uint64_t dropped;
+	/*! events put on the spill list */
+	uint64_t spilled;
+	/*! times a producer blocked on the full queue and the microseconds it waited */
+	uint64_t blocked;
+	uint64_t blocked_us;
+	/*! events without a source id taken from the other dispatchers */
+	uint64_t stolen;
+} agc_event_dispatch_stats_t;
+
+/*
+ * Log-linear latency histogram in microseconds, four buckets per power of two:
+ * bucket i < 4 holds i, above that bucket 4 + 4 * (msb - 2) + the next two bits.
+ * Values beyond the last bucket are counted in it.
+ */
+#define EVENT_LATENCY_BUCKETS 96
+
+typedef struct agc_event_latency {
+	uint64_t count;
+	uint64_t sum_us;
+	uint64_t max_us;
+	uint64_t buckets[EVENT_LATENCY_BUCKETS];
+} agc_event_latency_t;
+
+typedef struct agc_event_priority_stats {
+	/*! events waiting in the class now, all dispatchers */
+	uint32_t depth;
+	/*! the deepest the class of one dispatcher was seen at a wakeup */
+	uint32_t high_water;
+	/*! batches which took the class first because it was starved */
+	uint64_t starved;
+	/*! fire to delivery */
+	agc_event_latency_t queue_delay;
+} agc_event_priority_stats_t;
+
+#define AGC_EVENT_SUBSCRIBER_ID_LEN 64
+
+typedef struct agc_event_subscriber_stats {
+	/*! the id given to agc_event_bind */
+	char id[AGC_EVENT_SUBSCRIBER_ID_LEN];
+	int event_id;
+	/*! time spent in the callback */
+	agc_event_latency_t callback;
+	/*! bound with agc_event_bind_async, the lane fields are zero otherwise */
+	int async;
+	/*! fire to callback, queueing in the lane included */
+	agc_event_latency_t lane_delay;
+	uint32_t lane_depth;
+	uint32_t lane_high_water;
+	uint64_t lane_queued;
+	/*! dropped by the lane's overflow policy */
+	uint64_t lane_dropped;
+	/*! times a dispatcher waited for room and the microseconds it waited */
+	uint64_t lane_blocked;
+	uint64_t lane_blocked_us;
+} agc_event_subscriber_stats_t;
+
+/* what happens to an event fired at a full dispatch queue */
+typedef enum {
+	/*! wait for room, agc_event_try_fire returns AGC_STATUS_BREAK instead */
+	EVENT_OVERFLOW_BLOCK,
+	/*! drop the event fired */
+	EVENT_OVERFLOW_DROP_NEWEST,
+	/*! drop the oldest queued event of the same id and source to make room, sourceless events drop the newest, callback events are kept */
+	EVENT_OVERFLOW_DROP_OLDEST,
+	/*! keep it on an unbounded (up to event_spill_limit) list behind the queue, order is kept */
+	EVENT_OVERFLOW_SPILL
+} agc_event_overflow_t;
+
+/* the classes of a dispatcher, each has its own queue and share of the batch */
+typedef enum {
+	/*! control traffic, the largest share */
+	EVENT_PRIORITY_HIGH,
+	EVENT_PRIORITY_NORMAL,
+	/*! bulk traffic, the smallest share but never starved */
+	EVENT_PRIORITY_LOW,
+	EVENT_PRIORITY_CLASSES
+} agc_event_priority_t;
+
 typedef struct agc_event_node agc_event_node_t;
 
+/* a term of a subscription filter, an event must match every term of the filter */
+typedef enum {
+	/*! the header value is the string */
+	EVENT_FILTER_EQUALS,
+	/*! the header value starts with the string */
+	EVENT_FILTER_PREFIX,
+	/*! the header is present, the value is not used */
+	EVENT_FILTER_EXISTS,
+	/*! the header value is one of a set, the values added for the same header make one set */
+	EVENT_FILTER_IN
+} agc_event_filter_op_t;
+
+typedef struct agc_event_filter agc_event_filter_t;
+
+/* an async subscriber gets the events through its own queue and worker threads */
+typedef struct agc_event_lane_options {
+	/*! events waiting in the lane, 0 for the default */
+	uint32_t queue_size;
+	/*! worker threads, 0 for one, only one keeps the order of the events */
+	int workers;
+	/*! what a dispatcher does when the lane is full, EVENT_OVERFLOW_SPILL is not supported */
+	agc_event_overflow_t overflow;
+} agc_event_lane_options_t;
+
+/* the answer to agc_event_request, reply is NULL when it timed out */
+typedef void (*agc_event_reply_func)(agc_event_t *reply, void *data);
+
 AGC_DECLARE(agc_status_t) agc_event_init(agc_memory_pool_t *pool);
 
 AGC_DECLARE(agc_status_t) agc_event_shutdown(void);
 
-AGC_DECLARE(uint32_t) agc_event_alloc_source(const char *source_name);
+/* source ids are 64 bit and never wrap, so an id is not given out twice */
+AGC_DECLARE(uint64_t) agc_event_alloc_source(const char *source_name);
 
+/* names are matched without case, a name registered twice is found under its first id */
 AGC_DECLARE(agc_status_t) agc_event_register(int event_id, const char *event_name);
 
 AGC_DECLARE(agc_status_t) agc_event_get_id(const char *event_name, int *event_id);
 
 AGC_DECLARE(const char *) agc_event_get_name(int event_id);
 
-AGC_DECLARE(agc_status_t) agc_event_create(agc_event_t **event, int event_id, uint32_t source_id);
+AGC_DECLARE(agc_status_t) agc_event_create(agc_event_t **event, int event_id, uint64_t source_id);
 
 AGC_DECLARE(agc_status_t) agc_event_set_id(agc_event_t *event, int event_id);
 
-AGC_DECLARE(agc_status_t) agc_event_create_callback(agc_event_t **event, uint32_t source_id, void *data, agc_event_callback_func callback);
+/*
+ * the event is dropped by its dispatcher instead of delivered once deadline passed,
+ * on the agc_time_now clock. 0 clears it.
+ */
+AGC_DECLARE(agc_status_t) agc_event_set_deadline(agc_event_t *event, agc_time_t deadline);
+
+/* a deadline ttl_ms from now */
+AGC_DECLARE(agc_status_t) agc_event_set_ttl(agc_event_t *event, uint32_t ttl_ms);
+
+AGC_DECLARE(agc_status_t) agc_event_create_callback(agc_event_t **event, uint64_t source_id, void *data, agc_event_callback_func callback);
 
 AGC_DECLARE(void) agc_event_destroy(agc_event_t **event);
 
+/*
+ * take another reference to an event instead of duplicating it, the event
+ * must not be changed until the extra references are released. A subscriber
+ * keeping the event is bound with agc_event_bind_async, the sync ones after
+ * it could not change the event otherwise.
+ */
+AGC_DECLARE(agc_event_t *) agc_event_retain(agc_event_t *event);
+
+/* drop a reference, the last one frees the event (same as agc_event_destroy) */
+AGC_DECLARE(void) agc_event_release(agc_event_t **event);
+
 AGC_DECLARE(agc_status_t) agc_event_add_header(agc_event_t *event, const char *header_name, const char *fmt, ...) PRINTF_FUNCTION(3, 4);
 
 AGC_DECLARE(agc_status_t) agc_event_add_header_repeatcheck(agc_event_t *event, const char *header_name, const char *fmt, ...) PRINTF_FUNCTION(3, 4);
@@ -160,6 +370,18 @@ AGC_DECLARE(agc_status_t) agc_event_del_header(agc_event_t *event, const char *h
 
 AGC_DECLARE(const char *) agc_event_get_header(agc_event_t *event, const char *header_name);
 
+AGC_DECLARE(const char *) agc_event_get_header_atom(agc_event_t *event, uint32_t atom);
+
+/*
+ * intern a header name, returns EVENT_ATOM_NONE if the atom table is full.
+ * Only filters and agc_event_init intern, the headers of events look their names up
+ * with agc_event_atom_find, so names from the wire can not fill the table.
+ */
+AGC_DECLARE(uint32_t) agc_event_atom(const char *header_name);
+
+/* look up a header name without interning it */
+AGC_DECLARE(uint32_t) agc_event_atom_find(const char *header_name);
+
 AGC_DECLARE(agc_status_t) agc_event_add_body(agc_event_t *event, const char *fmt, ...) PRINTF_FUNCTION(2, 3);
 
 AGC_DECLARE(agc_status_t) agc_event_set_body(agc_event_t *event, const char *body);
@@ -177,16 +399,200 @@ AGC_DECLARE(agc_status_t) agc_event_bind_removable(const char *id, int event_id,
 
 AGC_DECLARE(agc_status_t) agc_event_unbind(agc_event_node_t **node);
 
+AGC_DECLARE(agc_status_t) agc_event_filter_create(agc_event_filter_t **filter);
+
+/* header names are interned once here, AGC_STATUS_GENERR if the atom table is full or the filter is bound */
+AGC_DECLARE(agc_status_t) agc_event_filter_add(agc_event_filter_t *filter, const char *header_name, agc_event_filter_op_t op, const char *value);
+
+AGC_DECLARE(agc_bool_t) agc_event_filter_match(agc_event_filter_t *filter, agc_event_t *event);
+
+AGC_DECLARE(void) agc_event_filter_destroy(agc_event_filter_t **filter);
+
+/*
+ * like agc_event_bind_removable, the callback is only called for the events matching the filter.
+ * Subscribers with an equals or in term are found through an index on that header's value,
+ * the others are tested one by one, and they are called before the indexed ones, so the callbacks
+ * of an event do not run in bind order. The node owns the filter once bound, it can not be changed,
+ * destroyed or bound again. node may be NULL.
+ */
+AGC_DECLARE(agc_status_t) agc_event_bind_filtered(const char *id, int event_id, agc_event_callback_func callback, agc_event_filter_t *filter, agc_event_node_t **node);
+
+/*
+ * like agc_event_bind_filtered (filter may be NULL), the dispatchers only queue the events for the
+ * subscriber, its workers call it, so a slow subscriber does not hold up the others.
+ * The event is shared with the lane, it is read only from then on and released after the callback.
+ * An async subscriber can not unbind itself from its own callback.
+ */
+AGC_DECLARE(agc_status_t) agc_event_bind_async(const char *id, int event_id, agc_event_callback_func callback, agc_event_filter_t *filter, const agc_event_lane_options_t *options, agc_event_node_t **node);
+
+/*
+ * Events of a source are delivered in order by one dispatcher,
+ * events with EVENT_NULL_SOURCEID by whichever dispatcher is idle first.
+ * AGC_STATUS_SUCCESS: queued.
+ * AGC_STATUS_FALSE: dropped by the overflow policy, the event is freed and *event set to NULL.
+ */
 AGC_DECLARE(agc_status_t) agc_event_fire(agc_event_t **event);
 
+/*
+ * like agc_event_fire but never waits, AGC_STATUS_BREAK means the queue is full
+ * and the policy is EVENT_OVERFLOW_BLOCK, the event still belongs to the caller.
+ */
+AGC_DECLARE(agc_status_t) agc_event_try_fire(agc_event_t **event);
+
+/*
+ * fire n events at once, the events of a dispatcher are queued together with one wakeup,
+ * the order of the events of a source is kept. Every event is taken and its entry set to NULL,
+ * NULL entries are skipped. AGC_STATUS_FALSE if the overflow policy dropped any of them.
+ */
+AGC_DECLARE(agc_status_t) agc_event_fire_batch(agc_event_t **events, int n);
+
+/*
+ * like agc_event_fire, in the given class instead of the one of its id.
+ * The order of a source is kept within a class only.
+ */
+AGC_DECLARE(agc_status_t) agc_event_fire_priority(agc_event_t **event, agc_event_priority_t priority);
+
+/*
+ * fire a request, the callback is called once: with the reply, or with NULL after timeout_ms.
+ * It runs on the dispatcher of the request's source, the reply is freed after it returns.
+ * A responder answers with agc_event_set_reply, the reply waits for room instead of being dropped
+ * by the overflow policy of its id. As agc_event_fire otherwise, AGC_STATUS_FALSE
+ * if the request was dropped, the callback is not called then.
+ * Requests still pending at shutdown time out on the thread calling agc_event_shutdown.
+ * Events decoded by agc_event_create_json and agc_event_create_binary lose their correlation
+ * headers, requests and replies stay within the process.
+ */
+AGC_DECLARE(agc_status_t) agc_event_request(agc_event_t **event, uint32_t timeout_ms, agc_event_reply_func callback, void *data);
+
+/* make reply the answer of request: the request's correlation id as EVENT_HEADER_REPLY and the requester's source */
+AGC_DECLARE(agc_status_t) agc_event_set_reply(agc_event_t *request, agc_event_t *reply);
+
+/* requests waiting for a reply, and the ones which timed out */
+AGC_DECLARE(void) agc_event_request_stats(uint32_t *pending, uint64_t *timeouts);
+
+/*
+ * merge the histograms of all dispatchers for an event id,
+ * queue_delay is fire to delivery and handle the time spent delivering, either may be NULL.
+ * AGC_STATUS_NOTFOUND if no event of the id was delivered yet.
+ */
+AGC_DECLARE(agc_status_t) agc_event_get_latency(int event_id, agc_event_latency_t *queue_delay, agc_event_latency_t *handle);
+
+/*
+ * fill up to max subscribers of event_id (EVENT_ID_ALL included) with their callback times,
+ * return the number filled.
+ */
+AGC_DECLARE(int) agc_event_get_subscriber_stats(int event_id, agc_event_subscriber_stats_t *stats, int max);
+
+/* unbound subscribers and replaced subscriber lists not freed yet, they wait for the dispatchers to pass them */
+AGC_DECLARE(uint32_t) agc_event_retired_count(void);
+
+/* the smallest value which is above percent (0 - 100) of the samples, 0 if empty */
+AGC_DECLARE(uint64_t) agc_event_latency_percentile(const agc_event_latency_t *latency, double percent);
+
+AGC_DECLARE(agc_status_t) agc_event_set_overflow_policy(int event_id, agc_event_overflow_t policy);
+
+AGC_DECLARE(agc_event_overflow_t) agc_event_get_overflow_policy(int event_id);
+
+/* the class the events of event_id are queued in, EVENT_ID_ALL sets every id */
+AGC_DECLARE(agc_status_t) agc_event_set_priority(int event_id, agc_event_priority_t priority);
+
+AGC_DECLARE(agc_event_priority_t) agc_event_get_priority(int event_id);
+
+/*
+ * the share of a batch the class gets while the others have events too, 1 - 1000.
+ * The room a class leaves goes to the others.
+ */
+AGC_DECLARE(agc_status_t) agc_event_set_priority_weight(agc_event_priority_t priority, int weight);
+
+/* the class merged over the dispatchers */
+AGC_DECLARE(agc_status_t) agc_event_get_priority_stats(agc_event_priority_t priority, agc_event_priority_stats_t *stats);
+
+/* called with the expired events of event_id before they are freed, NULL for none */
+AGC_DECLARE(agc_status_t) agc_event_set_expiry_callback(int event_id, agc_event_callback_func callback);
+
+/* the events of event_id dropped for their deadline */
+AGC_DECLARE(uint64_t) agc_event_get_expired(int event_id);
+
+AGC_DECLARE(int) agc_event_dispatcher_count(void);
+
+/* the most dispatchers agc_event_resize_dispatchers accepts, event_dispatchers_max in agc.yml */
+AGC_DECLARE(int) agc_event_dispatcher_capacity(void);
+
+/*
+ * change the number of dispatchers online, up to agc_event_dispatcher_capacity.
+ * The sources which move are drained first, every source keeps its order.
+ * Fails on a dispatch thread, which could not deliver what the resize waits for.
+ */
+AGC_DECLARE(agc_status_t) agc_event_resize_dispatchers(int count);
+
+AGC_DECLARE(agc_status_t) agc_event_get_dispatch_stats(int index, agc_event_dispatch_stats_t *stats);
+
 AGC_DECLARE(agc_status_t) agc_event_serialize_json_obj(agc_event_t *event, cJSON **json);
 
 AGC_DECLARE(agc_status_t) agc_event_serialize_json(agc_event_t *event, char **str);
 
+/* the json size of an event, exact unless values need escaping */
+AGC_DECLARE(agc_size_t) agc_event_serialize_json_size(agc_event_t *event);
+
+/*
+ * serialize into a caller buffer, len gets the length without the terminating zero.
+ * AGC_STATUS_MEMERR means the buffer is too small, len then holds the length needed.
+ */
+AGC_DECLARE(agc_status_t) agc_event_serialize_json_buf(agc_event_t *event, char *buf, agc_size_t size, agc_size_t *len);
+
+/* serialize into a malloc buffer kept by the caller, it grows when needed and is reused across calls */
+AGC_DECLARE(agc_status_t) agc_event_serialize_json_ex(agc_event_t *event, char **buf, agc_size_t *size, agc_size_t *len);
+
 AGC_DECLARE(agc_status_t) agc_event_create_json(agc_event_t **event, const char *json);
 
+/*
+ * binary wire format, all numbers in network order:
+ *   frame length(4) version(1) flags(1) header count(2) event id(4) source id(8)
+ *   per header: type(1) reserved(1) name length(2) value length(4) name value
+ *   body length(4) body, when flags has AGC_EVENT_BINARY_BODY
+ * int headers travel as 4 or 8 byte numbers, names and values carry no terminating zero.
+ * Version 1 frames, with a 4 byte source id, are still read.
+ */
+#define AGC_EVENT_BINARY_VERSION 2
+#define AGC_EVENT_BINARY_BODY 0x01
+#define AGC_EVENT_BINARY_HEAD_SIZE 20
+#define AGC_EVENT_BINARY_V1_HEAD_SIZE 16
+#define AGC_EVENT_BINARY_CONTENT_TYPE "application/x-agc-event"
+
+/* the exact size of the binary frame of an event */
+AGC_DECLARE(agc_size_t) agc_event_serialize_binary_size(agc_event_t *event);
+
+/* encode into a caller buffer, AGC_STATUS_MEMERR means it is too small and len holds the size needed */
+AGC_DECLARE(agc_status_t) agc_event_serialize_binary(agc_event_t *event, char *buf, agc_size_t size, agc_size_t *len);
+
+/* encode into a malloc buffer kept by the caller, it grows when needed and is reused across calls */
+AGC_DECLARE(agc_status_t) agc_event_serialize_binary_ex(agc_event_t *event, char **buf, agc_size_t *size, agc_size_t *len);
+
+/* decode one frame, len may be longer than the frame */
+AGC_DECLARE(agc_status_t) agc_event_create_binary(agc_event_t **event, const void *data, agc_size_t len);
+
+typedef struct agc_event_fast_stats {
+	/*! events handed out and given back, folded in from the thread caches */
+	uint64_t allocs;
+	uint64_t releases;
+	/*! events created because the pool ran out */
+	uint64_t grown;
+	/*! events freed because the pool was above its high water mark */
+	uint64_t freed;
+	/*! events which exist now */
+	uint32_t total;
+	/*! events in the shared pool now */
+	uint32_t pooled;
+	uint32_t low_water;
+	uint32_t high_water;
+} agc_event_fast_stats_t;
+
 AGC_DECLARE(agc_status_t) agc_event_fast_initial(int fast_event_type, int event_id, int capacity, const char **headers, const int *valuelengths, int headernumbers, int bodylength);
 
+AGC_DECLARE(agc_status_t) agc_event_fast_set_watermarks(int fast_event_type, int low_water, int high_water);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_stats(int fast_event_type, agc_event_fast_stats_t *stats);
+
 AGC_DECLARE(agc_status_t) agc_event_fast_alloc(agc_event_t **event, int fast_event_type);
 
 AGC_DECLARE(agc_status_t) agc_event_fast_create_callback(agc_event_t **event, void *data, agc_event_callback_func callback);
@@ -197,6 +603,18 @@ AGC_DECLARE(agc_status_t) agc_event_fast_set_intheader(agc_event_t *event, int i
 
 AGC_DECLARE(agc_status_t) agc_event_fast_set_uintheader(agc_event_t *event, int index, const char *name, uint32_t value);
 
+AGC_DECLARE(agc_status_t) agc_event_fast_set_int64header(agc_event_t *event, int index, const char *name, int64_t value);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_set_bytesheader(agc_event_t *event, int index, const char *name, const void *data, int len);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_intheader(agc_event_t *event, int index, int32_t *value);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_uintheader(agc_event_t *event, int index, uint32_t *value);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_int64header(agc_event_t *event, int index, int64_t *value);
+
+AGC_DECLARE(agc_status_t) agc_event_fast_get_bytesheader(agc_event_t *event, int index, const void **data, int *len);
+
 AGC_DECLARE(agc_status_t) agc_event_fast_set_body(agc_event_t *event, const char *body, int len);
 
 AGC_DECLARE(agc_status_t) agc_event_fast_get_type(agc_event_t *event, int *type);
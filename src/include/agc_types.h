@@ -101,7 +101,14 @@ typedef enum {
 	AGC_TRUE = 1
 } agc_bool_t;
 
-typedef struct apr_queue_t agc_queue_t;
+typedef struct agc_queue agc_queue_t;
+
+typedef enum {
+	/*! apr-util queue, one mutex and two conditions */
+	AGC_QUEUE_APR,
+	/*! lock-free bounded ring, capacity rounded up to a power of two */
+	AGC_QUEUE_RING
+} agc_queue_type_t;
 
 typedef struct apr_file_t agc_file_t;
 typedef int32_t agc_fileperms_t;
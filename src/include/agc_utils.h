@@ -9,6 +9,26 @@ AGC_BEGIN_EXTERN_C
 
 #define agc_yield(ms) agc_sleep(ms);
 
+/* full memory barrier, orders the store of a wait flag against the following load */
+#define agc_memory_barrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+/* hint to the cpu that we are in a busy-wait loop */
+#if defined(__i386__) || defined(__x86_64__)
+#define agc_cpu_relax() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__)
+#define agc_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define agc_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#define AGC_CACHELINE_SIZE 64
+
+/* lock-free helpers, acquire on load, release on store, full barrier on read-modify-write */
+#define agc_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define agc_store_release(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define agc_fetch_add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define agc_cas(p, expectedp, v) __atomic_compare_exchange_n((p), (expectedp), (v), 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)
+
 #define agc_str_nil(s) (s ? s : "")
 
 /* https://code.google.com/p/stringencoders/wiki/PerformanceAscii 
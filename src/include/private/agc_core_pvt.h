@@ -36,9 +36,30 @@ struct agc_runtime {
 	char *odbc_dsn;
 	int max_db_handles;
 	int db_handle_timeout;
+	char *event_wait_mode;
+	char *event_queue_type;
+	int event_spin_count;
+	int event_batch_size;
+	int event_fast_cache_size;
+	int event_fast_low_water;
+	int event_fast_high_water;
+	int event_json_max_size;
+	char *event_overflow_policy;
+	/*! batch shares of the high, normal and low classes, like 8,4,1 */
+	char *event_priority_weights;
+	int event_spill_limit;
+	int event_dispatchers;
+	int event_dispatchers_max;
+	/*! cpu and numa node lists per thread role, like 0-3,8 */
+	char *thread_cpus[AGC_THREAD_ROLE_MAX];
+	char *thread_nodes[AGC_THREAD_ROLE_MAX];
 	FILE *console;
 };
 
 extern struct agc_runtime runtime;
 
 agc_memory_pool_t *agc_core_memory_init(void);
+
+void agc_core_memory_place(void);
+
+agc_status_t agc_core_thread_place_id(pthread_t tid, agc_thread_role_t role, int index);
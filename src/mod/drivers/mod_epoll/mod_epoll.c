@@ -275,6 +275,8 @@ static void *agc_epoll_dispatch_event(agc_thread_t *thread, void *obj)
 			break;
 		}
 	}
+
+	agc_core_thread_place(AGC_THREAD_EPOLL, my_id);
     
 	agc_mutex_lock(EPOLLSTATE_MUTEX);
 	EPOLL_DISPATCH_THREAD_RUNNING[my_id] = 1;
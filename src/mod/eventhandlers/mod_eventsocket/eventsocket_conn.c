@@ -143,23 +143,32 @@ agc_status_t read_packet(event_connect_t *conn, agc_event_t **event)
 			if (conn->has_event) {
 				while (agc_queue_trypop(conn->event_queue, &pop) == AGC_STATUS_SUCCESS) {
 					char hbuf[512];
+					agc_status_t encoded;
 					agc_event_t *pevent = (agc_event_t *) pop;
             
 					do_sleep = 0;
             
-					agc_event_serialize_json(pevent, &conn->ebuf);
-            
-					assert(conn->ebuf);
-					len = strlen(conn->ebuf);
+					// the buffer is kept for the next event
+					if (conn->format == EVTSKT_FORMAT_BINARY) {
+						encoded = agc_event_serialize_binary_ex(pevent, &conn->ebuf, &conn->ebuf_size, &len);
+					} else {
+						encoded = agc_event_serialize_json_ex(pevent, &conn->ebuf, &conn->ebuf_size, &len);
+					}
 
-					agc_snprintf(hbuf, sizeof(hbuf), "Content-Length: %d\n" "Content-Type: text/event-json\n" "\n", len);
+					if (encoded != AGC_STATUS_SUCCESS) {
+						agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Serialize event failed.\n");
+						agc_event_release(&pevent);
+						continue;
+					}
+
+					agc_snprintf(hbuf, sizeof(hbuf), "Content-Length: %d\n" "Content-Type: %s\n" "\n", len, 
+								conn->format == EVTSKT_FORMAT_BINARY ? AGC_EVENT_BINARY_CONTENT_TYPE : EVTSKT_JSON_CONTENT_TYPE);
 					hlen = strlen(hbuf);
 
 					agc_socket_send(conn->sock, hbuf, &hlen);
 					agc_socket_send(conn->sock, conn->ebuf, &len);
 
-					agc_safe_free(conn->ebuf);
-					agc_event_destroy(&pevent);
+					agc_event_release(&pevent);
 				}
 			}
 		}
@@ -243,6 +252,7 @@ agc_status_t parse_command(event_connect_t *conn, agc_event_t **event, char *rep
         
 		strip_cr(cmd);
 		cur = cmd + 5;
+		conn->format = EVTSKT_FORMAT_JSON;
         
 		if (cur && (cur = strchr(cur, ' '))) {
 			for (cur++; cur; count++) {
@@ -251,8 +261,13 @@ agc_status_t parse_command(event_connect_t *conn, agc_event_t **event, char *rep
 				if ((next = strchr(cur, ' '))) {
 					*next++ = '\0';
 				}
-                
-				if (agc_event_get_id(cur, &event_id) == AGC_STATUS_SUCCESS) {
+
+				// event [json|binary] <events>
+				if (!count && !strcasecmp(cur, "binary")) {
+					conn->format = EVTSKT_FORMAT_BINARY;
+				} else if (!count && !strcasecmp(cur, "json")) {
+					conn->format = EVTSKT_FORMAT_JSON;
+				} else if (agc_event_get_id(cur, &event_id) == AGC_STATUS_SUCCESS) {
 					key_count++;
 					if (event_id == EVENT_ID_ALL) {
 						for (x = 0; x < EVENT_ID_LIMIT; x++) {
@@ -39,6 +39,9 @@ static void kill_connections(void);
 
 AGC_MODULE_LOAD_FUNCTION(mod_eventsocket_load)
 {
+    // the clients keep the events, they are taken on a lane once the sync subscribers are done with them
+    agc_event_lane_options_t lane = { 0, 1, EVENT_OVERFLOW_BLOCK };
+
     assert(pool);
     module_pool = pool;
     
@@ -52,7 +55,7 @@ AGC_MODULE_LOAD_FUNCTION(mod_eventsocket_load)
     agc_mutex_init(&listener.sock_mutex, AGC_MUTEX_NESTED, module_pool);
     agc_mutex_init(&profile.mutex, AGC_MUTEX_NESTED, module_pool);
     
-    if (agc_event_bind_removable("eventsocket", EVENT_ID_ALL, handle_event, &subscribe) != AGC_STATUS_SUCCESS) {
+    if (agc_event_bind_async("eventsocket", EVENT_ID_ALL, handle_event, NULL, &lane, &subscribe) != AGC_STATUS_SUCCESS) {
          agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "%s subscribe event failed.\n", modname);
          return AGC_STATUS_GENERR;
     }
@@ -290,6 +293,7 @@ static void release_connection(event_connect_t **conn)
 
 	agc_thread_rwlock_destroy(l_conn->rwlock);
 	agc_queue_term(l_conn->event_queue);
+	agc_safe_free(l_conn->ebuf);
 
 	if (l_conn->pool)
 		agc_memory_destroy_pool(&l_conn->pool);
@@ -430,7 +434,7 @@ static void remove_conn(event_connect_t *conn)
 static void handle_event(void *data)
 {
 	agc_event_t *event = (agc_event_t *)data;
-	agc_event_t *clone = NULL;
+	agc_event_t *shared = NULL;
 	event_connect_t *c, *cp, *last = NULL;
     
 	assert(event != NULL);
@@ -447,11 +451,11 @@ static void handle_event(void *data)
 		cp = cp->next;
         
 		if (c->has_event && c->event_list[event->event_id]) {
-			if (agc_event_dup(&clone, event) == AGC_STATUS_SUCCESS) {
-				if (agc_queue_trypush(c->event_queue, clone) != AGC_STATUS_SUCCESS) {
-					agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Send event failed.\n");
-					agc_event_destroy(&clone);
-				}
+			// every client shares the event, the last one to send it frees it
+			shared = agc_event_retain(event);
+			if (agc_queue_trypush(c->event_queue, shared) != AGC_STATUS_SUCCESS) {
+				agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Send event failed.\n");
+				agc_event_release(&shared);
 			}
 		}
 	}
@@ -6,6 +6,12 @@
 
 #define EVTSKT_BLOCK_LEN 2048
 #define EVTSKT_MAX_LEN 10485760
+#define EVTSKT_JSON_CONTENT_TYPE "text/event-json"
+
+typedef enum {
+	EVTSKT_FORMAT_JSON,
+	EVTSKT_FORMAT_BINARY
+} evtskt_format_t;
 
 typedef struct event_connect_s event_connect_t;
 
@@ -23,6 +29,9 @@ struct event_connect_s {
 	uint8_t has_event;
 	uint8_t is_running;
 	char *ebuf;
+	agc_size_t ebuf_size;
+	/*! how events are sent, chosen by the event command */
+	uint8_t format;
 	uint8_t event_list[EVENT_ID_LIMIT];
 	event_connect_t *next;
 };
@@ -10,6 +10,12 @@ static void handle_event(void *data);
 
 static void make_routingkey(char *routingKey, int keylen, agc_event_t *evt);
 
+static char *encode_event(agc_event_t *event, agc_bool_t binary, char *buf, agc_size_t *len);
+
+static void lane_options(agc_event_lane_options_t *lane);
+
+static void producer_dropped(agcmq_producer_profile_t *producer, int event_id, const char *reason);
+
 AGC_STANDARD_API(agcmq_load)
 {
 	return agcmq_load_config();
@@ -17,6 +23,8 @@ AGC_STANDARD_API(agcmq_load)
 
 AGC_MODULE_LOAD_FUNCTION(mod_rabbitmq_load)
 {
+	// serializing for the producers runs on its own lane, set by their profiles
+	agc_event_lane_options_t lane;
 	
 	memset(&agcmq_global, 0, sizeof(agcmq_global));
 	agcmq_global.pool = pool;
@@ -34,7 +42,8 @@ AGC_MODULE_LOAD_FUNCTION(mod_rabbitmq_load)
 
 	agc_api_register("agcmq", "agcmq API", "syntax", agcmq_load);
 
-	if (agc_event_bind_removable("agcmq", EVENT_ID_ALL, handle_event, &mq_subscribe) != AGC_STATUS_SUCCESS) {
+	lane_options(&lane);
+	if (agc_event_bind_async("agcmq", EVENT_ID_ALL, handle_event, NULL, &lane, &mq_subscribe) != AGC_STATUS_SUCCESS) {
 		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "%s subscribe event failed.\n", modname);
 		return AGC_STATUS_GENERR;
 	}
@@ -54,6 +63,9 @@ AGC_MODULE_SHUTDOWN_FUNCTION(mod_rabbitmq_shutdown)
 
 	agc_event_unbind(&mq_subscribe);
 	for (producer = agcmq_global.producers; producer; producer = producer->next) {
+		if (producer->dropped) {
+			agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Producer[%s] dropped %u events.\n", producer->name, producer->dropped);
+		}
 		destroy_producer = producer;
 		agcmq_producer_destroy(&destroy_producer);
 	}
@@ -90,6 +102,10 @@ static void handle_event(void *data)
 	agcmq_conn_parameter_t *para;
 	agc_time_t now = agc_timer_curtime();
 	const char *routing_header = NULL;
+	char buf[2][MQ_PAYLOAD_BUF_LEN];
+	char *payload[2] = { NULL, NULL };
+	agc_size_t payload_len[2] = { 0, 0 };
+	int fmt;
 
 	if (!event)
 		return;
@@ -105,7 +121,7 @@ static void handle_event(void *data)
 		para = producer->conn_parameter;
 
 		if (now < producer->reset_time) {
-			agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Producer[%s] reset wait.\n", producer->name);
+			producer_dropped(producer, event->event_id, "reset wait");
 			continue;
 		}
 
@@ -114,10 +130,22 @@ static void handle_event(void *data)
 			msg = malloc(sizeof(agcmq_message_t));
 			if (!msg) {
 				agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Alloc memory failed.\n");
-				return;
+				break;
+			}
+
+			// serialize once per format for all producers
+			fmt = producer->binary ? 1 : 0;
+			if (!payload[fmt]) {
+				payload[fmt] = encode_event(event, producer->binary, buf[fmt], &payload_len[fmt]);
 			}
 
-			agc_event_serialize_json(event, &msg->pjson);
+			if (!payload[fmt] || !(msg->payload = malloc(payload_len[fmt] + 1))) {
+				agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Serialize event failed.\n");
+				free(msg);
+				break;
+			}
+			memcpy(msg->payload, payload[fmt], payload_len[fmt] + 1);
+			msg->len = payload_len[fmt];
 			if ((routing_header = agc_event_get_header(event, EVENT_HEADER_ROUTING))) {
 				agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "Producer[%s] custom routingkey[%s] found.\n", producer->name, routing_header);
 				strcpy(msg->routing_key, routing_header);
@@ -126,12 +154,108 @@ static void handle_event(void *data)
 			}
 			if (agc_queue_trypush(producer->send_queue, msg) != AGC_STATUS_SUCCESS) {
 				producer->reset_time = now + para->circuit_breaker_ms * 1000;
-				agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Message queue full.\n");
+				producer_dropped(producer, event->event_id, "message queue full");
 				agcmq_producer_msg_destroy(&msg);
 			}
 		}
 	}
 
+	for (fmt = 0; fmt < 2; fmt++) {
+		if (payload[fmt] != buf[fmt]) {
+			agc_safe_free(payload[fmt]);
+		}
+	}
+}
+
+/*
+ * the producers share one lane, it takes the largest size and worker count of their profiles.
+ * A full lane blocks the dispatchers unless all the producers agree to drop.
+ */
+static void lane_options(agc_event_lane_options_t *lane)
+{
+	agcmq_producer_profile_t *producer;
+	agcmq_conn_parameter_t *para;
+	agc_event_overflow_t overflow;
+
+	lane->queue_size = 0;
+	lane->workers = 1;
+	lane->overflow = EVENT_OVERFLOW_BLOCK;
+
+	for (producer = agcmq_global.producers; producer; producer = producer->next) {
+		para = producer->conn_parameter;
+
+		if (para->lane_size > lane->queue_size) {
+			lane->queue_size = para->lane_size;
+		}
+
+		if ((int) para->lane_workers > lane->workers) {
+			lane->workers = para->lane_workers;
+		}
+
+		overflow = EVENT_OVERFLOW_BLOCK;
+		if (para->lane_overflow && !strcasecmp(para->lane_overflow, "drop_newest")) {
+			overflow = EVENT_OVERFLOW_DROP_NEWEST;
+		} else if (para->lane_overflow && !strcasecmp(para->lane_overflow, "drop_oldest")) {
+			overflow = EVENT_OVERFLOW_DROP_OLDEST;
+		} else if (para->lane_overflow && strcasecmp(para->lane_overflow, "block")) {
+			agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Producer[%s] unknown lane_overflow %s, block.\n", producer->name, para->lane_overflow);
+		}
+
+		if (producer == agcmq_global.producers) {
+			lane->overflow = overflow;
+		} else if (overflow != lane->overflow) {
+			agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "Producer[%s] lane_overflow differs from the others, block.\n", producer->name);
+			lane->overflow = EVENT_OVERFLOW_BLOCK;
+		}
+	}
+
+	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "Mq lane size %u workers %d overflow %d.\n", lane->queue_size, lane->workers, lane->overflow);
+}
+
+/* the first drop and then every power of two is logged, a broker gone away would flood the log */
+static void producer_dropped(agcmq_producer_profile_t *producer, int event_id, const char *reason)
+{
+	uint32_t dropped;
+
+	if (!producer->event_list[event_id]) {
+		return;
+	}
+
+	dropped = agc_fetch_add(&producer->dropped, 1) + 1;
+	if (!(dropped & (dropped - 1))) {
+		agc_log_printf(AGC_LOG, AGC_LOG_ERROR, "Producer[%s] %s, %u events dropped.\n", producer->name, reason, dropped);
+	}
+}
+
+/* encode on the stack unless the event is big, the payload keeps a terminating zero */
+static char *encode_event(agc_event_t *event, agc_bool_t binary, char *buf, agc_size_t *len)
+{
+	char *data = NULL;
+	agc_size_t size = 0;
+
+	if (binary) {
+		if (agc_event_serialize_binary(event, buf, MQ_PAYLOAD_BUF_LEN - 1, len) == AGC_STATUS_SUCCESS) {
+			buf[*len] = '\0';
+			return buf;
+		}
+
+		if (agc_event_serialize_binary_ex(event, &data, &size, len) != AGC_STATUS_SUCCESS || !(buf = realloc(data, *len + 1))) {
+			agc_safe_free(data);
+			return NULL;
+		}
+		buf[*len] = '\0';
+		return buf;
+	}
+
+	if (agc_event_serialize_json_buf(event, buf, MQ_PAYLOAD_BUF_LEN, len) == AGC_STATUS_SUCCESS) {
+		return buf;
+	}
+
+	if (agc_event_serialize_json_ex(event, &data, &size, len) != AGC_STATUS_SUCCESS) {
+		agc_safe_free(data);
+		return NULL;
+	}
+	return data;
 }
 
 static void make_routingkey(char *routingKey, int keylen, agc_event_t *evt)
@@ -8,10 +8,12 @@
 
 #define MAX_MQ_ROUTING_KEY_LENGTH 255
 #define MQ_DEFAULT_CONTENT_TYPE "text/json"
+#define MQ_PAYLOAD_BUF_LEN 4096
 
 typedef struct {
     char routing_key[MAX_MQ_ROUTING_KEY_LENGTH];
-    char *pjson;
+    char *payload;
+    agc_size_t len;
 } agcmq_message_t;
 
 typedef struct agcmq_connection_info_s agcmq_connection_info_t;
@@ -47,6 +49,11 @@ struct agcmq_conn_parameter_s {
 	char *event_filter;
 	unsigned int delivery_mode;
 	unsigned int delivery_timestamp;
+	char *content_type;
+	/*! the event lane of the producers, its size, workers and block, drop_newest or drop_oldest when full */
+	unsigned int lane_size;
+	unsigned int lane_workers;
+	char *lane_overflow;
 };
 
 typedef struct agcmq_producer_profile_s agcmq_producer_profile_t;
@@ -63,8 +70,13 @@ struct agcmq_producer_profile_s {
 
 	agc_time_t reset_time;
 
+	/*! events are sent as AGC_EVENT_BINARY_CONTENT_TYPE instead of json */
+	agc_bool_t binary;
+
 	agc_queue_t *send_queue;
 	uint8_t event_list[EVENT_ID_LIMIT];
+	/*! events it subscribed to and did not send, its queue was full or it waited to reset */
+	volatile uint32_t dropped;
 	agcmq_producer_profile_t *next;
 };
 
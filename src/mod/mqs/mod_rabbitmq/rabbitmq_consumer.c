@@ -177,7 +177,8 @@ void *agcmq_consumer_thread(agc_thread_t *thread, void *data)
 			enum ECommandFormat {
 				COMMAND_FORMAT_UNKNOWN,
 				COMMAND_FORMAT_PLAINTEXT,
-				COMMAND_FORMAT_JSONTEXT
+				COMMAND_FORMAT_JSONTEXT,
+				COMMAND_FORMAT_BINARY
 			} cmdfmt = COMMAND_FORMAT_PLAINTEXT;
 
 			amqp_maybe_release_buffers(consumer->mq_conn->state);
@@ -218,6 +219,8 @@ void *agcmq_consumer_thread(agc_thread_t *thread, void *data)
 					cmdfmt = COMMAND_FORMAT_PLAINTEXT;
 				} else if (strncasecmp(MQ_DEFAULT_CONTENT_TYPE, envelope.message.properties.content_type.bytes, strlen(MQ_DEFAULT_CONTENT_TYPE)) == 0) {
 					cmdfmt = COMMAND_FORMAT_JSONTEXT;
+				} else if (strncasecmp(AGC_EVENT_BINARY_CONTENT_TYPE, envelope.message.properties.content_type.bytes, strlen(AGC_EVENT_BINARY_CONTENT_TYPE)) == 0) {
+					cmdfmt = COMMAND_FORMAT_BINARY;
 				} else {
 					cmdfmt = COMMAND_FORMAT_UNKNOWN;
 				}
@@ -239,6 +242,14 @@ void *agcmq_consumer_thread(agc_thread_t *thread, void *data)
 				}
 			}
 
+			if (cmdfmt == COMMAND_FORMAT_BINARY) {
+				agc_event_t *event = NULL;
+				if (agc_event_create_binary(&event, envelope.message.body.bytes, envelope.message.body.len) == AGC_STATUS_SUCCESS) {
+					agc_log_printf(AGC_LOG, AGC_LOG_DEBUG, "Consumer[%s] fire event %d.\n", consumer->name, event->event_id);
+					agc_event_fire(&event);
+				}
+			}
+
 			amqp_destroy_envelope(&envelope);
 		}
 
@@ -7,7 +7,7 @@ static void add_producer(agcmq_producer_profile_t *producer);
 void agcmq_producer_msg_destroy(agcmq_message_t **msg)
 {
 	if (!msg || !*msg) return;
-	agc_safe_free((*msg)->pjson);
+	agc_safe_free((*msg)->payload);
 	agc_safe_free(*msg);
 }
 
@@ -31,6 +31,7 @@ agc_status_t agcmq_producer_create(char *name, agcmq_connection_info_t *conn_inf
 	producer->conn_parameter = parameters;
 	producer->pool = pool;
 	producer->running = 1;
+	producer->binary = parameters->content_type && !strcasecmp(parameters->content_type, AGC_EVENT_BINARY_CONTENT_TYPE);
 
 	new_conn = agc_memory_alloc(producer->pool, sizeof(*new_conn));
 	assert(new_conn);
@@ -196,6 +197,7 @@ agc_status_t agcmq_producer_send(agcmq_producer_profile_t *producer, agcmq_messa
 	agcmq_conn_parameter_t *para;
 	amqp_table_entry_t messageTableEntries[1];
 	amqp_basic_properties_t props;
+	amqp_bytes_t body;
 	int status;
 	
 	if (!agcmq_is_conn_active(producer->mq_conn)) {
@@ -206,9 +208,11 @@ agc_status_t agcmq_producer_send(agcmq_producer_profile_t *producer, agcmq_messa
 	para = producer->conn_parameter;
 
 	memset(&props, 0, sizeof(amqp_basic_properties_t));
+	body.len = msg->len;
+	body.bytes = msg->payload;
 
 	props._flags |= AMQP_BASIC_CONTENT_TYPE_FLAG;
-	props.content_type = amqp_cstring_bytes(MQ_DEFAULT_CONTENT_TYPE);
+	props.content_type = amqp_cstring_bytes(producer->binary ? AGC_EVENT_BINARY_CONTENT_TYPE : MQ_DEFAULT_CONTENT_TYPE);
 
 	if(para->delivery_mode > 0) {
 		props._flags |= AMQP_BASIC_DELIVERY_MODE_FLAG;
@@ -232,7 +236,7 @@ agc_status_t agcmq_producer_send(agcmq_producer_profile_t *producer, agcmq_messa
 								0,
 								0,
 								&props,
-								amqp_cstring_bytes(msg->pjson));
+								body);
 
 	if (status < 0) {
 		const char *errstr = amqp_error_string2(-status);
@@ -325,6 +325,18 @@ static agc_status_t agcmq_load_profile(const char *filename,
 						} else if (strcmp(token.data.scalar.value, "delivery_timestamp") == 0) {
 							keytype = KEY_INT;
 							intvalue = &para->delivery_timestamp;
+						} else if (strcmp(token.data.scalar.value, "content_type") == 0) {
+							keytype = KEY_STR;
+							strvalue = &para->content_type;
+						} else if (strcmp(token.data.scalar.value, "lane_size") == 0) {
+							keytype = KEY_INT;
+							intvalue = &para->lane_size;
+						} else if (strcmp(token.data.scalar.value, "lane_workers") == 0) {
+							keytype = KEY_INT;
+							intvalue = &para->lane_workers;
+						} else if (strcmp(token.data.scalar.value, "lane_overflow") == 0) {
+							keytype = KEY_STR;
+							strvalue = &para->lane_overflow;
 						} else {
 							keytype = KEY_UNKOWN;
 							agc_log_printf(AGC_LOG, AGC_LOG_WARNING, "unknown key %s found.\n", token.data.scalar.value);
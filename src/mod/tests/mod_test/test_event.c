@@ -9,7 +9,7 @@ typedef struct test_event_command {
 } test_event_command_t;
 
 #define TEST_SOURCE_NAME "test"
-static uint32_t g_source_id = 0;
+static uint64_t g_source_id = 0;
 static int g_event_id = 21;
 #define TEST_EVENT_NAME "test_event"
 #define TEST_HEADER_NAME "theader"
@@ -37,11 +37,46 @@ static agc_status_t test_add_body(agc_stream_handle_t *stream);
 static agc_status_t test_set_body(agc_stream_handle_t *stream);
 static agc_status_t test_get_body(agc_stream_handle_t *stream);
 static agc_status_t test_dup(agc_stream_handle_t *stream);
+static agc_status_t test_retain(agc_stream_handle_t *stream);
 static agc_status_t test_bind(agc_stream_handle_t *stream);
 static agc_status_t test_unbind(agc_stream_handle_t *stream);
 static agc_status_t test_bindremove(agc_stream_handle_t *stream);
 static agc_status_t test_unbindremove(agc_stream_handle_t *stream);
 static agc_status_t test_json(agc_stream_handle_t *stream);
+static agc_status_t test_create_json(agc_stream_handle_t *stream);
+static agc_status_t test_try_fire(agc_stream_handle_t *stream);
+static agc_status_t test_bind_filtered(agc_stream_handle_t *stream);
+static agc_status_t test_fire_batch(agc_stream_handle_t *stream);
+static agc_status_t test_bind_async(agc_stream_handle_t *stream);
+static agc_status_t test_request(agc_stream_handle_t *stream);
+static agc_status_t test_deadline(agc_stream_handle_t *stream);
+static agc_status_t test_priority(agc_stream_handle_t *stream);
+static agc_status_t test_replace_typed(agc_stream_handle_t *stream);
+static agc_status_t test_resize(agc_stream_handle_t *stream);
+static agc_status_t test_drop_newest(agc_stream_handle_t *stream);
+static agc_status_t test_drop_oldest(agc_stream_handle_t *stream);
+static agc_status_t test_spill(agc_stream_handle_t *stream);
+static agc_status_t test_spill_priority(agc_stream_handle_t *stream);
+static agc_status_t test_request_ingress(agc_stream_handle_t *stream);
+static agc_status_t test_binary(agc_stream_handle_t *stream);
+static agc_status_t test_lane_stop(agc_stream_handle_t *stream);
+static agc_status_t test_steal(agc_stream_handle_t *stream);
+static agc_status_t test_register_names(agc_stream_handle_t *stream);
+static agc_status_t test_atom_intern(agc_stream_handle_t *stream);
+static agc_status_t test_replace_reuse(agc_stream_handle_t *stream);
+static agc_status_t test_wakeup(agc_stream_handle_t *stream);
+static agc_status_t test_ring_queue(agc_stream_handle_t *stream);
+static agc_status_t test_batch_drain(agc_stream_handle_t *stream);
+static agc_status_t test_fast_pool(agc_stream_handle_t *stream);
+static agc_status_t test_json_writer(agc_stream_handle_t *stream);
+static agc_status_t test_latency(agc_stream_handle_t *stream);
+static agc_status_t test_source_ids(agc_stream_handle_t *stream);
+static agc_status_t test_binary_versions(agc_stream_handle_t *stream);
+static agc_status_t test_request_pressure(agc_stream_handle_t *stream);
+static agc_status_t test_drop_oldest_others(agc_stream_handle_t *stream);
+static agc_status_t test_lane_keep(agc_stream_handle_t *stream);
+static agc_status_t test_lane_block_stop(agc_stream_handle_t *stream);
+static agc_status_t test_bind_churn(agc_stream_handle_t *stream);
 
 
 test_event_command_t event_commands[] = {
@@ -59,11 +94,46 @@ test_event_command_t event_commands[] = {
 	{"test_set_body", test_set_body},
 	{"test_get_body", test_get_body},
 	{"test_dup", test_dup},
+	{"test_retain", test_retain},
 	{"test_bind", test_bind},
 	{"test_unbind", test_unbind},
 	{"test_bindremove", test_bindremove},
 	{"test_unbindremove", test_unbindremove},
-	{"test_json", test_json}
+	{"test_json", test_json},
+	{"test_create_json", test_create_json},
+	{"test_try_fire", test_try_fire},
+	{"test_bind_filtered", test_bind_filtered},
+	{"test_fire_batch", test_fire_batch},
+	{"test_bind_async", test_bind_async},
+	{"test_request", test_request},
+	{"test_deadline", test_deadline},
+	{"test_priority", test_priority},
+	{"test_replace_typed", test_replace_typed},
+	{"test_resize", test_resize},
+	{"test_drop_newest", test_drop_newest},
+	{"test_drop_oldest", test_drop_oldest},
+	{"test_spill", test_spill},
+	{"test_spill_priority", test_spill_priority},
+	{"test_request_ingress", test_request_ingress},
+	{"test_binary", test_binary},
+	{"test_lane_stop", test_lane_stop},
+	{"test_steal", test_steal},
+	{"test_register_names", test_register_names},
+	{"test_atom_intern", test_atom_intern},
+	{"test_replace_reuse", test_replace_reuse},
+	{"test_wakeup", test_wakeup},
+	{"test_ring_queue", test_ring_queue},
+	{"test_batch_drain", test_batch_drain},
+	{"test_fast_pool", test_fast_pool},
+	{"test_json_writer", test_json_writer},
+	{"test_latency", test_latency},
+	{"test_source_ids", test_source_ids},
+	{"test_binary_versions", test_binary_versions},
+	{"test_request_pressure", test_request_pressure},
+	{"test_drop_oldest_others", test_drop_oldest_others},
+	{"test_lane_keep", test_lane_keep},
+	{"test_lane_block_stop", test_lane_block_stop},
+	{"test_bind_churn", test_bind_churn}
 };
 
 #define TEST_EVENTCMD_SIZE (sizeof(event_commands)/sizeof(event_commands[0]))
@@ -391,6 +461,39 @@ static agc_status_t test_dup(agc_stream_handle_t *stream)
 	return status;
 }
 
+static agc_status_t test_retain(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_t *shared = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) ||! new_event) {
+		stream->write_function(stream, "test agc_event_retain [fail].\n");
+		return status;
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+	shared = agc_event_retain(new_event);
+
+	// a shared event is read only, dropping one holder keeps it alive
+	if ((shared == new_event) && (agc_event_add_header_string(shared, TEST_HEADER_NAME, TEST_HEADER_VALUE) != AGC_STATUS_SUCCESS)) {
+		agc_event_release(&shared);
+		if (!shared && new_event->refs == 1 && !strcmp(agc_event_get_header(new_event, TEST_HEADER_NAME), TEST_HEADER_VALUE)) {
+			status = AGC_STATUS_SUCCESS;
+		}
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_retain [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_retain [fail].\n");
+	}
+
+	agc_event_release(&new_event);
+
+	return status;
+}
+
 static agc_status_t test_bind(agc_stream_handle_t *stream)
 {
 	agc_event_t *new_event = NULL;
@@ -514,6 +617,70 @@ static agc_status_t test_json(agc_stream_handle_t *stream)
 	return AGC_STATUS_SUCCESS;	
 }
 
+static agc_status_t test_create_json(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_t *parsed = NULL;
+	char *result = NULL;
+	const char *header = NULL;
+	const char *body = NULL;
+	const char *bad[] = {"{\"_id\":\"-1\"}", "{\"a\":\"b\",\"_id\":\"1\"", "{\"_id\":\"1\",}", "{\"_id\":\"1\"} x",
+		"{\"_id\":\"1\",\"a\":[1,]}", "{\"_id\":\"1\",\"a\":[,1]}", "{\"_id\":\"1\",\"a\":{\"b\":}}"};
+	int i;
+	agc_status_t status = AGC_STATUS_FALSE;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) ||! new_event) {
+		stream->write_function(stream, "test agc_event_create_json create event [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, "quoted \"value\"\n");
+	agc_event_set_body(new_event, "some thing");
+	agc_event_serialize_json(new_event, &result);
+
+	if (result && (agc_event_create_json(&parsed, result) == AGC_STATUS_SUCCESS) && (parsed->event_id == g_event_id)) {
+		header = agc_event_get_header(parsed, TEST_HEADER_NAME);
+		body = agc_event_get_body(parsed);
+		if (header && body && !strcmp(header, "quoted \"value\"\n") && !strcmp(body, "some thing")) {
+			status = AGC_STATUS_SUCCESS;
+		}
+	}
+
+	agc_safe_free(result);
+	agc_event_destroy(&new_event);
+	agc_event_destroy(&parsed);
+
+	// nested values are skipped, white space around the object is fine
+	if ((status == AGC_STATUS_SUCCESS) && (agc_event_create_json(&parsed, " {\"_id\":\"1\",\"a\":[1,{\"b\":null},[]],\"c\":{}} \n") != AGC_STATUS_SUCCESS)) {
+		status = AGC_STATUS_FALSE;
+	}
+	agc_event_destroy(&parsed);
+
+	// a repeated key keeps the last value in one header
+	if ((status == AGC_STATUS_SUCCESS) && ((agc_event_create_json(&parsed, "{\"_id\":\"1\",\"" TEST_HEADER_NAME "\":\"a\",\"" TEST_HEADER_NAME "\":\"b\"}") != AGC_STATUS_SUCCESS) ||
+		!(header = agc_event_get_header(parsed, TEST_HEADER_NAME)) || strcmp(header, "b") ||
+		(agc_event_del_header(parsed, TEST_HEADER_NAME) != AGC_STATUS_SUCCESS) || agc_event_get_header(parsed, TEST_HEADER_NAME))) {
+		status = AGC_STATUS_FALSE;
+	}
+	agc_event_destroy(&parsed);
+
+	// malformed input, trailing commas, trailing garbage and bad ids are rejected
+	for (i = 0; (status == AGC_STATUS_SUCCESS) && (i < sizeof(bad) / sizeof(bad[0])); i++) {
+		if (agc_event_create_json(&parsed, bad[i]) == AGC_STATUS_SUCCESS) {
+			agc_event_destroy(&parsed);
+			status = AGC_STATUS_FALSE;
+		}
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_create_json [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_create_json [fail].\n");
+	}
+
+	return status;
+}
+
 static void event_callback(void *data)
 {
 	agc_log_printf(AGC_LOG, AGC_LOG_INFO, "test callback [ok].\n");
@@ -534,3 +701,2243 @@ static void bind_callback(void *data)
 	
 }
 
+static agc_status_t test_try_fire(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	agc_event_overflow_t policy = agc_event_get_overflow_policy(g_event_id);
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) ||! new_event) {
+		stream->write_function(stream, "test agc_event_try_fire [fail].\n");
+		return status;
+	}
+
+	// out of range policies are refused, a queue with room takes the event
+	if ((agc_event_set_overflow_policy(g_event_id, EVENT_OVERFLOW_SPILL + 1) != AGC_STATUS_SUCCESS) &&
+		(agc_event_set_overflow_policy(g_event_id, EVENT_OVERFLOW_DROP_NEWEST) == AGC_STATUS_SUCCESS) &&
+		(agc_event_get_overflow_policy(g_event_id) == EVENT_OVERFLOW_DROP_NEWEST) &&
+		(agc_event_try_fire(&new_event) == AGC_STATUS_SUCCESS)) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_set_overflow_policy(g_event_id, policy);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_try_fire [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_try_fire [fail].\n");
+		agc_event_destroy(&new_event);
+	}
+
+	return status;
+}
+
+static volatile int g_filtered_calls[4];
+
+static void filtered_callback_in(void *data)
+{
+	g_filtered_calls[0]++;
+}
+
+static void filtered_callback_other(void *data)
+{
+	g_filtered_calls[1]++;
+}
+
+static void filtered_callback_prefix(void *data)
+{
+	g_filtered_calls[2]++;
+}
+
+static void filtered_callback_exists(void *data)
+{
+	g_filtered_calls[3]++;
+}
+
+static agc_status_t test_bind_filtered(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_filter_t *filter = NULL;
+	agc_event_filter_t *filters[4] = { NULL };
+	agc_event_callback_func callbacks[4] = { filtered_callback_in, filtered_callback_other, filtered_callback_prefix, filtered_callback_exists };
+	agc_event_node_t *nodes[4] = { NULL };
+	agc_status_t status = AGC_STATUS_FALSE;
+	int i, bound = 0;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) ||! new_event) {
+		stream->write_function(stream, "test agc_event_bind_filtered [fail].\n");
+		return status;
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+	agc_event_filter_create(&filter);
+
+	// only the events with the test header pass
+	if ((agc_event_filter_add(filter, TEST_HEADER_NAME, EVENT_FILTER_IN, TEST_HEADER_FMTVALUE) == AGC_STATUS_SUCCESS) &&
+		!agc_event_filter_match(filter, new_event) &&
+		(agc_event_filter_add(filter, TEST_HEADER_NAME, EVENT_FILTER_IN, TEST_HEADER_VALUE) == AGC_STATUS_SUCCESS) &&
+		agc_event_filter_match(filter, new_event)) {
+		filters[0] = filter;
+		filter = NULL;
+	}
+
+	// indexed by another value, and two tested one by one of which only exists matches
+	for (i = 1; i < 4; i++) {
+		agc_event_filter_create(&filters[i]);
+	}
+	agc_event_filter_add(filters[1], TEST_HEADER_NAME, EVENT_FILTER_EQUALS, TEST_HEADER_FMTVALUE);
+	agc_event_filter_add(filters[2], TEST_HEADER_NAME, EVENT_FILTER_PREFIX, "zz");
+	agc_event_filter_add(filters[3], TEST_HEADER_NAME, EVENT_FILTER_EXISTS, NULL);
+
+	memset((void *) g_filtered_calls, 0, sizeof(g_filtered_calls));
+	for (i = 0; i < 4; i++) {
+		if (filters[i] && agc_event_bind_filtered(TEST_BIND_NAME, g_event_id, callbacks[i], filters[i], &nodes[i]) == AGC_STATUS_SUCCESS) {
+			bound++;
+		} else {
+			agc_event_filter_destroy(&filters[i]);
+		}
+	}
+
+	// a bound filter is frozen and has one owner
+	if (bound == 4 && agc_event_filter_add(filters[0], TEST_HEADER_NAME, EVENT_FILTER_IN, "more") != AGC_STATUS_SUCCESS &&
+		agc_event_bind_filtered(TEST_BIND_NAME, g_event_id, bind_callback, filters[3], NULL) != AGC_STATUS_SUCCESS &&
+		agc_event_fire(&new_event) == AGC_STATUS_SUCCESS) {
+		for (i = 0; i < 50 && !(g_filtered_calls[0] && g_filtered_calls[3]); i++) {
+			agc_yield(10000); //wait execute
+		}
+		agc_yield(50000);
+
+		// the in subscriber is reached through the value index only
+		if (g_filtered_calls[0] == 1 && !g_filtered_calls[1] && !g_filtered_calls[2] && g_filtered_calls[3] == 1) {
+			status = AGC_STATUS_SUCCESS;
+		}
+	}
+
+	for (i = 0; i < 4; i++) {
+		if (nodes[i] && agc_event_unbind(&nodes[i]) != AGC_STATUS_SUCCESS) {
+			status = AGC_STATUS_FALSE;
+		}
+	}
+
+	agc_event_filter_destroy(&filter);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_bind_filtered [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_bind_filtered [fail].\n");
+		agc_event_destroy(&new_event);
+	}
+
+	return status;
+}
+
+#define TEST_BATCH_EVENTS 16
+#define TEST_BATCH_HEADER "batch_seq"
+
+static volatile int g_batch_count = 0;
+static volatile int g_batch_sourced = 0;
+static volatile int g_batch_last = 0;
+static volatile int g_batch_disorder = 0;
+
+static void batch_callback(void *data)
+{
+	agc_event_t *event = (agc_event_t *) data;
+	const char *seq = agc_event_get_header(event, TEST_BATCH_HEADER);
+	int value;
+
+	if (!seq) {
+		return;
+	}
+
+	// only the events of a source keep their order
+	if (event->source_id == g_source_id) {
+		if ((value = atoi(seq)) <= g_batch_last) {
+			g_batch_disorder++;
+		}
+		g_batch_last = value;
+		g_batch_sourced++;
+	}
+
+	g_batch_count++;
+}
+
+static agc_status_t test_fire_batch(agc_stream_handle_t *stream)
+{
+	agc_event_t *events[TEST_BATCH_EVENTS + 1] = { NULL };
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_SUCCESS;
+	int i;
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, batch_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_fire_batch [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_batch_count = 0;
+	g_batch_sourced = 0;
+	g_batch_last = 0;
+	g_batch_disorder = 0;
+
+	// the last entry is NULL and skipped, every other event has no source and goes to an unordered queue
+	for (i = 0; i < TEST_BATCH_EVENTS; i++) {
+		if ((agc_event_create(&events[i], g_event_id, i % 2 ? g_source_id : EVENT_NULL_SOURCEID) != AGC_STATUS_SUCCESS) || !events[i]) {
+			status = AGC_STATUS_FALSE;
+			continue;
+		}
+		agc_event_add_header(events[i], TEST_BATCH_HEADER, "%d", i + 1);
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		status = agc_event_fire_batch(events, TEST_BATCH_EVENTS + 1);
+	}
+
+	for (i = 0; i < TEST_BATCH_EVENTS + 1; i++) {
+		if (events[i]) {
+			status = AGC_STATUS_FALSE;
+			agc_event_destroy(&events[i]);
+		}
+	}
+
+	// delivered before the next test binds
+	for (i = 0; i < 100 && g_batch_count < TEST_BATCH_EVENTS; i++) {
+		agc_yield(10000);
+	}
+
+	if (g_batch_count != TEST_BATCH_EVENTS || g_batch_sourced != TEST_BATCH_EVENTS / 2 || g_batch_disorder) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	agc_event_unbind(&node);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_fire_batch [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_fire_batch [fail].\n");
+	}
+
+	return status;
+}
+
+static agc_status_t test_bind_async(agc_stream_handle_t *stream)
+{
+	agc_event_lane_options_t options = { 16, 1, EVENT_OVERFLOW_DROP_NEWEST };
+	agc_event_subscriber_stats_t stats[8];
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	int i, count;
+
+	if (agc_event_bind_async(TEST_BIND_NAME, g_event_id, bind_callback, NULL, &options, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_bind_async [fail].\n");
+		return status;
+	}
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+		agc_event_fire(&new_event);
+		agc_yield(500000); //wait execute
+	}
+
+	// the lane shows up in the subscriber stats
+	count = agc_event_get_subscriber_stats(g_event_id, stats, 8);
+	for (i = 0; i < count; i++) {
+		if (stats[i].async && stats[i].lane_queued == 1 && stats[i].callback.count == 1) {
+			status = AGC_STATUS_SUCCESS;
+		}
+	}
+
+	if (agc_event_unbind(&node) != AGC_STATUS_SUCCESS) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_bind_async [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_bind_async [fail].\n");
+	}
+
+	return status;
+}
+
+static volatile int g_replies = 0;
+static volatile int g_timeouts = 0;
+
+static void request_responder(void *data)
+{
+	agc_event_t *request = (agc_event_t *) data;
+	agc_event_t *reply = NULL;
+
+	// answers only the requests with the test header
+	if (!agc_event_get_header(request, TEST_HEADER_NAME)) {
+		return;
+	}
+
+	if ((agc_event_create(&reply, g_event_id, EVENT_NULL_SOURCEID) == AGC_STATUS_SUCCESS) && reply) {
+		agc_event_set_reply(request, reply);
+		agc_event_fire(&reply);
+	}
+}
+
+static void request_reply(agc_event_t *reply, void *data)
+{
+	if (reply) {
+		g_replies++;
+	} else {
+		g_timeouts++;
+	}
+}
+
+static agc_status_t test_request(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	uint32_t pending = 0;
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, request_responder, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request [fail].\n");
+		return status;
+	}
+
+	g_replies = g_timeouts = 0;
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+		agc_event_request(&new_event, 1000, request_reply, NULL);
+	}
+
+	// nobody answers this one
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_request(&new_event, 100, request_reply, NULL);
+	}
+
+	agc_yield(500000); //wait execute
+	agc_event_request_stats(&pending, NULL);
+	if (g_replies == 1 && g_timeouts == 1 && pending == 0) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_unbind(&node);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_request [fail].\n");
+	}
+
+	return status;
+}
+
+static volatile int g_expired = 0;
+
+static void expiry_callback(void *data)
+{
+	g_expired++;
+}
+
+static agc_status_t test_deadline(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	uint64_t expired = agc_event_get_expired(g_event_id);
+
+	g_expired = 0;
+	agc_event_set_expiry_callback(g_event_id, expiry_callback);
+
+	// already passed, it is dropped instead of delivered
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_set_deadline(new_event, agc_time_now() - 1);
+		agc_event_fire(&new_event);
+	}
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_set_ttl(new_event, 60000);
+		agc_event_fire(&new_event);
+	}
+
+	agc_yield(500000); //wait execute
+	if (g_expired == 1 && agc_event_get_expired(g_event_id) == expired + 1) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_set_expiry_callback(g_event_id, NULL);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_set_deadline [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_set_deadline [fail].\n");
+	}
+
+	return status;
+}
+
+static agc_status_t test_priority(agc_stream_handle_t *stream)
+{
+	agc_event_priority_stats_t high, low;
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	uint64_t high_count, low_count;
+
+	agc_event_get_priority_stats(EVENT_PRIORITY_HIGH, &high);
+	agc_event_get_priority_stats(EVENT_PRIORITY_LOW, &low);
+	high_count = high.queue_delay.count;
+	low_count = low.queue_delay.count;
+
+	agc_event_set_priority(g_event_id, EVENT_PRIORITY_HIGH);
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	// the class of the id does not apply
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire_priority(&new_event, EVENT_PRIORITY_LOW);
+	}
+
+	agc_yield(500000); //wait execute
+	agc_event_get_priority_stats(EVENT_PRIORITY_HIGH, &high);
+	agc_event_get_priority_stats(EVENT_PRIORITY_LOW, &low);
+	if (agc_event_get_priority(g_event_id) == EVENT_PRIORITY_HIGH &&
+		high.queue_delay.count == high_count + 1 && low.queue_delay.count == low_count + 1) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_set_priority(g_event_id, EVENT_PRIORITY_NORMAL);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_set_priority [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_set_priority [fail].\n");
+	}
+
+	return status;
+}
+
+static void test_put_u32(unsigned char *ptr, uint32_t value)
+{
+	ptr[0] = value >> 24;
+	ptr[1] = value >> 16;
+	ptr[2] = value >> 8;
+	ptr[3] = value;
+}
+
+static agc_status_t test_replace_typed(agc_stream_handle_t *stream)
+{
+	// a frame with one int32 header "num" = 123456789
+	unsigned char frame[AGC_EVENT_BINARY_HEAD_SIZE + 8 + 3 + 4];
+	agc_event_t *new_event = NULL;
+	agc_event_t *copy = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	const char *value;
+	char buf[256];
+	agc_size_t len = 0;
+
+	memset(frame, 0, sizeof(frame));
+	test_put_u32(frame, sizeof(frame));
+	frame[4] = AGC_EVENT_BINARY_VERSION;
+	frame[7] = 1;
+	test_put_u32(frame + 8, g_event_id);
+	frame[AGC_EVENT_BINARY_HEAD_SIZE] = EVENT_HEADER_INT32;
+	frame[AGC_EVENT_BINARY_HEAD_SIZE + 3] = 3;
+	frame[AGC_EVENT_BINARY_HEAD_SIZE + 7] = 4;
+	memcpy(frame + AGC_EVENT_BINARY_HEAD_SIZE + 8, "num", 3);
+	test_put_u32(frame + AGC_EVENT_BINARY_HEAD_SIZE + 11, 123456789);
+
+	if (agc_event_create_binary(&new_event, frame, sizeof(frame)) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test replace typed header [fail].\n");
+		return status;
+	}
+
+	// shorter than the number, then longer than its buffer
+	agc_event_add_header_string(new_event, "num", "7");
+	if ((value = agc_event_get_header(new_event, "num")) && !strcmp(value, "7")) {
+		agc_event_add_header_repeatcheck(new_event, "num", "%s", "a text longer than any number");
+		if ((value = agc_event_get_header(new_event, "num")) && !strcmp(value, "a text longer than any number") &&
+			agc_event_serialize_binary(new_event, buf, sizeof(buf), &len) == AGC_STATUS_SUCCESS &&
+			agc_event_create_binary(&copy, buf, len) == AGC_STATUS_SUCCESS &&
+			(value = agc_event_get_header(copy, "num")) && !strcmp(value, "a text longer than any number")) {
+			status = AGC_STATUS_SUCCESS;
+		}
+	}
+
+	agc_event_destroy(&copy);
+	agc_event_destroy(&new_event);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test replace typed header [ok].\n");
+	} else {
+		stream->write_function(stream, "test replace typed header [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_RESIZE_SOURCES 8
+#define TEST_RESIZE_EVENTS 4000
+static volatile int g_resize_hits = 0;
+static volatile int g_resize_disorder = 0;
+static int g_resize_last[TEST_RESIZE_SOURCES];
+
+static void resize_callback(void *data)
+{
+	agc_event_t *event = (agc_event_t *) data;
+	const char *seq = agc_event_get_header(event, TEST_HEADER_NAME);
+	int index = (int) (event->source_id % TEST_RESIZE_SOURCES);
+
+	if (!seq) {
+		return;
+	}
+
+	// the events of a source come in the order they were fired
+	if (atoi(seq) != g_resize_last[index] + 1) {
+		g_resize_disorder++;
+	}
+	g_resize_last[index] = atoi(seq);
+	g_resize_hits++;
+}
+
+static agc_status_t test_resize(agc_stream_handle_t *stream)
+{
+	int count = agc_event_dispatcher_count();
+	int target = count < agc_event_dispatcher_capacity() ? count + 1 : count - 1;
+	int seq[TEST_RESIZE_SOURCES] = { 0 };
+	agc_event_node_t *node = NULL;
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	int i;
+
+	if (target < 1) {
+		stream->write_function(stream, "test agc_event_resize_dispatchers [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, resize_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_resize_dispatchers [fail].\n");
+		return status;
+	}
+
+	// sources move both ways while their events are queued
+	for (i = 0; i < TEST_RESIZE_EVENTS; i++) {
+		int index = i % TEST_RESIZE_SOURCES;
+
+		if (i == TEST_RESIZE_EVENTS / 3) {
+			agc_event_resize_dispatchers(target);
+		} else if (i == TEST_RESIZE_EVENTS * 2 / 3) {
+			agc_event_resize_dispatchers(count);
+		}
+
+		if ((agc_event_create(&new_event, g_event_id, TEST_RESIZE_SOURCES * 1000 + index) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_add_header(new_event, TEST_HEADER_NAME, "%d", ++seq[index]);
+			agc_event_fire(&new_event);
+		}
+	}
+
+	for (i = 0; i < 100 && g_resize_hits < TEST_RESIZE_EVENTS; i++) {
+		agc_yield(10000); //wait execute
+	}
+
+	if (g_resize_hits == TEST_RESIZE_EVENTS && !g_resize_disorder && agc_event_dispatcher_count() == count) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	if (agc_event_unbind(&node) != AGC_STATUS_SUCCESS) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_resize_dispatchers [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_resize_dispatchers [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_OVERFLOW_LIMIT 100000
+#define TEST_OVERFLOW_EXTRA 100
+static volatile int g_overflow_gate = 0;
+static volatile int g_overflow_count = 0;
+static volatile int g_overflow_first = 0;
+static volatile int g_overflow_last = 0;
+static volatile int g_overflow_disorder = 0;
+static volatile int g_overflow_marked = 0;
+static volatile int g_overflow_high = 0;
+
+static void overflow_marker(void *data)
+{
+	g_overflow_marked = 1;
+}
+
+static void overflow_callback(void *data)
+{
+	agc_event_t *event = (agc_event_t *) data;
+	const char *seq = agc_event_get_header(event, TEST_HEADER_NAME);
+	int value;
+
+	if (!seq) {
+		return;
+	}
+
+	// where it came among the others
+	if (event->priority == EVENT_PRIORITY_HIGH) {
+		g_overflow_high = g_overflow_count + 1;
+		return;
+	}
+
+	// the first event keeps the dispatcher busy until the queue is full
+	if (!(value = atoi(seq))) {
+		while (!g_overflow_gate) {
+			agc_yield(1000);
+		}
+		return;
+	}
+
+	if (value <= g_overflow_last) {
+		g_overflow_disorder++;
+	}
+
+	if (!g_overflow_count) {
+		g_overflow_first = value;
+	}
+
+	g_overflow_last = value;
+	g_overflow_count++;
+}
+
+static void test_overflow_counters(uint64_t *dropped, uint64_t *spilled)
+{
+	agc_event_dispatch_stats_t stats;
+	int i;
+
+	*dropped = 0;
+	*spilled = 0;
+
+	for (i = 0; i < agc_event_dispatcher_capacity(); i++) {
+		if (agc_event_get_dispatch_stats(i, &stats) == AGC_STATUS_SUCCESS) {
+			*dropped += stats.dropped;
+			*spilled += stats.spilled;
+		}
+	}
+}
+
+/* fills the queue of the test source past its size with the policy, returns the events fired */
+static int test_overflow_fill(agc_event_overflow_t policy, agc_bool_t high, uint64_t *dropped, uint64_t *spilled)
+{
+	agc_event_overflow_t old = agc_event_get_overflow_policy(g_event_id);
+	agc_event_node_t *node = NULL;
+	agc_event_t *new_event = NULL;
+	uint64_t dropped_base, spilled_base;
+	int fired = 0, extra = -1, i;
+
+	g_overflow_gate = 0;
+	g_overflow_count = 0;
+	g_overflow_first = 0;
+	g_overflow_last = 0;
+	g_overflow_disorder = 0;
+	g_overflow_marked = 0;
+	g_overflow_high = 0;
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, overflow_callback, &node) != AGC_STATUS_SUCCESS) {
+		return 0;
+	}
+
+	agc_event_set_overflow_policy(g_event_id, policy);
+	test_overflow_counters(&dropped_base, &spilled_base);
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_add_header(new_event, TEST_HEADER_NAME, "%d", 0);
+		agc_event_fire(&new_event);
+		agc_yield(100000); //wait the dispatcher to take it
+	}
+
+	// the oldest queued event, it is never dropped
+	if ((agc_event_create_callback(&new_event, g_source_id, NULL, overflow_marker) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	// until the policy applies, then a few more
+	while (fired < TEST_OVERFLOW_LIMIT && extra < TEST_OVERFLOW_EXTRA) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+			break;
+		}
+
+		agc_event_add_header(new_event, TEST_HEADER_NAME, "%d", ++fired);
+		agc_event_fire(&new_event);
+
+		if (extra >= 0) {
+			extra++;
+		} else {
+			test_overflow_counters(dropped, spilled);
+			if (*dropped != dropped_base || *spilled != spilled_base) {
+				extra = 0;
+			}
+		}
+	}
+
+	// a class with room does not wait behind the spilled events of another
+	if (high && (agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_add_header(new_event, TEST_HEADER_NAME, "%d", -1);
+		agc_event_fire_priority(&new_event, EVENT_PRIORITY_HIGH);
+	}
+
+	g_overflow_gate = 1;
+	for (i = 0; i < 200 && g_overflow_last != fired; i++) {
+		agc_yield(10000); //wait execute
+	}
+
+	test_overflow_counters(dropped, spilled);
+	*dropped -= dropped_base;
+	*spilled -= spilled_base;
+
+	agc_event_set_overflow_policy(g_event_id, old);
+	agc_event_unbind(&node);
+
+	return fired;
+}
+
+static agc_status_t test_drop_newest(agc_stream_handle_t *stream)
+{
+	uint64_t dropped = 0, spilled = 0;
+	int fired = test_overflow_fill(EVENT_OVERFLOW_DROP_NEWEST, AGC_FALSE, &dropped, &spilled);
+
+	// the queue keeps the first ones
+	if (fired && g_overflow_marked && dropped == TEST_OVERFLOW_EXTRA + 1 && !spilled && !g_overflow_disorder &&
+		g_overflow_first == 1 && g_overflow_count == fired - TEST_OVERFLOW_EXTRA - 1) {
+		stream->write_function(stream, "test EVENT_OVERFLOW_DROP_NEWEST [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "test EVENT_OVERFLOW_DROP_NEWEST [fail].\n");
+	return AGC_STATUS_FALSE;
+}
+
+static agc_status_t test_drop_oldest(agc_stream_handle_t *stream)
+{
+	uint64_t dropped = 0, spilled = 0;
+	int fired = test_overflow_fill(EVENT_OVERFLOW_DROP_OLDEST, AGC_FALSE, &dropped, &spilled);
+
+	// the first ones made room for the last ones, the callback before them stayed
+	if (fired && g_overflow_marked && dropped == TEST_OVERFLOW_EXTRA + 1 && !g_overflow_disorder && g_overflow_last == fired &&
+		g_overflow_first == TEST_OVERFLOW_EXTRA + 2 && g_overflow_count == fired - TEST_OVERFLOW_EXTRA - 1) {
+		stream->write_function(stream, "test EVENT_OVERFLOW_DROP_OLDEST [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "test EVENT_OVERFLOW_DROP_OLDEST [fail].\n");
+	return AGC_STATUS_FALSE;
+}
+
+static agc_status_t test_spill(agc_stream_handle_t *stream)
+{
+	uint64_t dropped = 0, spilled = 0;
+	int fired = test_overflow_fill(EVENT_OVERFLOW_SPILL, AGC_FALSE, &dropped, &spilled);
+
+	// nothing is lost and the spilled ones come behind the queue
+	if (fired && g_overflow_marked && !dropped && spilled >= TEST_OVERFLOW_EXTRA + 1 && !g_overflow_disorder &&
+		g_overflow_first == 1 && g_overflow_count == fired) {
+		stream->write_function(stream, "test EVENT_OVERFLOW_SPILL [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "test EVENT_OVERFLOW_SPILL [fail].\n");
+	return AGC_STATUS_FALSE;
+}
+
+static agc_status_t test_spill_priority(agc_stream_handle_t *stream)
+{
+	uint64_t dropped = 0, spilled = 0;
+	int fired = test_overflow_fill(EVENT_OVERFLOW_SPILL, AGC_TRUE, &dropped, &spilled);
+
+	// the high event was not spilled and came before the spilled normal ones
+	if (fired && !dropped && spilled == TEST_OVERFLOW_EXTRA + 1 && !g_overflow_disorder && g_overflow_count == fired &&
+		g_overflow_high && g_overflow_high <= fired - (int) spilled) {
+		stream->write_function(stream, "test agc_event_fire_priority with EVENT_OVERFLOW_SPILL [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "test agc_event_fire_priority with EVENT_OVERFLOW_SPILL [fail].\n");
+	return AGC_STATUS_FALSE;
+}
+
+static char g_request_corr[32] = "";
+
+static void request_capture(void *data)
+{
+	agc_event_t *request = (agc_event_t *) data;
+	const char *corr = agc_event_get_header(request, EVENT_HEADER_CORRELATION);
+
+	if (corr) {
+		snprintf(g_request_corr, sizeof(g_request_corr), "%s", corr);
+	}
+}
+
+static agc_status_t test_request_ingress(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	char json[128];
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, request_capture, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request ingress [fail].\n");
+		return status;
+	}
+
+	g_replies = g_timeouts = 0;
+	g_request_corr[0] = '\0';
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_request(&new_event, 300, request_reply, NULL);
+	}
+
+	agc_yield(100000); //wait execute
+
+	// a received event can not answer a pending request
+	snprintf(json, sizeof(json), "{\"_id\":\"%d\",\"" EVENT_HEADER_REPLY "\":\"%s\",\"" EVENT_HEADER_CORRELATION "\":\"1\"}", g_event_id, g_request_corr);
+	if (g_request_corr[0] && (agc_event_create_json(&new_event, json) == AGC_STATUS_SUCCESS) && new_event) {
+		if (!agc_event_get_header(new_event, EVENT_HEADER_REPLY) && !agc_event_get_header(new_event, EVENT_HEADER_CORRELATION)) {
+			status = AGC_STATUS_SUCCESS;
+		}
+		agc_event_fire(&new_event);
+	}
+
+	agc_yield(500000); //wait execute
+	if (g_replies || g_timeouts != 1) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	agc_event_unbind(&node);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request ingress [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_request ingress [fail].\n");
+	}
+
+	return status;
+}
+
+static agc_status_t test_binary(agc_stream_handle_t *stream)
+{
+	unsigned char bogus[AGC_EVENT_BINARY_HEAD_SIZE];
+	agc_event_t *new_event = NULL;
+	agc_event_t *copy = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	char *buf = NULL, *again = NULL;
+	agc_size_t size = 0, len = 0, again_size = 0, again_len = 0;
+	const char *value;
+
+	if ((agc_event_create(&new_event, g_event_id, 0x123456789ULL) != AGC_STATUS_SUCCESS) || !new_event) {
+		stream->write_function(stream, "test agc_event_create_binary [fail].\n");
+		return status;
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+	agc_event_add_header_string(new_event, "empty", "");
+	agc_event_set_body(new_event, "some thing");
+
+	// decoded and encoded again it is the same frame
+	if (agc_event_serialize_binary_ex(new_event, &buf, &size, &len) == AGC_STATUS_SUCCESS &&
+		agc_event_create_binary(&copy, buf, len) == AGC_STATUS_SUCCESS &&
+		copy->event_id == g_event_id && copy->source_id == 0x123456789ULL &&
+		(value = agc_event_get_header(copy, TEST_HEADER_NAME)) && !strcmp(value, TEST_HEADER_VALUE) &&
+		(value = agc_event_get_header(copy, "empty")) && !*value &&
+		(value = agc_event_get_body(copy)) && !strcmp(value, "some thing") &&
+		agc_event_serialize_binary_ex(copy, &again, &again_size, &again_len) == AGC_STATUS_SUCCESS &&
+		again_len == len && !memcmp(buf, again, len)) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_destroy(&copy);
+
+	// truncated frames and a header count the frame can not hold are rejected
+	if (status == AGC_STATUS_SUCCESS && agc_event_create_binary(&copy, buf, len - 1) == AGC_STATUS_SUCCESS) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	memset(bogus, 0, sizeof(bogus));
+	test_put_u32(bogus, sizeof(bogus));
+	bogus[4] = AGC_EVENT_BINARY_VERSION;
+	bogus[6] = bogus[7] = 0xff;
+	test_put_u32(bogus + 8, g_event_id);
+	if (status == AGC_STATUS_SUCCESS && agc_event_create_binary(&copy, bogus, sizeof(bogus)) == AGC_STATUS_SUCCESS) {
+		status = AGC_STATUS_FALSE;
+	}
+
+	agc_event_destroy(&copy);
+	agc_event_destroy(&new_event);
+	agc_safe_free(buf);
+	agc_safe_free(again);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_create_binary [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_create_binary [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_LANE_ROUNDS 500
+#define TEST_LANE_EVENTS 64
+
+static volatile int g_lane_calls = 0;
+
+static void lane_slow_callback(void *data)
+{
+	g_lane_calls++;
+	agc_yield(100);
+}
+
+static agc_status_t test_lane_stop(agc_stream_handle_t *stream)
+{
+	agc_event_lane_options_t options = { 1, 8, EVENT_OVERFLOW_DROP_OLDEST };
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	int round, i;
+
+	g_lane_calls = 0;
+
+	// unbind while the dispatcher still makes room in the full lane, the stop must not be dropped
+	for (round = 0; round < TEST_LANE_ROUNDS; round++) {
+		if (agc_event_bind_async(TEST_BIND_NAME, g_event_id, lane_slow_callback, NULL, &options, &node) != AGC_STATUS_SUCCESS) {
+			stream->write_function(stream, "test lane stop [fail].\n");
+			return AGC_STATUS_FALSE;
+		}
+
+		for (i = 0; i < TEST_LANE_EVENTS; i++) {
+			if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+				agc_event_fire(&new_event);
+			}
+		}
+
+		if (agc_event_unbind(&node) != AGC_STATUS_SUCCESS) {
+			stream->write_function(stream, "test lane stop [fail].\n");
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	agc_yield(100000);
+
+	if (g_lane_calls > TEST_LANE_ROUNDS * TEST_LANE_EVENTS) {
+		stream->write_function(stream, "test lane stop [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test lane stop [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+/* more than a dispatcher takes in one batch */
+#define TEST_STEAL_EVENTS 2048
+
+static volatile int g_steal_calls = 0;
+
+static void steal_callback(void *data)
+{
+	agc_fetch_add(&g_steal_calls, 1);
+	agc_yield(100);
+}
+
+static uint64_t test_stolen(void)
+{
+	agc_event_dispatch_stats_t stats;
+	uint64_t stolen = 0;
+	int i;
+
+	for (i = 0; i < agc_event_dispatcher_capacity(); i++) {
+		if (agc_event_get_dispatch_stats(i, &stats) == AGC_STATUS_SUCCESS) {
+			stolen += stats.stolen;
+		}
+	}
+
+	return stolen;
+}
+
+static agc_status_t test_steal(agc_stream_handle_t *stream)
+{
+	static agc_event_t *events[TEST_STEAL_EVENTS];
+	agc_event_node_t *node = NULL;
+	uint64_t stolen = test_stolen();
+	int i, waited;
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, steal_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test unordered steal [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_steal_calls = 0;
+
+	// a batch puts its sourceless events on one unordered queue, the idle dispatchers take from it
+	for (i = 0; i < TEST_STEAL_EVENTS; i++) {
+		agc_event_create(&events[i], g_event_id, EVENT_NULL_SOURCEID);
+	}
+	agc_event_fire_batch(events, TEST_STEAL_EVENTS);
+
+	for (waited = 0; g_steal_calls < TEST_STEAL_EVENTS && waited < 500; waited++) {
+		agc_yield(10000);
+	}
+
+	stolen = test_stolen() - stolen;
+	agc_event_unbind(&node);
+
+	if (g_steal_calls != TEST_STEAL_EVENTS || (agc_event_dispatcher_count() > 1 && !stolen)) {
+		stream->write_function(stream, "test unordered steal [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test unordered steal [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+static agc_status_t test_register_names(agc_stream_handle_t *stream)
+{
+	int event_id = -1;
+
+	// names are looked up without case, a name registered again keeps its first id
+	if (agc_event_get_id("TEST_Event", &event_id) != AGC_STATUS_SUCCESS || event_id != g_event_id ||
+		agc_event_register(g_event_id + 2, "Test_Event") != AGC_STATUS_SUCCESS ||
+		agc_event_get_id(TEST_EVENT_NAME, &event_id) != AGC_STATUS_SUCCESS || event_id != g_event_id ||
+		strcmp(agc_event_get_name(g_event_id + 2), "Test_Event")) {
+		stream->write_function(stream, "test agc_event_register names [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	if (agc_event_register(g_event_id + 3, NULL) == AGC_STATUS_SUCCESS || 
+		agc_event_register(g_event_id + 3, "") == AGC_STATUS_SUCCESS || agc_event_get_name(g_event_id + 3)) {
+		stream->write_function(stream, "test agc_event_register names [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test agc_event_register names [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+#define TEST_LOOSE_HEADER "x-test-loose"
+
+static agc_status_t test_atom_intern(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_filter_t *filter = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	uint32_t atom;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+		stream->write_function(stream, "test header atoms [fail].\n");
+		return status;
+	}
+
+	// adding a header does not intern its name, it is still found without case
+	agc_event_add_header_string(new_event, TEST_LOOSE_HEADER, TEST_HEADER_VALUE);
+	if (agc_event_atom_find(TEST_LOOSE_HEADER) == EVENT_ATOM_NONE && 
+		agc_event_get_header(new_event, "X-Test-Loose") && !strcmp(agc_event_get_header(new_event, TEST_LOOSE_HEADER), TEST_HEADER_VALUE)) {
+		// a filter interns it later, the header added before is still matched
+		agc_event_filter_create(&filter);
+		if (agc_event_filter_add(filter, TEST_LOOSE_HEADER, EVENT_FILTER_EQUALS, TEST_HEADER_VALUE) == AGC_STATUS_SUCCESS &&
+			(atom = agc_event_atom_find(TEST_LOOSE_HEADER)) != EVENT_ATOM_NONE &&
+			agc_event_get_header_atom(new_event, atom) && agc_event_filter_match(filter, new_event) &&
+			agc_event_del_header(new_event, "X-TEST-LOOSE") == AGC_STATUS_SUCCESS && !agc_event_get_header(new_event, TEST_LOOSE_HEADER)) {
+			status = AGC_STATUS_SUCCESS;
+		}
+		agc_event_filter_destroy(&filter);
+	}
+
+	agc_event_destroy(&new_event);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test header atoms [ok].\n");
+	} else {
+		stream->write_function(stream, "test header atoms [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_REPLACE_ROUNDS 1000
+
+static agc_status_t test_replace_reuse(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	const char *value, *probe;
+	agc_status_t status = AGC_STATUS_FALSE;
+	int i;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+		stream->write_function(stream, "test replace header reuse [fail].\n");
+		return status;
+	}
+
+	agc_event_add_header(new_event, TEST_HEADER_NAME, "%s", "a value as long as the others");
+	value = agc_event_get_header(new_event, TEST_HEADER_NAME);
+
+	// values that fit are copied into the first buffer, the event memory does not grow
+	for (i = 0; i < TEST_REPLACE_ROUNDS; i++) {
+		agc_event_add_header_repeatcheck(new_event, TEST_HEADER_NAME, "replacement %d", i);
+		if (agc_event_get_header(new_event, TEST_HEADER_NAME) != value) {
+			break;
+		}
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, "short");
+	agc_event_add_header_string(new_event, "probe", "probe");
+	probe = agc_event_get_header(new_event, "probe");
+
+	if (i == TEST_REPLACE_ROUNDS && !strcmp(value, "short") && probe > value && probe - value < 256) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_destroy(&new_event);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test replace header reuse [ok].\n");
+	} else {
+		stream->write_function(stream, "test replace header reuse [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_WAKEUP_ROUNDS 20
+/* a polling dispatcher sleeps 10ms, half of the rounds would be later than this */
+#define TEST_WAKEUP_LATE_US 5000
+
+static volatile agc_time_t g_wakeup_time = 0;
+
+static void wakeup_callback(void *data)
+{
+	g_wakeup_time = agc_time_now();
+}
+
+static agc_status_t test_wakeup(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_time_t fired;
+	int round, waited, late = 0;
+
+	// the dispatchers go idle and park between the rounds, a fire has to wake them up at once
+	for (round = 0; round < TEST_WAKEUP_ROUNDS; round++) {
+		agc_yield(20000);
+
+		if ((agc_event_create_callback(&new_event, g_source_id, NULL, wakeup_callback) != AGC_STATUS_SUCCESS) || !new_event) {
+			stream->write_function(stream, "test dispatcher wakeup [fail].\n");
+			return AGC_STATUS_FALSE;
+		}
+
+		g_wakeup_time = 0;
+		fired = agc_time_now();
+		agc_event_fire(&new_event);
+
+		for (waited = 0; !g_wakeup_time && waited < 1000; waited++) {
+			agc_yield(1000);
+		}
+
+		if (!g_wakeup_time) {
+			stream->write_function(stream, "test dispatcher wakeup [fail].\n");
+			return AGC_STATUS_FALSE;
+		}
+
+		if (g_wakeup_time - fired > TEST_WAKEUP_LATE_US) {
+			late++;
+		}
+	}
+
+	// a loaded host may be late once or twice
+	if (late > 2) {
+		stream->write_function(stream, "test dispatcher wakeup [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test dispatcher wakeup [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+/* rounded up to a power of two */
+#define TEST_RING_ASKED 5
+#define TEST_RING_CAPACITY 8
+
+static agc_status_t test_ring_check(agc_queue_t *queue)
+{
+	void *items[TEST_RING_CAPACITY + 2];
+	void *data = NULL;
+	int round, i;
+
+	// empty: nothing to pop, a timed pop gives up
+	if (agc_queue_trypop(queue, &data) == AGC_STATUS_SUCCESS || agc_queue_size(queue) != 0 ||
+		agc_queue_pop_timeout(queue, &data, 10000) == AGC_STATUS_SUCCESS) {
+		return AGC_STATUS_FALSE;
+	}
+
+	// several rounds, the positions wrap around the cells
+	for (round = 0; round < 3; round++) {
+		for (i = 0; i < TEST_RING_CAPACITY; i++) {
+			if (agc_queue_trypush(queue, (void *)(intptr_t)(i + 1)) != AGC_STATUS_SUCCESS) {
+				return AGC_STATUS_FALSE;
+			}
+		}
+
+		// full: the push is refused and nothing is lost
+		if (agc_queue_trypush(queue, (void *)(intptr_t)-1) == AGC_STATUS_SUCCESS || agc_queue_size(queue) != TEST_RING_CAPACITY) {
+			return AGC_STATUS_FALSE;
+		}
+
+		for (i = 0; i < TEST_RING_CAPACITY; i++) {
+			if (agc_queue_trypop(queue, &data) != AGC_STATUS_SUCCESS || data != (void *)(intptr_t)(i + 1)) {
+				return AGC_STATUS_FALSE;
+			}
+		}
+
+		if (agc_queue_trypop(queue, &data) == AGC_STATUS_SUCCESS) {
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	// a bulk push stops at full, a bulk pop at empty
+	for (i = 0; i < TEST_RING_CAPACITY + 2; i++) {
+		items[i] = (void *)(intptr_t)(i + 1);
+	}
+
+	if (agc_queue_trypush_bulk(queue, items, TEST_RING_CAPACITY + 2) != TEST_RING_CAPACITY ||
+		agc_queue_trypush_bulk(queue, items, 1) != 0) {
+		return AGC_STATUS_FALSE;
+	}
+
+	memset(items, 0, sizeof(items));
+	if (agc_queue_trypop_bulk(queue, items, TEST_RING_CAPACITY + 2) != TEST_RING_CAPACITY ||
+		agc_queue_trypop_bulk(queue, items, 1) != 0) {
+		return AGC_STATUS_FALSE;
+	}
+
+	for (i = 0; i < TEST_RING_CAPACITY; i++) {
+		if (items[i] != (void *)(intptr_t)(i + 1)) {
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	return AGC_STATUS_SUCCESS;
+}
+
+static agc_status_t test_ring_queue(agc_stream_handle_t *stream)
+{
+	agc_memory_pool_t *pool = NULL;
+	agc_queue_t *queue = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test ring queue [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	if (agc_queue_create_ex(&queue, TEST_RING_ASKED, AGC_QUEUE_RING, pool) == AGC_STATUS_SUCCESS) {
+		status = test_ring_check(queue);
+	}
+
+	agc_memory_destroy_pool(&pool);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test ring queue [ok].\n");
+	} else {
+		stream->write_function(stream, "test ring queue [fail].\n");
+	}
+
+	return status;
+}
+
+/* fewer than a batch takes */
+#define TEST_DRAIN_EVENTS 32
+
+static volatile int g_drain_gate = 0;
+static volatile int g_drain_calls = 0;
+
+static void drain_gate_callback(void *data)
+{
+	int waited;
+
+	for (waited = 0; !g_drain_gate && waited < 5000; waited++) {
+		agc_yield(1000);
+	}
+}
+
+static void drain_callback(void *data)
+{
+	agc_fetch_add(&g_drain_calls, 1);
+}
+
+static void test_drain_stats(agc_event_dispatch_stats_t *total)
+{
+	agc_event_dispatch_stats_t stats;
+	int i, j;
+
+	memset(total, 0, sizeof(*total));
+	for (i = 0; i < agc_event_dispatcher_capacity(); i++) {
+		if (agc_event_get_dispatch_stats(i, &stats) != AGC_STATUS_SUCCESS) {
+			continue;
+		}
+
+		total->batches += stats.batches;
+		total->events += stats.events;
+		for (j = 0; j < EVENT_BATCH_BUCKETS; j++) {
+			total->batch_sizes[j] += stats.batch_sizes[j];
+		}
+		if (stats.max_batch > total->max_batch) {
+			total->max_batch = stats.max_batch;
+		}
+	}
+}
+
+static agc_status_t test_batch_drain(agc_stream_handle_t *stream)
+{
+	agc_event_dispatch_stats_t before, after;
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	uint64_t batches, events, sizes = 0;
+	int i, waited;
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, drain_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test batch drain [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_drain_gate = 0;
+	g_drain_calls = 0;
+	test_drain_stats(&before);
+
+	// the dispatcher of the source is held by the gate while the events queue up behind it
+	if ((agc_event_create_callback(&new_event, g_source_id, NULL, drain_gate_callback) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	for (i = 0; i < TEST_DRAIN_EVENTS; i++) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_fire(&new_event);
+		}
+	}
+
+	g_drain_gate = 1;
+
+	for (waited = 0; g_drain_calls < TEST_DRAIN_EVENTS && waited < 500; waited++) {
+		agc_yield(10000);
+	}
+
+	agc_event_unbind(&node);
+	test_drain_stats(&after);
+
+	batches = after.batches - before.batches;
+	events = after.events - before.events;
+	for (i = 0; i < EVENT_BATCH_BUCKETS; i++) {
+		sizes += after.batch_sizes[i] - before.batch_sizes[i];
+	}
+
+	// the waiting events are drained in a few wakeups, every wakeup is in the histogram
+	if (g_drain_calls != TEST_DRAIN_EVENTS || events < TEST_DRAIN_EVENTS + 1 || batches > 4 || sizes != batches ||
+		after.max_batch < TEST_DRAIN_EVENTS / 2) {
+		stream->write_function(stream, "test batch drain [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test batch drain [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+/* a type no module of the test process uses, a burst far beyond its capacity */
+#define TEST_FAST_TYPE EVENT_FAST_TYPE_M2S_GnpUpdateRsp
+#define TEST_FAST_CAPACITY 4
+#define TEST_FAST_EVENTS 256
+
+static agc_status_t test_fast_burst(agc_event_t **events)
+{
+	int32_t value = 0;
+	int i;
+
+	for (i = 0; i < TEST_FAST_EVENTS; i++) {
+		if (agc_event_fast_alloc(&events[i], TEST_FAST_TYPE) != AGC_STATUS_SUCCESS || !events[i] ||
+			agc_event_fast_set_intheader(events[i], 0, TEST_HEADER_NAME, i) != AGC_STATUS_SUCCESS) {
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	// every event is a distinct one
+	for (i = 0; i < TEST_FAST_EVENTS; i++) {
+		if (agc_event_fast_get_intheader(events[i], 0, &value) != AGC_STATUS_SUCCESS || value != i) {
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	return AGC_STATUS_SUCCESS;
+}
+
+static agc_status_t test_fast_pool(agc_stream_handle_t *stream)
+{
+	static agc_event_t *events[TEST_FAST_EVENTS];
+	const char *headers[] = {TEST_HEADER_NAME};
+	const int valuelengths[] = {16};
+	agc_event_fast_stats_t before, burst, after;
+	agc_status_t status = AGC_STATUS_SUCCESS;
+	int round, i;
+
+	// the test may run again in the same process
+	if (agc_event_fast_get_stats(TEST_FAST_TYPE, &before) != AGC_STATUS_SUCCESS &&
+		agc_event_fast_initial(TEST_FAST_TYPE, g_event_id, TEST_FAST_CAPACITY, headers, valuelengths, 1, 0) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test elastic fast pool [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	// the high water mark can not pass the room of the shared pool
+	if (agc_event_fast_set_watermarks(TEST_FAST_TYPE, 2, 8) != AGC_STATUS_SUCCESS ||
+		agc_event_fast_set_watermarks(TEST_FAST_TYPE, 8, 2) == AGC_STATUS_SUCCESS ||
+		agc_event_fast_set_watermarks(TEST_FAST_TYPE, 2, 1 << 20) == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test elastic fast pool [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	agc_event_fast_get_stats(TEST_FAST_TYPE, &before);
+
+	// two bursts: the pool grows instead of failing, and shrinks back to its high water mark between them
+	for (round = 0; round < 2 && status == AGC_STATUS_SUCCESS; round++) {
+		status = test_fast_burst(events);
+		agc_event_fast_get_stats(TEST_FAST_TYPE, &burst);
+
+		for (i = 0; i < TEST_FAST_EVENTS; i++) {
+			if (events[i]) {
+				agc_event_fast_release(&events[i]);
+			}
+		}
+
+		agc_event_fast_get_stats(TEST_FAST_TYPE, &after);
+
+		if (burst.total < TEST_FAST_EVENTS || after.pooled > after.high_water || after.total >= burst.total) {
+			status = AGC_STATUS_FALSE;
+		}
+	}
+
+	if (status != AGC_STATUS_SUCCESS || after.grown <= before.grown || after.freed <= before.freed ||
+		after.allocs <= before.allocs || after.releases <= before.releases || after.low_water != 2 || after.high_water != 8) {
+		stream->write_function(stream, "test elastic fast pool [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test elastic fast pool [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+#define TEST_JSON_ESCAPED "q\"b\\s/\t\r\n\x01 \xc3\xa9"
+
+/* every member of the cJSON tree is in the written text with the same value */
+static agc_status_t test_json_same(agc_event_t *event, const char *text)
+{
+	cJSON *tree = NULL, *parsed = NULL, *item, *found;
+	agc_status_t status = AGC_STATUS_FALSE;
+
+	if (agc_event_serialize_json_obj(event, &tree) != AGC_STATUS_SUCCESS || !tree || !(parsed = cJSON_Parse(text))) {
+		goto done;
+	}
+
+	for (item = tree->child; item; item = item->next) {
+		if (!(found = cJSON_GetObjectItem(parsed, item->string)) || found->type != cJSON_String || item->type != cJSON_String ||
+			strcmp(found->valuestring, item->valuestring)) {
+			goto done;
+		}
+	}
+
+	status = AGC_STATUS_SUCCESS;
+
+done:
+	if (tree) {
+		cJSON_Delete(tree);
+	}
+	if (parsed) {
+		cJSON_Delete(parsed);
+	}
+	return status;
+}
+
+static agc_status_t test_json_writer(agc_stream_handle_t *stream)
+{
+	agc_event_t *new_event = NULL;
+	agc_event_t *parsed = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	char *buf = NULL, *reused = NULL, *kept;
+	agc_size_t size = 0, len = 0, need = 0, estimate;
+	const char *value;
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+		stream->write_function(stream, "test json writer [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+	agc_event_set_body(new_event, "some thing");
+
+	// the estimate covers an event which needs no escaping, a buffer one byte short is refused
+	estimate = agc_event_serialize_json_size(new_event);
+	if (agc_event_serialize_json_buf(new_event, NULL, 0, &need) != AGC_STATUS_MEMERR || estimate < need + 1 || 
+		!(buf = malloc(need + 1)) || agc_event_serialize_json_buf(new_event, buf, need, &len) != AGC_STATUS_MEMERR || len != need ||
+		agc_event_serialize_json_buf(new_event, buf, need + 1, &len) != AGC_STATUS_SUCCESS || len != need || strlen(buf) != len ||
+		test_json_same(new_event, buf) != AGC_STATUS_SUCCESS) {
+		goto done;
+	}
+
+	// control characters, quotes and backslashes are escaped, the estimate falls short and the buffer grows
+	agc_event_add_header_string(new_event, "escaped", TEST_JSON_ESCAPED);
+	agc_event_set_body(new_event, TEST_JSON_ESCAPED);
+	if (!(reused = malloc(8))) {
+		goto done;
+	}
+	size = 8;
+
+	if (agc_event_serialize_json_ex(new_event, &reused, &size, &len) != AGC_STATUS_SUCCESS || size < len + 1 || strlen(reused) != len ||
+		test_json_same(new_event, reused) != AGC_STATUS_SUCCESS ||
+		agc_event_create_json(&parsed, reused) != AGC_STATUS_SUCCESS ||
+		!(value = agc_event_get_header(parsed, "escaped")) || strcmp(value, TEST_JSON_ESCAPED) ||
+		!(value = agc_event_get_body(parsed)) || strcmp(value, TEST_JSON_ESCAPED)) {
+		goto done;
+	}
+
+	// a buffer big enough is reused as it is
+	kept = reused;
+	need = size;
+	if (agc_event_serialize_json_ex(new_event, &reused, &size, &len) != AGC_STATUS_SUCCESS || reused != kept || size != need) {
+		goto done;
+	}
+
+	status = AGC_STATUS_SUCCESS;
+
+done:
+	agc_safe_free(buf);
+	agc_safe_free(reused);
+	agc_event_destroy(&parsed);
+	agc_event_destroy(&new_event);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test json writer [ok].\n");
+	} else {
+		stream->write_function(stream, "test json writer [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_LATENCY_BIND "latency_probe"
+#define TEST_LATENCY_EVENTS 10
+#define TEST_LATENCY_SLOW_US 2000
+/* no test fires it */
+#define TEST_LATENCY_IDLE_ID (EVENT_ID_LIMIT - 1)
+
+static volatile int g_latency_calls = 0;
+
+static void latency_callback(void *data)
+{
+	agc_yield(TEST_LATENCY_SLOW_US);
+	agc_fetch_add(&g_latency_calls, 1);
+}
+
+/* what was added to the histogram between two snapshots */
+static void test_latency_delta(agc_event_latency_t *delta, const agc_event_latency_t *before, const agc_event_latency_t *after)
+{
+	int i;
+
+	delta->count = after->count - before->count;
+	delta->sum_us = after->sum_us - before->sum_us;
+	delta->max_us = after->max_us;
+	for (i = 0; i < EVENT_LATENCY_BUCKETS; i++) {
+		delta->buckets[i] = after->buckets[i] - before->buckets[i];
+	}
+}
+
+static agc_status_t test_latency(agc_stream_handle_t *stream)
+{
+	agc_event_latency_t queue_before, handle_before, queue_after, handle_after, handle;
+	agc_event_subscriber_stats_t subscribers[16];
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	uint64_t median, high;
+	int count, found = 0, i, waited;
+
+	// an id nothing was delivered for has no histogram, a bad id is refused
+	if (agc_event_get_latency(TEST_LATENCY_IDLE_ID, &queue_before, &handle_before) != AGC_STATUS_NOTFOUND ||
+		agc_event_get_latency(EVENT_ID_LIMIT, &queue_before, &handle_before) != AGC_STATUS_GENERR ||
+		agc_event_latency_percentile(&queue_before, 50) != 0) {
+		stream->write_function(stream, "test latency histograms [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	if (agc_event_bind_removable(TEST_LATENCY_BIND, g_event_id, latency_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test latency histograms [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_latency_calls = 0;
+	if (agc_event_get_latency(g_event_id, &queue_before, &handle_before) != AGC_STATUS_SUCCESS) {
+		memset(&queue_before, 0, sizeof(queue_before));
+		memset(&handle_before, 0, sizeof(handle_before));
+	}
+
+	for (i = 0; i < TEST_LATENCY_EVENTS; i++) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_fire(&new_event);
+		}
+	}
+
+	for (waited = 0; g_latency_calls < TEST_LATENCY_EVENTS && waited < 500; waited++) {
+		agc_yield(10000);
+	}
+
+	// the histograms are written after the callbacks return
+	agc_yield(10000);
+
+	agc_event_get_latency(g_event_id, &queue_after, &handle_after);
+	count = agc_event_get_subscriber_stats(g_event_id, subscribers, sizeof(subscribers) / sizeof(subscribers[0]));
+	agc_event_unbind(&node);
+
+	// every delivery is counted once, the slow subscriber shows in the handling time and in its own histogram
+	test_latency_delta(&handle, &handle_before, &handle_after);
+	median = agc_event_latency_percentile(&handle, 50);
+	high = agc_event_latency_percentile(&handle, 99);
+
+	for (i = 0; i < count; i++) {
+		if (!strcmp(subscribers[i].id, TEST_LATENCY_BIND) && subscribers[i].callback.count == TEST_LATENCY_EVENTS &&
+			subscribers[i].callback.sum_us >= TEST_LATENCY_EVENTS * TEST_LATENCY_SLOW_US && !subscribers[i].async) {
+			found = 1;
+		}
+	}
+
+	if (g_latency_calls != TEST_LATENCY_EVENTS || queue_after.count - queue_before.count != TEST_LATENCY_EVENTS ||
+		handle.count != TEST_LATENCY_EVENTS || handle.sum_us < TEST_LATENCY_EVENTS * TEST_LATENCY_SLOW_US ||
+		median < TEST_LATENCY_SLOW_US * 3 / 4 || median > high || high > handle.max_us ||
+		agc_event_latency_percentile(&handle, 100) != handle.max_us || !found) {
+		stream->write_function(stream, "test latency histograms [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test latency histograms [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+#define TEST_ID_THREADS 4
+#define TEST_ID_COUNT 500
+#define TEST_WIDE_HEADER "wide_source"
+/* above the 32 bit range */
+#define TEST_WIDE_SOURCE 0x100000000ULL
+
+static uint64_t g_wide_source = 0;
+
+static void *test_id_thread(agc_thread_t *thread, void *obj)
+{
+	uint64_t *ids = (uint64_t *) obj;
+	int i;
+
+	for (i = 0; i < TEST_ID_COUNT; i++) {
+		ids[i] = agc_event_alloc_source(TEST_SOURCE_NAME);
+	}
+
+	return NULL;
+}
+
+static int test_id_compare(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+
+	return x < y ? -1 : (x > y);
+}
+
+static void wide_callback(void *data)
+{
+	agc_event_t *event = (agc_event_t *) data;
+
+	if (agc_event_get_header(event, TEST_WIDE_HEADER)) {
+		g_wide_source = event->source_id;
+	}
+}
+
+static agc_status_t test_source_ids(agc_stream_handle_t *stream)
+{
+	static uint64_t ids[TEST_ID_THREADS + 1][TEST_ID_COUNT];
+	agc_thread_t *threads[TEST_ID_THREADS];
+	agc_memory_pool_t *pool = NULL;
+	agc_threadattr_t *thd_attr = NULL;
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t retval;
+	uint64_t *all = &ids[0][0];
+	int i, j, waited;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test 64 bit source ids [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	// the threads reserve ids in batches while this one takes its own
+	agc_threadattr_create(&thd_attr, pool);
+	for (i = 0; i < TEST_ID_THREADS; i++) {
+		agc_thread_create(&threads[i], thd_attr, test_id_thread, ids[i + 1], pool);
+	}
+	test_id_thread(NULL, ids[0]);
+	for (i = 0; i < TEST_ID_THREADS; i++) {
+		agc_thread_join(&retval, threads[i]);
+	}
+	agc_memory_destroy_pool(&pool);
+
+	// increasing within a thread, never 0 and never handed out twice
+	for (i = 0; i <= TEST_ID_THREADS; i++) {
+		for (j = 1; j < TEST_ID_COUNT; j++) {
+			if (ids[i][j] <= ids[i][j - 1]) {
+				stream->write_function(stream, "test 64 bit source ids [fail].\n");
+				return AGC_STATUS_FALSE;
+			}
+		}
+	}
+
+	qsort(all, (TEST_ID_THREADS + 1) * TEST_ID_COUNT, sizeof(uint64_t), test_id_compare);
+	for (i = 0; i < (TEST_ID_THREADS + 1) * TEST_ID_COUNT; i++) {
+		if (all[i] == EVENT_NULL_SOURCEID || (i && all[i] == all[i - 1])) {
+			stream->write_function(stream, "test 64 bit source ids [fail].\n");
+			return AGC_STATUS_FALSE;
+		}
+	}
+
+	// a source id beyond 32 bits is delivered whole
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, wide_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test 64 bit source ids [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_wide_source = 0;
+	if ((agc_event_create(&new_event, g_event_id, TEST_WIDE_SOURCE + g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_add_header_string(new_event, TEST_WIDE_HEADER, "1");
+		agc_event_fire(&new_event);
+	}
+
+	for (waited = 0; !g_wide_source && waited < 500; waited++) {
+		agc_yield(10000);
+	}
+	agc_event_unbind(&node);
+
+	if (g_wide_source != TEST_WIDE_SOURCE + g_source_id) {
+		stream->write_function(stream, "test 64 bit source ids [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	stream->write_function(stream, "test 64 bit source ids [ok].\n");
+	return AGC_STATUS_SUCCESS;
+}
+
+/* a frame with one string header "theader" = "thvalue" and no body */
+#define TEST_FRAME_HEADER_SIZE (8 + sizeof(TEST_HEADER_NAME) - 1 + sizeof(TEST_HEADER_VALUE) - 1)
+
+static agc_size_t test_binary_frame(unsigned char *frame, int version, uint64_t source_id)
+{
+	agc_size_t head_size = version == 1 ? AGC_EVENT_BINARY_V1_HEAD_SIZE : AGC_EVENT_BINARY_HEAD_SIZE;
+	unsigned char *ptr = frame + head_size;
+
+	memset(frame, 0, head_size + TEST_FRAME_HEADER_SIZE);
+	test_put_u32(frame, head_size + TEST_FRAME_HEADER_SIZE);
+	frame[4] = version;
+	frame[7] = 1;
+	test_put_u32(frame + 8, g_event_id);
+	if (version == 1) {
+		test_put_u32(frame + 12, (uint32_t) source_id);
+	} else {
+		test_put_u32(frame + 12, (uint32_t) (source_id >> 32));
+		test_put_u32(frame + 16, (uint32_t) source_id);
+	}
+
+	ptr[0] = EVENT_HEADER_STRING;
+	ptr[3] = sizeof(TEST_HEADER_NAME) - 1;
+	test_put_u32(ptr + 4, sizeof(TEST_HEADER_VALUE) - 1);
+	memcpy(ptr + 8, TEST_HEADER_NAME, sizeof(TEST_HEADER_NAME) - 1);
+	memcpy(ptr + 8 + sizeof(TEST_HEADER_NAME) - 1, TEST_HEADER_VALUE, sizeof(TEST_HEADER_VALUE) - 1);
+
+	return head_size + TEST_FRAME_HEADER_SIZE;
+}
+
+/* the frame decodes to the source id, with its header */
+static agc_status_t test_binary_source(const unsigned char *frame, agc_size_t len, uint64_t source_id)
+{
+	agc_event_t *event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	const char *value;
+
+	if (agc_event_create_binary(&event, frame, len) == AGC_STATUS_SUCCESS && event->event_id == g_event_id &&
+		event->source_id == source_id && (value = agc_event_get_header(event, TEST_HEADER_NAME)) && !strcmp(value, TEST_HEADER_VALUE)) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_destroy(&event);
+	return status;
+}
+
+static agc_status_t test_binary_versions(agc_stream_handle_t *stream)
+{
+	unsigned char frame[AGC_EVENT_BINARY_HEAD_SIZE + TEST_FRAME_HEADER_SIZE];
+	char buf[256];
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	agc_size_t len;
+	uint64_t wide = 0x123456789abcdef0ULL;
+
+	// version 1: 16 byte head, 4 byte source id
+	len = test_binary_frame(frame, 1, 0x89abcdefULL);
+	if (len != AGC_EVENT_BINARY_V1_HEAD_SIZE + TEST_FRAME_HEADER_SIZE || test_binary_source(frame, len, 0x89abcdefULL) != AGC_STATUS_SUCCESS) {
+		goto done;
+	}
+
+	// version 2: 20 byte head, 8 byte source id
+	len = test_binary_frame(frame, 2, wide);
+	if (len != AGC_EVENT_BINARY_HEAD_SIZE + TEST_FRAME_HEADER_SIZE || test_binary_source(frame, len, wide) != AGC_STATUS_SUCCESS) {
+		goto done;
+	}
+
+	// a version this build does not know is refused
+	frame[4] = AGC_EVENT_BINARY_VERSION + 1;
+	if (agc_event_create_binary(&new_event, frame, len) == AGC_STATUS_SUCCESS) {
+		goto done;
+	}
+
+	// the encoder writes the same version 2 frame
+	if (agc_event_create(&new_event, g_event_id, wide) != AGC_STATUS_SUCCESS || !new_event) {
+		goto done;
+	}
+	agc_event_add_header_string(new_event, TEST_HEADER_NAME, TEST_HEADER_VALUE);
+
+	frame[4] = AGC_EVENT_BINARY_VERSION;
+	if (agc_event_serialize_binary(new_event, buf, sizeof(buf), &len) != AGC_STATUS_SUCCESS ||
+		len != sizeof(frame) || memcmp(buf, frame, len)) {
+		goto done;
+	}
+
+	status = AGC_STATUS_SUCCESS;
+
+done:
+	agc_event_destroy(&new_event);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test binary v1 and v2 source id [ok].\n");
+	} else {
+		stream->write_function(stream, "test binary v1 and v2 source id [fail].\n");
+	}
+
+	return status;
+}
+
+static agc_event_t *g_pressure_reply = NULL;
+
+static void *test_reply_thread(agc_thread_t *thread, void *obj)
+{
+	// waits for room in the requester's full queue
+	agc_event_fire(&g_pressure_reply);
+	return NULL;
+}
+
+static agc_status_t test_request_pressure(agc_stream_handle_t *stream)
+{
+	agc_event_overflow_t old = agc_event_get_overflow_policy(g_event_id);
+	agc_memory_pool_t *pool = NULL;
+	agc_threadattr_t *thd_attr = NULL;
+	agc_thread_t *thread = NULL;
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	agc_status_t retval;
+	uint64_t dropped_base, dropped = 0, spilled;
+	uint32_t pending = 1;
+	int fired, waited;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request under EVENT_OVERFLOW_DROP_NEWEST [fail].\n");
+		return status;
+	}
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, request_capture, &node) != AGC_STATUS_SUCCESS) {
+		agc_memory_destroy_pool(&pool);
+		stream->write_function(stream, "test agc_event_request under EVENT_OVERFLOW_DROP_NEWEST [fail].\n");
+		return status;
+	}
+
+	agc_event_set_overflow_policy(g_event_id, EVENT_OVERFLOW_DROP_NEWEST);
+	g_replies = g_timeouts = 0;
+	g_request_corr[0] = '\0';
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_request(&new_event, 1000, request_reply, NULL);
+	}
+
+	agc_yield(100000); //wait execute
+
+	// hold the requester's dispatcher and fill its queue until events of the id are dropped
+	g_drain_gate = 0;
+	if ((agc_event_create_callback(&new_event, g_source_id, NULL, drain_gate_callback) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+	agc_yield(50000);
+
+	test_overflow_counters(&dropped_base, &spilled);
+	for (fired = 0; fired < TEST_OVERFLOW_LIMIT && dropped == dropped_base; fired++) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+			break;
+		}
+		agc_event_fire(&new_event);
+		test_overflow_counters(&dropped, &spilled);
+	}
+
+	// the reply is fired into the full queue, it must wait instead of being dropped
+	if (g_request_corr[0] && (agc_event_create(&g_pressure_reply, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && g_pressure_reply) {
+		agc_event_add_header_string(g_pressure_reply, EVENT_HEADER_REPLY, g_request_corr);
+		agc_threadattr_create(&thd_attr, pool);
+		agc_thread_create(&thread, thd_attr, test_reply_thread, NULL, pool);
+	}
+
+	agc_yield(50000);
+	g_drain_gate = 1;
+	if (thread) {
+		agc_thread_join(&retval, thread);
+	}
+
+	for (waited = 0; !g_replies && !g_timeouts && waited < 200; waited++) {
+		agc_yield(10000);
+	}
+
+	agc_event_request_stats(&pending, NULL);
+	if (thread && dropped != dropped_base && g_replies == 1 && !g_timeouts && !pending) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_event_set_overflow_policy(g_event_id, old);
+	agc_event_unbind(&node);
+	agc_memory_destroy_pool(&pool);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_request under EVENT_OVERFLOW_DROP_NEWEST [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_request under EVENT_OVERFLOW_DROP_NEWEST [fail].\n");
+	}
+
+	return status;
+}
+
+/* an id of its own, g_event_id + 3 stays unregistered */
+#define TEST_EVICT_ID (g_event_id + 4)
+#define TEST_EVICT_EVENTS 10
+
+static agc_status_t test_drop_oldest_others(agc_stream_handle_t *stream)
+{
+	agc_event_overflow_t old = agc_event_get_overflow_policy(g_event_id);
+	agc_event_overflow_t other_old;
+	agc_event_node_t *node = NULL;
+	agc_event_t *new_event = NULL;
+	uint64_t dropped_base, spilled_base, dropped, spilled;
+	int fired, i;
+
+	if (!agc_event_get_name(TEST_EVICT_ID)) {
+		agc_event_register(TEST_EVICT_ID, "TEST_EVICT_EVENT");
+	}
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, overflow_callback, &node) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test EVENT_OVERFLOW_DROP_OLDEST with other ids queued [fail].\n");
+		return AGC_STATUS_FALSE;
+	}
+
+	g_overflow_count = 0;
+	g_overflow_last = 0;
+	g_overflow_disorder = 0;
+	g_drain_gate = 0;
+
+	other_old = agc_event_get_overflow_policy(TEST_EVICT_ID);
+	agc_event_set_overflow_policy(TEST_EVICT_ID, EVENT_OVERFLOW_DROP_NEWEST);
+	agc_event_set_overflow_policy(g_event_id, EVENT_OVERFLOW_DROP_OLDEST);
+	test_overflow_counters(&dropped_base, &spilled_base);
+	dropped = dropped_base;
+
+	if ((agc_event_create_callback(&new_event, g_source_id, NULL, drain_gate_callback) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	// the queue of the source fills with events of the other id until one is dropped
+	for (fired = 0; fired < TEST_OVERFLOW_LIMIT && dropped == dropped_base; fired++) {
+		if ((agc_event_create(&new_event, TEST_EVICT_ID, g_source_id) != AGC_STATUS_SUCCESS) || !new_event) {
+			break;
+		}
+
+		agc_event_fire(&new_event);
+		test_overflow_counters(&dropped, &spilled);
+	}
+
+	// nothing older of their id is queued, so they are all kept
+	for (i = 1; i <= TEST_EVICT_EVENTS; i++) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_add_header(new_event, TEST_HEADER_NAME, "%d", i);
+			agc_event_fire(&new_event);
+		}
+	}
+
+	g_drain_gate = 1;
+	for (i = 0; i < 200 && g_overflow_last != TEST_EVICT_EVENTS; i++) {
+		agc_yield(10000); //wait execute
+	}
+
+	test_overflow_counters(&dropped, &spilled);
+
+	agc_event_set_overflow_policy(g_event_id, old);
+	agc_event_set_overflow_policy(TEST_EVICT_ID, other_old);
+	agc_event_unbind(&node);
+
+	if (g_overflow_count == TEST_EVICT_EVENTS && !g_overflow_disorder && dropped - dropped_base == 1 &&
+		spilled - spilled_base == TEST_EVICT_EVENTS) {
+		stream->write_function(stream, "test EVENT_OVERFLOW_DROP_OLDEST with other ids queued [ok].\n");
+		return AGC_STATUS_SUCCESS;
+	}
+
+	stream->write_function(stream, "test EVENT_OVERFLOW_DROP_OLDEST with other ids queued [fail].\n");
+	return AGC_STATUS_FALSE;
+}
+
+#define TEST_LATER_HEADER "x-test-later"
+
+static agc_event_t *volatile g_kept_event = NULL;
+static volatile int g_later_added = 0;
+
+static void keep_callback(void *data)
+{
+	if (!g_kept_event) {
+		g_kept_event = agc_event_retain((agc_event_t *) data);
+	}
+}
+
+static void later_callback(void *data)
+{
+	if (agc_event_add_header_string((agc_event_t *) data, TEST_LATER_HEADER, TEST_HEADER_VALUE) == AGC_STATUS_SUCCESS) {
+		g_later_added = 1;
+	}
+}
+
+static agc_status_t test_lane_keep(agc_stream_handle_t *stream)
+{
+	agc_event_lane_options_t options = { 16, 1, EVENT_OVERFLOW_BLOCK };
+	agc_event_node_t *keep = NULL, *later = NULL;
+	agc_event_t *new_event = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	int i;
+
+	g_kept_event = NULL;
+	g_later_added = 0;
+
+	// the subscriber keeping the events is bound first, the one changing them after it
+	if (agc_event_bind_async(TEST_BIND_NAME, g_event_id, keep_callback, NULL, &options, &keep) != AGC_STATUS_SUCCESS ||
+		agc_event_bind_removable(TEST_BIND_NAME, g_event_id, later_callback, &later) != AGC_STATUS_SUCCESS) {
+		agc_event_unbind(&keep);
+		stream->write_function(stream, "test agc_event_retain on a lane [fail].\n");
+		return status;
+	}
+
+	if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	for (i = 0; i < 100 && !g_kept_event; i++) {
+		agc_yield(10000); //wait execute
+	}
+
+	agc_event_unbind(&later);
+	agc_event_unbind(&keep);
+
+	// the lane took it once the sync subscriber had changed it
+	if (g_later_added && g_kept_event && agc_event_get_header(g_kept_event, TEST_LATER_HEADER)) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	if (g_kept_event) {
+		agc_event_t *kept = g_kept_event;
+
+		agc_event_release(&kept);
+		g_kept_event = NULL;
+	}
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test agc_event_retain on a lane [ok].\n");
+	} else {
+		stream->write_function(stream, "test agc_event_retain on a lane [fail].\n");
+	}
+
+	return status;
+}
+
+static volatile int g_lane_gate = 0;
+
+static void lane_gate_callback(void *data)
+{
+	int waited;
+
+	agc_fetch_add(&g_lane_calls, 1);
+	for (waited = 0; !g_lane_gate && waited < 5000; waited++) {
+		agc_yield(1000);
+	}
+}
+
+static void *test_lane_gate_thread(agc_thread_t *thread, void *obj)
+{
+	// the unbind is waiting for the worker by then
+	agc_yield(200000);
+	g_lane_gate = 1;
+	return NULL;
+}
+
+static agc_status_t test_lane_block_stop(agc_stream_handle_t *stream)
+{
+	agc_event_lane_options_t options = { 1, 1, EVENT_OVERFLOW_BLOCK };
+	agc_memory_pool_t *pool = NULL;
+	agc_threadattr_t *thd_attr = NULL;
+	agc_thread_t *thread = NULL;
+	agc_event_t *new_event = NULL;
+	agc_event_node_t *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	agc_status_t retval;
+	int i, waited;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test lane stop with EVENT_OVERFLOW_BLOCK [fail].\n");
+		return status;
+	}
+
+	g_lane_calls = 0;
+	g_lane_gate = 0;
+	g_drain_calls = 0;
+
+	if (agc_event_bind_async(TEST_BIND_NAME, g_event_id, lane_gate_callback, NULL, &options, &node) != AGC_STATUS_SUCCESS) {
+		agc_memory_destroy_pool(&pool);
+		stream->write_function(stream, "test lane stop with EVENT_OVERFLOW_BLOCK [fail].\n");
+		return status;
+	}
+
+	// the worker holds one, the lane two, the dispatcher waits for room with the last one
+	for (i = 0; i < 4; i++) {
+		if ((agc_event_create(&new_event, g_event_id, g_source_id) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_fire(&new_event);
+		}
+	}
+	agc_yield(100000);
+
+	agc_threadattr_create(&thd_attr, pool);
+	agc_thread_create(&thread, thd_attr, test_lane_gate_thread, NULL, pool);
+
+	// the stop wakes the dispatcher, it drops its event instead of waiting for the worker
+	agc_event_unbind(&node);
+	agc_thread_join(&retval, thread);
+
+	if ((agc_event_create_callback(&new_event, g_source_id, NULL, drain_callback) == AGC_STATUS_SUCCESS) && new_event) {
+		agc_event_fire(&new_event);
+	}
+
+	for (waited = 0; !g_drain_calls && waited < 100; waited++) {
+		agc_yield(10000);
+	}
+
+	if (g_lane_calls == 3 && g_drain_calls == 1) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_memory_destroy_pool(&pool);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test lane stop with EVENT_OVERFLOW_BLOCK [ok].\n");
+	} else {
+		stream->write_function(stream, "test lane stop with EVENT_OVERFLOW_BLOCK [fail].\n");
+	}
+
+	return status;
+}
+
+#define TEST_CHURN_ROUNDS 200
+
+static volatile int g_churn_firing = 0;
+static volatile int g_churn_unbound = 0;
+static volatile int g_churn_calls = 0;
+static volatile int g_churn_late = 0;
+static volatile int g_churn_base = 0;
+
+static void churn_base_callback(void *data)
+{
+	agc_fetch_add(&g_churn_base, 1);
+}
+
+static void churn_callback(void *data)
+{
+	agc_fetch_add(&g_churn_calls, 1);
+	if (g_churn_unbound) {
+		agc_fetch_add(&g_churn_late, 1);
+	}
+}
+
+static void *test_churn_thread(agc_thread_t *thread, void *obj)
+{
+	agc_event_t *new_event = NULL;
+	int i = 0;
+
+	// sourced and sourceless, every dispatcher delivers while the test binds and unbinds
+	while (g_churn_firing) {
+		if ((agc_event_create(&new_event, g_event_id, (i++ & 1) ? g_source_id : EVENT_NULL_SOURCEID) == AGC_STATUS_SUCCESS) && new_event) {
+			agc_event_fire(&new_event);
+		}
+
+		if (!(i & 63)) {
+			agc_yield(100);
+		}
+	}
+
+	return NULL;
+}
+
+static agc_status_t test_bind_churn(agc_stream_handle_t *stream)
+{
+	agc_memory_pool_t *pool = NULL;
+	agc_threadattr_t *thd_attr = NULL;
+	agc_thread_t *thread = NULL;
+	agc_event_node_t *base = NULL, *node = NULL;
+	agc_status_t status = AGC_STATUS_FALSE;
+	agc_status_t retval;
+	int round, base_calls;
+
+	if (agc_memory_create_pool(&pool) != AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test bind and unbind while delivering [fail].\n");
+		return status;
+	}
+
+	if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, churn_base_callback, &base) != AGC_STATUS_SUCCESS) {
+		agc_memory_destroy_pool(&pool);
+		stream->write_function(stream, "test bind and unbind while delivering [fail].\n");
+		return status;
+	}
+
+	g_churn_calls = g_churn_late = g_churn_base = 0;
+	g_churn_firing = 1;
+	agc_threadattr_create(&thd_attr, pool);
+	agc_thread_create(&thread, thd_attr, test_churn_thread, NULL, pool);
+
+	// an unbind returns once no dispatcher can be in the callback, it is never called after that
+	for (round = 0; round < TEST_CHURN_ROUNDS; round++) {
+		g_churn_unbound = 0;
+		if (agc_event_bind_removable(TEST_BIND_NAME, g_event_id, churn_callback, &node) != AGC_STATUS_SUCCESS) {
+			break;
+		}
+
+		agc_yield(500);
+		agc_event_unbind(&node);
+		g_churn_unbound = 1;
+		agc_yield(200);
+	}
+
+	g_churn_firing = 0;
+	agc_thread_join(&retval, thread);
+
+	base_calls = g_churn_base;
+	agc_event_unbind(&base);
+
+	// the replaced lists and the unbound nodes are all freed by the last unbind
+	if (round == TEST_CHURN_ROUNDS && g_churn_calls && !g_churn_late && base_calls && !agc_event_retired_count()) {
+		status = AGC_STATUS_SUCCESS;
+	}
+
+	agc_memory_destroy_pool(&pool);
+
+	if (status == AGC_STATUS_SUCCESS) {
+		stream->write_function(stream, "test bind and unbind while delivering [ok].\n");
+	} else {
+		stream->write_function(stream, "test bind and unbind while delivering [fail].\n");
+	}
+
+	return status;
+}